@@ -1,9 +1,9 @@
 #ifndef BUFFER_H
 #define BUFFER_H
 
-#include <vector>
+#include <cstdint>
+#include <memory>
 #include <string>
-#include <atomic>
 #include <iostream>
 #include <unistd.h>  // for read, write
 #include <sys/uio.h> // for readv
@@ -16,28 +16,40 @@ public:
     size_t writableBytes() const;       // 可写字节数
     size_t readableBytes() const;       // 可读字节数
     size_t prependableBytes() const;    // 头部预留空间
+    size_t capacity() const { return capacity_; }       // 占用的内存
 
     const char* peek() const;           // 查看当前读指针位置
+    char* peek();                       // 同上，可写 (解析器原地解码 chunked body 用)
     void retrieve(size_t len);          // 读走 len 长度数据，指针后移
     void retrieveUntil(const char* end);// 读走直到 end 位置
     void retrieveAll();                 // 清空
     std::string retrieveAllToStr();     // 取出所有数据转 string
+    void erase(size_t pos, size_t len); // 删掉可读区里 [pos, pos + len)，后面的数据往前挪
+    void shrink(size_t reserve = 0);    // 换一块刚好放下可读数据 + reserve 的内存，多出来的还给系统
 
     void append(const std::string& str);
     void append(const char* str, size_t len);
     void append(const void* data, size_t len);
 
-    ssize_t readFd(int fd, int* Errno); // 【核心难点】从 socket 读数据
+    // 保证至少能再写 len 字节。要扩容时容量不超过 maxCapacity (放不下 len 的话按 len 来)
+    void ensureWritable(size_t len, size_t maxCapacity = SIZE_MAX);
+
+    // 【核心难点】从 socket 读数据，最多读 maxLen 字节。
+    // 现有的空闲空间 (包括前面读走腾出来的) 算在 maxLen 里，超出的部分才扩容
+    ssize_t readFd(int fd, int* Errno, size_t maxLen = SIZE_MAX);
     ssize_t writeFd(int fd, int* Errno);// 往 socket 写数据
 
 private:
     char* BeginPtr_();                  // 获取内存起始指针
     const char* BeginPtr_() const;
-    void MakeSpace_(size_t len);        // 自动扩容
-
-    std::vector<char> buffer_;          // 使用 vector 管理内存 (RAII)
-    std::atomic<size_t> readPos_;       // 读指针 (原子操作保证线程安全基础，虽然后续还要加锁)
-    std::atomic<size_t> writePos_;      // 写指针
+    void MakeSpace_(size_t len, size_t maxCapacity = SIZE_MAX);  // 自动扩容 (翻倍但不超过 maxCapacity，只搬可读的部分)
+
+    // 自己管一块 new char[] (RAII)：vector 扩容时会把新内存整块清零，反正马上要被覆盖，白写一遍
+    std::unique_ptr<char[]> buffer_;
+    size_t capacity_;
+    // 一个 Buffer 同一时刻只属于一个线程 (连接的处理线程)，下标不需要原子操作
+    size_t readPos_;                    // 读指针
+    size_t writePos_;                   // 写指针
 };
 
 #endif // BUFFER_H
\ No newline at end of file
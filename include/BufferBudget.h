@@ -0,0 +1,49 @@
+#ifndef BUFFER_BUDGET_H
+#define BUFFER_BUDGET_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// 连接缓冲区的内存账本。只记账不分配：连接在缓冲区容量变化之后来报账，
+// 总量超过预算、或者单个连接超过上限时报账失败，由连接自己决定断开。
+// 计数器都是原子的，任意线程可读 (/api/status)
+class BufferBudget {
+public:
+    static BufferBudget* Instance();
+
+    // 0 表示不限
+    void SetLimit(size_t totalBytes, size_t perConnBytes) { limit_ = totalBytes; perConn_ = perConnBytes; }
+    size_t Limit() const { return limit_; }
+    size_t PerConnLimit() const { return perConn_; }
+
+    // 一个连接的缓冲区容量从 from 变成 to。变大之后超出预算返回 false (账照样记上，
+    // 连接关闭、收缩时会还回来)。变小总是成功
+    bool Charge(size_t from, size_t to);
+    // 一个已经记了 charged 字节的连接还能再涨多少：单连接上限和总预算剩下的取小的。
+    // 不限时返回 SIZE_MAX。读之前先问一下，按这个数封顶，而不是读完了再报账失败
+    size_t Headroom(size_t charged) const;
+    // 空闲连接收缩缓冲区，还回来 bytes 字节
+    void CountRelease(size_t bytes);
+
+    size_t Used() const { return used_; }
+    size_t Peak() const { return peak_; }
+    uint64_t Rejected() const { return rejected_; }      // 报账失败 (超预算) 的次数
+    uint64_t Releases() const { return releases_; }      // 空闲收缩的次数
+    uint64_t ReleasedBytes() const { return releasedBytes_; }
+
+    BufferBudget() = default;
+    BufferBudget(const BufferBudget&) = delete;
+    BufferBudget& operator=(const BufferBudget&) = delete;
+
+private:
+    size_t limit_ = 0;
+    size_t perConn_ = 0;
+    std::atomic<size_t> used_{0};
+    std::atomic<size_t> peak_{0};
+    std::atomic<uint64_t> rejected_{0};
+    std::atomic<uint64_t> releases_{0};
+    std::atomic<uint64_t> releasedBytes_{0};
+};
+
+#endif // BUFFER_BUDGET_H
@@ -0,0 +1,74 @@
+#ifndef CHAIN_BUFFER_H
+#define CHAIN_BUFFER_H
+
+#include <string>
+#include <vector>
+#include <unistd.h>  // for ssize_t
+#include <sys/uio.h> // for iovec
+
+// Buffer 的链式版本：数据存在一串定长块里，块从当前线程的空闲链表拿、用完还回去。
+//   - 追加只写尾块，写满了接一个新块；消费只移动头块的读下标，读完的块直接还掉。
+//     已有的数据从不搬家，块的地址在被消费之前一直有效，可以直接拿去填 iovec
+//   - 块不清零，下标是普通整数：一个 ChainBuffer 同一时刻只有一个线程在用
+//   - 代价是可读数据不连续，要连续内存的地方 (请求解析、响应头拼好再切开) 仍然用 Buffer
+class ChainBuffer {
+public:
+    static const size_t BLOCK_SIZE = 16 * 1024;
+    // 每个线程最多留这么多空闲块 (4MB)，再多的直接 delete
+    static const size_t MAX_FREE_BLOCKS = 256;
+
+    ChainBuffer();
+    ~ChainBuffer();
+    ChainBuffer(ChainBuffer&& other) noexcept;
+    ChainBuffer& operator=(ChainBuffer&& other) noexcept;
+    ChainBuffer(const ChainBuffer&) = delete;
+    ChainBuffer& operator=(const ChainBuffer&) = delete;
+
+    size_t readableBytes() const { return size_; }
+    // 尾块还能写多少 (不接新块)
+    size_t writableBytes() const { return tail_ ? BLOCK_SIZE - tail_->write : 0; }
+    size_t blockCount() const { return blocks_; }
+
+    void append(const void* data, size_t len);
+    void append(const std::string& str) { append(str.data(), str.size()); }
+    // 在尾部要 len (<= BLOCK_SIZE) 字节的连续空间，尾块放不下就接一个新块。
+    // 直接往里写 (pread / recv)，写完用 commit 确认实际写了多少
+    char* reserve(size_t len);
+    void commit(size_t len);
+
+    void retrieve(size_t len);
+    void retrieveAll();
+    std::string retrieveAllToStr();
+
+    // 可读数据按块填进 iov，最多 maxIov 段，返回填进去的字节数
+    size_t peekIov(std::vector<struct iovec>* iov, size_t maxIov) const;
+
+    // readv 直接读进尾块剩下的空间和新块里，不经过栈上的临时缓冲区
+    ssize_t readFd(int fd, int* Errno);
+    // writev 发出去，发了多少就消费多少
+    ssize_t writeFd(int fd, int* Errno);
+
+    // 当前线程空闲链表里的块数 (测试用)
+    static size_t FreeBlocks();
+
+private:
+    struct Block {
+        Block* next;
+        size_t read;
+        size_t write;
+        char data[BLOCK_SIZE];
+    };
+    struct FreeList;
+
+    static FreeList& LocalFreeList_();
+    static Block* NewBlock_();
+    static void FreeBlock_(Block* block);
+    void PushBlock_(Block* block);
+
+    Block* head_;
+    Block* tail_;
+    size_t size_;       // 所有块的可读字节数之和
+    size_t blocks_;
+};
+
+#endif // CHAIN_BUFFER_H
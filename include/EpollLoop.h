@@ -0,0 +1,39 @@
+#ifndef EPOLL_LOOP_H
+#define EPOLL_LOOP_H
+
+#include <unordered_map>
+#include "EventLoop.h"
+#include "Epoller.h"
+#include "http/HttpConn.h"
+
+// epoll 后端：就绪通知 + 非阻塞 readv/writev
+class EpollLoop : public EventLoop {
+public:
+    explicit EpollLoop(ThreadPool* pool = nullptr, int timeoutMs = 60000);
+    ~EpollLoop() override = default;
+
+    void Listen(int port, bool reusePort = false) override;
+    void Loop() override;
+    void AddConn(int fd, const sockaddr_in& addr) override;
+
+private:
+    void HandleAccept_();
+    void HandleWakeup_();
+    void HandleEvent_(HttpConn* conn, uint32_t events);
+    void Dispatch_(HttpConn* conn, uint32_t events);  // 交给线程池，没有线程池或者它满了就自己做
+    void OnEvent_(HttpConn* conn, uint32_t events);  // 写 + 读 + 解析 + 响应 (可能在工作线程里跑)
+    bool Flush_(HttpConn* conn);          // 发送积压数据，连接被关闭时返回 false
+    void RequestClose_(HttpConn* conn);   // 任意线程：把关闭动作交回 loop 线程
+    void CloseConn_(HttpConn* conn);      // 定时器回调：真正关闭连接
+    int KeepAlive_(int fd) override;      // 定时器到期前：长连接发 ping 续期
+    void ReleaseIdle_() override;
+    void Wake_(HttpConn* conn);           // 不是 socket 事件引起的输出 (ping、推送)：照常走一遍事件处理
+    void OnPush_(Subscriber& sub) override;
+    uint32_t ConnEvent_() const;
+
+    Epoller epoller_;
+    // fd -> 连接对象。关闭后不删除，同一个 fd 的下一个连接直接复用
+    std::unordered_map<int, HttpConn> conns_;
+};
+
+#endif // EPOLL_LOOP_H
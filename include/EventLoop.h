@@ -0,0 +1,88 @@
+#ifndef EVENT_LOOP_H
+#define EVENT_LOOP_H
+
+#include <atomic>
+#include <climits>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <functional>
+#include <arpa/inet.h>
+#include "Socket.h"
+#include "heaptimer.h"
+#include "ThreadPool.h"
+#include "http/EventHub.h"
+
+// 一个 EventLoop = 一个 Reactor：独占自己的 I/O 后端、定时器和连接表，只在自己的线程里跑。
+//   - 单 Reactor 模式：一个 loop 负责 accept + 读事件，业务交给线程池 (pool != nullptr)
+//   - 主从 Reactor 模式：主 loop 只 accept，轮询分发给各个子 loop，子 loop 在本线程内直接处理
+//   - SO_REUSEPORT 模式：每个子 loop 各自持有一个监听 socket，由内核做负载均衡，不需要主 loop
+//
+// I/O 后端可插拔：EpollLoop (就绪通知，默认) / UringLoop (完成通知，io_uring)
+class EventLoop : public PushTarget {
+public:
+    typedef std::function<void()> Functor;
+
+    enum Backend {
+        EPOLL,
+        URING
+    };
+
+    // 按后端创建 loop；io_uring 不可用 (老内核、被禁用) 时自动回退到 epoll
+    static std::unique_ptr<EventLoop> Create(Backend backend, ThreadPool* pool = nullptr, int timeoutMs = 60000);
+
+    virtual ~EventLoop();
+
+    EventLoop(const EventLoop&) = delete;
+    EventLoop& operator=(const EventLoop&) = delete;
+
+    // 让本 loop 自己监听端口 (必须在 Loop() 之前调用)
+    virtual void Listen(int port, bool reusePort = false);
+    // 主 Reactor：accept 到的连接轮询交给这些子 loop
+    void SetSubLoops(const std::vector<EventLoop*>& loops);
+
+    virtual void Loop() = 0;  // 事件循环，阻塞直到 Quit()
+    void Quit();              // 线程安全
+
+    // 【跨线程】把任务塞进本 loop 的队列，并唤醒本 loop
+    void QueueInLoop(Functor cb);
+
+    // 【跨线程】EventHub 发布之后：这些订阅者的连接有新消息要发
+    void Push(std::vector<std::shared_ptr<Subscriber>> subs) override;
+
+    // 以下只能在本 loop 线程调用
+    virtual void AddConn(int fd, const sockaddr_in& addr) = 0;
+
+protected:
+    EventLoop(ThreadPool* pool, int timeoutMs);
+
+    // 新连接：自己处理，或者轮询交给子 loop
+    void DispatchConn_(int fd, const sockaddr_in& addr);
+    void DoPendingFunctors_();
+    // loop 线程：订阅者的连接还在 (没有关掉、fd 没有被新连接复用) 的话把消息发出去
+    virtual void OnPush_(Subscriber& sub) = 0;
+    // 定时器到期前问一下要不要续期：连接的交给 KeepAlive_，回收定时器做一轮回收后接着排
+    int OnExpire_(int id);
+    virtual int KeepAlive_(int fd) = 0;
+    // 空闲连接的读写缓冲区缩回去 (HttpConn::ReleaseIdle)
+    virtual void ReleaseIdle_() = 0;
+
+    // 空闲回收定时器的 id，和 fd 不会冲突
+    static const int SWEEP_TIMER = INT_MAX;
+
+    ThreadPool* pool_;            // 为空表示在本线程内直接处理
+    int timeoutMs_;
+    std::atomic<bool> quit_;
+
+    HeapTimer timer_;
+
+    std::unique_ptr<Socket> listenSock_;
+    std::vector<EventLoop*> subLoops_;
+    size_t next_;                 // 轮询下标
+
+    int wakeupFd_;                // eventfd，用于跨线程唤醒
+    std::mutex mtx_;
+    std::vector<Functor> pendingFunctors_;
+};
+
+#endif // EVENT_LOOP_H
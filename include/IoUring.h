@@ -0,0 +1,78 @@
+#ifndef IO_URING_H
+#define IO_URING_H
+
+#include <linux/io_uring.h>
+// io_uring.h 带进来的 linux/fs.h 把 BLOCK_SIZE 定义成了宏，会和 ChainBuffer::BLOCK_SIZE 撞上
+#undef BLOCK_SIZE
+#include <cstddef>
+#include <cstdint>
+
+// 极简 io_uring 封装 (不依赖 liburing，直接走 io_uring_setup / io_uring_enter 系统调用)
+// 只在一个线程里使用：一个 EventLoop 一个 ring，不加锁。
+class IoUring {
+public:
+    explicit IoUring(unsigned entries = 4096);
+    ~IoUring();
+
+    IoUring(const IoUring&) = delete;
+    IoUring& operator=(const IoUring&) = delete;
+
+    bool Valid() const { return ringFd_ >= 0; }
+
+    // 取一个空闲 SQE (已清零)，SQ 满了会先提交一次再取
+    io_uring_sqe* GetSqe();
+    // 提交所有未提交的 SQE，并最多等待 timeoutMs 毫秒直到至少有一个 CQE (-1 表示一直等)
+    int SubmitAndWait(int timeoutMs);
+    int Submit();
+
+    // 遍历并消费当前所有 CQE
+    template<class F>
+    unsigned ForEachCqe(F f) {
+        unsigned head = *cqHead_;
+        unsigned tail = __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE);
+        unsigned n = 0;
+        for(; head != tail; head++, n++) {
+            f(&cqes_[head & cqMask_]);
+        }
+        __atomic_store_n(cqHead_, head, __ATOMIC_RELEASE);
+        return n;
+    }
+
+    // 注册 provided buffer ring：内核收数据时自己从环里挑缓冲区，不需要每个连接预留读缓冲
+    bool SetupBufRing(uint16_t bgid, unsigned entries, size_t bufSize);
+    char* Buf(uint16_t bid) const { return bufBase_ + static_cast<size_t>(bid) * bufSize_; }
+    void RecycleBuf(uint16_t bid);  // 用完的缓冲区还给内核
+
+private:
+    int ringFd_;
+    unsigned sqeTail_;      // 本地 SQ 尾 (还没发布给内核)
+    unsigned submitted_;    // 已经发布给内核的 SQ 尾
+
+    // SQ
+    void* sqRing_;
+    size_t sqRingSize_;
+    unsigned* sqHead_;
+    unsigned* sqTail_;
+    unsigned* sqArray_;
+    unsigned sqMask_;
+    unsigned sqEntries_;
+    io_uring_sqe* sqes_;
+    size_t sqesSize_;
+
+    // CQ
+    void* cqRing_;
+    unsigned* cqHead_;
+    unsigned* cqTail_;
+    unsigned cqMask_;
+    io_uring_cqe* cqes_;
+
+    // provided buffer ring
+    io_uring_buf_ring* bufRing_;
+    size_t bufRingSize_;
+    unsigned bufRingMask_;
+    uint16_t bufRingTail_;
+    char* bufBase_;
+    size_t bufSize_;
+};
+
+#endif // IO_URING_H
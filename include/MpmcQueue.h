@@ -0,0 +1,113 @@
+#ifndef MPMC_QUEUE_H
+#define MPMC_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+// 有界无锁多生产者多消费者环形队列 (Dmitry Vyukov 的做法)。
+// 每个槽带一个序号：序号 == 入队位置 表示空着可以写，== 出队位置 + 1 表示写好了可以读。
+// 生产者之间、消费者之间各自 CAS 抢位置，抢到以后只碰自己那个槽。
+// 满了 TryPush 直接返回 false，由调用方决定怎么办，队列本身不会越涨越长
+template<class T>
+class MpmcQueue {
+public:
+    // 容量向上取整到 2 的幂，至少 2
+    explicit MpmcQueue(size_t capacity) : enqueuePos_(0), dequeuePos_(0) {
+        size_t n = 2;
+        while(n < capacity) {
+            n <<= 1;
+        }
+        mask_ = n - 1;
+        cells_.reset(new Cell[n]);
+        for(size_t i = 0; i < n; i++) {
+            cells_[i].seq.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    ~MpmcQueue() {
+        T item;
+        while(TryPop(item)) {}
+    }
+
+    MpmcQueue(const MpmcQueue&) = delete;
+    MpmcQueue& operator=(const MpmcQueue&) = delete;
+
+    // 满了返回 false，这时 item 原样留在调用方手里
+    bool TryPush(T&& item) {
+        Cell* cell;
+        size_t pos = enqueuePos_.load(std::memory_order_relaxed);
+        while(true) {
+            cell = &cells_[pos & mask_];
+            size_t seq = cell->seq.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+            if(diff == 0) {
+                if(enqueuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if(diff < 0) {
+                // 这个槽上一圈的还没被取走：满了
+                return false;
+            } else {
+                pos = enqueuePos_.load(std::memory_order_relaxed);
+            }
+        }
+        new(&cell->storage) T(std::move(item));
+        cell->seq.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool TryPop(T& item) {
+        Cell* cell;
+        size_t pos = dequeuePos_.load(std::memory_order_relaxed);
+        while(true) {
+            cell = &cells_[pos & mask_];
+            size_t seq = cell->seq.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+            if(diff == 0) {
+                if(dequeuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if(diff < 0) {
+                return false;
+            } else {
+                pos = dequeuePos_.load(std::memory_order_relaxed);
+            }
+        }
+        T* slot = reinterpret_cast<T*>(&cell->storage);
+        item = std::move(*slot);
+        slot->~T();
+        // 留给下一圈的生产者
+        cell->seq.store(pos + mask_ + 1, std::memory_order_release);
+        return true;
+    }
+
+    size_t Capacity() const { return mask_ + 1; }
+
+    // 近似值：别的线程同时在进出时只能当参考
+    size_t SizeApprox() const {
+        size_t tail = enqueuePos_.load(std::memory_order_relaxed);
+        size_t head = dequeuePos_.load(std::memory_order_relaxed);
+        return tail > head ? tail - head : 0;
+    }
+
+private:
+    struct Cell {
+        std::atomic<size_t> seq;
+        typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+    };
+
+    std::unique_ptr<Cell[]> cells_;
+    size_t mask_;
+    // 生产者和消费者各改各的位置，隔开一条缓存行
+    char pad0_[64];
+    std::atomic<size_t> enqueuePos_;
+    char pad1_[64];
+    std::atomic<size_t> dequeuePos_;
+};
+
+#endif // MPMC_QUEUE_H
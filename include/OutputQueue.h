@@ -0,0 +1,85 @@
+#ifndef OUTPUT_QUEUE_H
+#define OUTPUT_QUEUE_H
+
+#include <climits>   // IOV_MAX
+#include <memory>
+#include <vector>
+#include <unistd.h>  // for ssize_t, off_t
+#include <sys/uio.h> // for iovec
+#include "ChainBuffer.h"
+
+// 一个连接的待发送数据 (rope)：按顺序排好的一串片段，每段各自决定内存归谁。
+//   - OWNED  ：拷进自己的 ChainBuffer 块里 (帧头、chunk 长度行这类零碎)
+//   - REF    ：直接指向外面的内存，由调用方保证发完之前有效 (响应头所在的 Buffer、静态字符串)
+//   - SHARED ：带引用计数的内存 (缓存条目的 body、广播消息)，这一段发完立刻放掉引用
+//   - FILE   ：文件区间，走 sendfile / splice，不进用户态
+// 组装响应只是往后接片段，不拷贝 body。发送时开头的内存段拼成 iovec (最多 IOV_MAX 段)
+// 一次 writev，排到文件段就换 sendfile。一个 OutputQueue 同一时刻只有一个线程在用
+class OutputQueue {
+public:
+    typedef std::shared_ptr<const void> Holder;
+
+    enum Kind {
+        OWNED,
+        REF,
+        SHARED,
+        FILE
+    };
+
+    struct Segment {
+        Kind kind;
+        const char* data;   // 内存段
+        int fd;             // 文件段：[offset, offset + len)
+        off_t offset;
+        size_t len;         // 还没发的字节数
+        Holder holder;      // SHARED / FILE：发完之前拿着
+    };
+
+    OutputQueue();
+    OutputQueue(const OutputQueue&) = delete;
+    OutputQueue& operator=(const OutputQueue&) = delete;
+
+    void Append(const void* data, size_t len);
+    // 在自己的块里要 len (<= ChainBuffer::BLOCK_SIZE) 字节连续空间，直接往里写 (pread)，
+    // 写完用 Commit 确认实际写了多少
+    char* Reserve(size_t len);
+    void Commit(size_t len);
+    void AppendRef(const void* data, size_t len);
+    void AppendShared(Holder holder, const void* data, size_t len);
+    void AppendFile(int fd, off_t offset, size_t len, Holder holder = Holder());
+
+    size_t Bytes() const { return bytes_; }
+    bool Empty() const { return bytes_ == 0; }
+    size_t SegmentCount() const { return segments_.size() - head_; }
+
+    // 开头连续的内存段 (到第一个文件段为止) 的字节数
+    size_t MemBytes() const { return memBytes_; }
+    // 开头连续的内存段按顺序填进 iov，最多 maxIov 段，返回填进去的字节数。
+    // 在 Advance / 追加之前 iov 里的地址都有效
+    size_t PeekIov(std::vector<struct iovec>* iov, size_t maxIov = IOV_MAX) const;
+    // 开头连续的内存段后面的那个文件段，没有返回 nullptr
+    const Segment* FirstFile() const;
+
+    // 已经发出去 len 字节 (io_uring 这种由别人代为发送的后端用)
+    void Advance(size_t len);
+    void Clear();
+
+    // 发一次：开头是内存就 writev (后面紧跟文件时用 sendmsg + MSG_MORE，和文件开头拼包)，
+    // 开头是文件就 sendfile。发了多少就消费多少
+    ssize_t WriteFd(int fd, int* Errno);
+
+private:
+    void Push_(Kind kind, const char* data, size_t len, Holder holder);
+    void FindFile_();
+
+    std::vector<Segment> segments_;
+    size_t head_;           // 第一个没发完的段
+    size_t firstFile_;      // 第一个文件段的下标，没有就是 segments_.size()
+    size_t bytes_;
+    size_t memBytes_;
+    ChainBuffer owned_;     // OWNED 段的数据，按段的顺序消费
+    char* reserved_;        // 上一次 Reserve 的位置
+    std::vector<struct iovec> iov_;  // WriteFd 用的，跨调用复用容量
+};
+
+#endif // OUTPUT_QUEUE_H
@@ -21,6 +21,7 @@ public:
     int Fd() const;
     void SetNonBlocking(); // 【面试核心】设置非阻塞
     void SetReuseAddr();   // 【面试核心】设置端口复用
+    void SetReusePort();   // SO_REUSEPORT：多个 socket 绑定同一端口，内核负载均衡
 
 private:
     int fd_;
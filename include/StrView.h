@@ -0,0 +1,72 @@
+#ifndef STR_VIEW_H
+#define STR_VIEW_H
+
+#include <string>
+#include <cstring>
+#include <strings.h>
+
+// 只读的字符串视图：一个指针加一个长度，不拥有内存。
+// 项目是 C++14，没有 std::string_view，这里只实现解析器用得到的那几个操作。
+class StrView {
+public:
+    static const size_t npos = static_cast<size_t>(-1);
+
+    StrView() : data_(nullptr), size_(0) {}
+    StrView(const char* data, size_t size) : data_(data), size_(size) {}
+    StrView(const char* str) : data_(str), size_(strlen(str)) {}
+    StrView(const std::string& str) : data_(str.data()), size_(str.size()) {}
+
+    const char* data() const { return data_; }
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    char operator[](size_t i) const { return data_[i]; }
+    const char* begin() const { return data_; }
+    const char* end() const { return data_ + size_; }
+
+    size_t find(char c, size_t pos = 0) const {
+        if(pos >= size_) return npos;
+        const void* p = memchr(data_ + pos, c, size_ - pos);
+        return p ? static_cast<const char*>(p) - data_ : npos;
+    }
+
+    size_t find(StrView s, size_t pos = 0) const {
+        if(pos > size_) return npos;
+        const void* p = memmem(data_ + pos, size_ - pos, s.data_, s.size_);
+        return p ? static_cast<const char*>(p) - data_ : npos;
+    }
+
+    StrView substr(size_t pos, size_t n = npos) const {
+        if(pos > size_) pos = size_;
+        if(n > size_ - pos) n = size_ - pos;
+        return StrView(data_ + pos, n);
+    }
+
+    // 去掉两头的空格和制表符 (HTTP 的 OWS)
+    StrView Trim() const {
+        size_t b = 0, e = size_;
+        while(b < e && (data_[b] == ' ' || data_[b] == '\t')) b++;
+        while(e > b && (data_[e - 1] == ' ' || data_[e - 1] == '\t')) e--;
+        return StrView(data_ + b, e - b);
+    }
+
+    bool StartsWith(StrView prefix) const {
+        return size_ >= prefix.size_ && (prefix.size_ == 0 || memcmp(data_, prefix.data_, prefix.size_) == 0);
+    }
+
+    bool EqualsIgnoreCase(StrView other) const {
+        return size_ == other.size_ && (size_ == 0 || strncasecmp(data_, other.data_, size_) == 0);
+    }
+
+    std::string ToString() const { return std::string(data_, size_); }
+
+    friend bool operator==(StrView a, StrView b) {
+        return a.size_ == b.size_ && (a.size_ == 0 || memcmp(a.data_, b.data_, a.size_) == 0);
+    }
+    friend bool operator!=(StrView a, StrView b) { return !(a == b); }
+
+private:
+    const char* data_;
+    size_t size_;
+};
+
+#endif // STR_VIEW_H
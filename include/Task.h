@@ -0,0 +1,121 @@
+#ifndef TASK_H
+#define TASK_H
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+// 线程池里跑的任务：只能移动的 void() 可调用对象。
+// 和 std::function 的区别：
+//   - 捕获不超过 INLINE_SIZE 字节的直接放在对象里，不上堆 ([this, conn, events] 这种只有 24 字节)
+//   - 不要求可拷贝，能装 unique_ptr、move 进来的 vector
+// 放不下的 (或者移动可能抛异常的) 才 new 一份，存指针
+class Task {
+public:
+    static const size_t INLINE_SIZE = 48;
+
+    Task() noexcept : ops_(nullptr) {}
+
+    template<class F, class = typename std::enable_if<
+                          !std::is_same<typename std::decay<F>::type, Task>::value>::type>
+    Task(F&& f) : ops_(nullptr) {
+        typedef typename std::decay<F>::type Fn;
+        Construct_<Fn>(std::forward<F>(f), std::integral_constant<bool, FitsInline_<Fn>()>());
+    }
+
+    Task(Task&& other) noexcept : ops_(other.ops_) {
+        if(ops_) {
+            ops_->move(&storage_, &other.storage_);
+            other.ops_ = nullptr;
+        }
+    }
+
+    Task& operator=(Task&& other) noexcept {
+        if(this != &other) {
+            Reset();
+            if(other.ops_) {
+                other.ops_->move(&storage_, &other.storage_);
+                ops_ = other.ops_;
+                other.ops_ = nullptr;
+            }
+        }
+        return *this;
+    }
+
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+
+    ~Task() { Reset(); }
+
+    void operator()() { ops_->invoke(&storage_); }
+    explicit operator bool() const { return ops_ != nullptr; }
+
+    void Reset() noexcept {
+        if(ops_) {
+            ops_->destroy(&storage_);
+            ops_ = nullptr;
+        }
+    }
+
+    // 可调用对象是不是直接放在对象里的 (测试用)
+    bool IsInline() const { return ops_ && ops_->isInline; }
+
+private:
+    struct Ops {
+        void (*invoke)(void* storage);
+        void (*move)(void* dst, void* src);   // 搬到 dst，并析构 src 里的
+        void (*destroy)(void* storage);
+        bool isInline;
+    };
+
+    template<class Fn>
+    static constexpr bool FitsInline_() {
+        return sizeof(Fn) <= INLINE_SIZE && alignof(Fn) <= alignof(std::max_align_t) &&
+               std::is_nothrow_move_constructible<Fn>::value;
+    }
+
+    template<class Fn>
+    struct InlineOps {
+        static void Invoke(void* s) { (*static_cast<Fn*>(s))(); }
+        static void Move(void* dst, void* src) {
+            Fn* from = static_cast<Fn*>(src);
+            new(dst) Fn(std::move(*from));
+            from->~Fn();
+        }
+        static void Destroy(void* s) { static_cast<Fn*>(s)->~Fn(); }
+        static const Ops table;
+    };
+
+    template<class Fn>
+    struct HeapOps {
+        static Fn*& Ptr(void* s) { return *static_cast<Fn**>(s); }
+        static void Invoke(void* s) { (*Ptr(s))(); }
+        static void Move(void* dst, void* src) { new(dst) Fn*(Ptr(src)); }
+        static void Destroy(void* s) { delete Ptr(s); }
+        static const Ops table;
+    };
+
+    template<class Fn, class F>
+    void Construct_(F&& f, std::true_type) {
+        new(&storage_) Fn(std::forward<F>(f));
+        ops_ = &InlineOps<Fn>::table;
+    }
+
+    template<class Fn, class F>
+    void Construct_(F&& f, std::false_type) {
+        new(&storage_) Fn*(new Fn(std::forward<F>(f)));
+        ops_ = &HeapOps<Fn>::table;
+    }
+
+    typename std::aligned_storage<INLINE_SIZE, alignof(std::max_align_t)>::type storage_;
+    const Ops* ops_;
+};
+
+template<class Fn>
+const Task::Ops Task::InlineOps<Fn>::table = {&Invoke, &Move, &Destroy, true};
+
+template<class Fn>
+const Task::Ops Task::HeapOps<Fn>::table = {&Invoke, &Move, &Destroy, false};
+
+#endif // TASK_H
@@ -1,85 +1,307 @@
 #ifndef THREADPOOL_H
 #define THREADPOOL_H
 
+#include <atomic>
 #include <mutex>
 #include <condition_variable>
-#include <queue>
 #include <thread>
 #include <functional>
+#include <memory>
 #include <vector>
-#include <iostream>
+#include <cstdint>
+#include "MpmcQueue.h"
+#include "Task.h"
 
+// Chase–Lev 工作窃取双端队列 (Lê 等人 2013 年的 C11 内存序版本)。
+// 只有所属的工作线程在底部 Push / Pop，其他线程从顶部 Steal，都不加锁。
+// 槽里存的是指针：窃取方读槽和所属线程写槽可能同时发生，读到的旧值在 CAS 失败时丢掉，
+// 指针可以原子读写，Task 不行
+template<class T>
+class WorkStealingDeque {
+public:
+    explicit WorkStealingDeque(size_t capacity = 256) : top_(0), bottom_(0) {
+        arrays_.emplace_back(new Array(capacity));
+        array_.store(arrays_.back().get(), std::memory_order_relaxed);
+    }
+
+    WorkStealingDeque(const WorkStealingDeque&) = delete;
+    WorkStealingDeque& operator=(const WorkStealingDeque&) = delete;
+
+    // 所属线程
+    void Push(T* item) {
+        int64_t b = bottom_.load(std::memory_order_relaxed);
+        int64_t t = top_.load(std::memory_order_acquire);
+        Array* a = array_.load(std::memory_order_relaxed);
+        if(b - t > static_cast<int64_t>(a->size) - 1) {
+            a = Grow_(a, t, b);
+        }
+        a->Put(b, item);
+        std::atomic_thread_fence(std::memory_order_release);
+        bottom_.store(b + 1, std::memory_order_relaxed);
+    }
+
+    // 所属线程：后进先出，刚派出去的任务数据还在缓存里
+    T* Pop() {
+        int64_t b = bottom_.load(std::memory_order_relaxed) - 1;
+        Array* a = array_.load(std::memory_order_relaxed);
+        bottom_.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t t = top_.load(std::memory_order_relaxed);
+        if(t > b) {
+            bottom_.store(b + 1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        T* item = a->Get(b);
+        if(t == b) {
+            // 只剩最后一个：和窃取方抢
+            if(!top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+                item = nullptr;
+            }
+            bottom_.store(b + 1, std::memory_order_relaxed);
+        }
+        return item;
+    }
+
+    // 任意线程：先进先出。空的或者被别人抢先都返回 nullptr
+    T* Steal() {
+        int64_t t = top_.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t b = bottom_.load(std::memory_order_acquire);
+        if(t >= b) {
+            return nullptr;
+        }
+        Array* a = array_.load(std::memory_order_acquire);
+        T* item = a->Get(t);
+        if(!top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+            return nullptr;
+        }
+        return item;
+    }
+
+    bool Empty() const {
+        return bottom_.load(std::memory_order_relaxed) <= top_.load(std::memory_order_relaxed);
+    }
+
+private:
+    struct Array {
+        size_t size;    // 2 的幂
+        std::unique_ptr<std::atomic<T*>[]> slots;
+        explicit Array(size_t n) : size(n), slots(new std::atomic<T*>[n]) {}
+        T* Get(int64_t i) const { return slots[i & (size - 1)].load(std::memory_order_relaxed); }
+        void Put(int64_t i, T* item) { slots[i & (size - 1)].store(item, std::memory_order_relaxed); }
+    };
+
+    Array* Grow_(Array* old, int64_t t, int64_t b) {
+        Array* bigger = new Array(old->size * 2);
+        for(int64_t i = t; i < b; i++) {
+            bigger->Put(i, old->Get(i));
+        }
+        // 窃取方可能还在读旧数组，旧的留到析构再放
+        arrays_.emplace_back(bigger);
+        array_.store(bigger, std::memory_order_release);
+        return bigger;
+    }
+
+    // top_ 是窃取方改的，bottom_ 是所属线程改的，中间隔开一条缓存行免得互相拖累。
+    // 用填充不用 alignas：C++14 的 new 不保证超过 16 字节的对齐
+    std::atomic<int64_t> top_;
+    char pad_[64];
+    std::atomic<int64_t> bottom_;
+    std::atomic<Array*> array_;
+    std::vector<std::unique_ptr<Array>> arrays_;  // 只有所属线程改
+};
+
+// 工作窃取线程池：
+//   - 每个工作线程一个 WorkStealingDeque。任务里再派的任务压进自己的队列底部
+//   - 外面的线程 (事件循环) 派的任务轮流放进各个工作线程的收件箱：有界的无锁 MpmcQueue，
+//     Task 把捕获放在自己肚子里，派一个任务不碰锁也不 new
+//   - 收件箱都满了 AddTask 返回 false (Rejected() 计数)，由调用方决定是自己做还是丢掉，
+//     过载时队列不会无限涨
+//   - 没活干的线程先看自己的队列和收件箱，再去偷别人的，转几圈还没有才睡
+//   - 派任务时只有确实有线程睡着才 notify，忙的时候不碰条件变量
 class ThreadPool {
 public:
     // explicit: 防止 ThreadPool pool = 10; 这种隐式转换
-    explicit ThreadPool(size_t threadCount = 8) : isClosed_(false) {
+    // queueCapacity：所有收件箱加起来能排多少个外部任务
+    explicit ThreadPool(size_t threadCount = 8, size_t queueCapacity = 4096)
+        : isClosed_(false), pending_(0), rejected_(0), idle_(0), next_(0),
+          // 只有一个核时空转只会和派任务的线程抢 CPU
+          spinRounds_(std::thread::hardware_concurrency() > 1 ? SPIN_ROUNDS : 1) {
+        if(threadCount == 0) {
+            threadCount = 1;
+        }
+        size_t perWorker = queueCapacity / threadCount;
         for(size_t i = 0; i < threadCount; i++) {
-            // [this]: Lambda 捕获当前对象指针，以便访问 private 成员
-            workers_.emplace_back([this]() {
-                while(true) {
-                    std::function<void()> task;
-                    {
-                        // unique_lock: 支持 wait 过程中的解锁和重新加锁
-                        std::unique_lock<std::mutex> locker(mtx_);
-                        
-                        // 等待条件：要么关门了，要么有任务了
-                        // 这里的 Lambda 防止虚假唤醒
-                        cond_.wait(locker, [this]{ 
-                            return isClosed_ || !tasks_.empty(); 
-                        });
-
-                        // 收到停止信号且任务队列为空，线程退出
-                        if(isClosed_ && tasks_.empty()) {
-                            return;
-                        }
-
-                        // 取出任务 (std::move 减少拷贝)
-                        task = std::move(tasks_.front());
-                        tasks_.pop();
-                    } 
-                    // 出了作用域，unique_lock 自动解锁
-                    // 必须在解锁后执行任务，否则所有任务串行化，线程池失去意义
-                    task(); 
-                }
-            });
+            workers_.emplace_back(new Worker(perWorker));
+        }
+        for(size_t i = 0; i < threadCount; i++) {
+            threads_.emplace_back(&ThreadPool::Run_, this, i);
         }
     }
 
     ~ThreadPool() {
         {
-            std::lock_guard<std::mutex> locker(mtx_);
+            std::lock_guard<std::mutex> locker(parkMtx_);
             isClosed_ = true;
         }
-        // 唤醒所有线程，让它们检查 isClosed_ 标志并退出
-        cond_.notify_all();
-
-        for(std::thread& worker : workers_) {
-            if(worker.joinable()) {
-                worker.join(); // 等待线程真正结束
+        // 唤醒所有线程：手上的任务做完再退出
+        parkCond_.notify_all();
+        for(std::thread& thread : threads_) {
+            if(thread.joinable()) {
+                thread.join();
             }
         }
     }
 
-    template<class F, class... Args>
-    void AddTask(F&& f, Args&&... args) {
-        // 1. 完美转发参数，并绑定成无参函数对象
-        auto task = std::bind(std::forward<F>(f), std::forward<Args>(args)...);
-        
-        {
-            std::lock_guard<std::mutex> locker(mtx_);
-            tasks_.emplace(task);
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // 收件箱都满了返回 false，任务不会执行
+    bool AddTask(Task task) {
+        // 先记数再放：工作线程取走时减，不会减到 0 以下
+        pending_.fetch_add(1);
+        Slot& current = Current_();
+        if(current.pool == this) {
+            // 本池的工作线程：压进自己的队列，别人闲着会来偷。
+            // 任务里派任务很少见，这条路上还是 new 一个节点，也不设上限
+            workers_[current.index]->deque.Push(new Task(std::move(task)));
+        } else if(!PushInbox_(task)) {
+            pending_.fetch_sub(1);
+            rejected_.fetch_add(1, std::memory_order_relaxed);
+            return false;
         }
-        // 2. 唤醒一个空闲线程去处理
-        cond_.notify_one();
+        // 和 Park_ 里的 idle_++ / 读 pending_ 配对 (都是 seq_cst)：要么它看到新任务不睡，
+        // 要么这里看到有人睡着去叫醒
+        if(idle_.load() > 0) {
+            std::lock_guard<std::mutex> locker(parkMtx_);
+            parkCond_.notify_one();
+        }
+        return true;
+    }
+
+    // 带参数的：绑成无参的再派
+    template<class F, class Arg, class... Args>
+    bool AddTask(F&& f, Arg&& arg, Args&&... args) {
+        return AddTask(Task(std::bind(std::forward<F>(f), std::forward<Arg>(arg), std::forward<Args>(args)...)));
     }
 
+    size_t ThreadCount() const { return threads_.size(); }
+    // 派出去还没被取走的任务数
+    size_t Queued() const { return pending_.load(std::memory_order_relaxed); }
+    // 收件箱满了被拒绝的次数
+    size_t Rejected() const { return rejected_.load(std::memory_order_relaxed); }
+
+    // 睡着之前空转找活的轮数
+    static const int SPIN_ROUNDS = 64;
+
 private:
-    std::vector<std::thread> workers_;
-    std::queue<std::function<void()>> tasks_;
-    
-    std::mutex mtx_;
-    std::condition_variable cond_;
+    struct Worker {
+        explicit Worker(size_t capacity) : inbox(capacity) {}
+        WorkStealingDeque<Task> deque;
+        MpmcQueue<Task> inbox;
+    };
+
+    // 当前线程是哪个池的第几个工作线程
+    struct Slot {
+        ThreadPool* pool = nullptr;
+        size_t index = 0;
+    };
+    static Slot& Current_() {
+        static thread_local Slot slot;
+        return slot;
+    }
+
+    static void CpuRelax_() {
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#else
+        std::this_thread::yield();
+#endif
+    }
+
+    // 从轮到的收件箱开始，满了换下一个，全满才算失败
+    bool PushInbox_(Task& task) {
+        size_t n = workers_.size();
+        size_t start = next_.fetch_add(1, std::memory_order_relaxed);
+        for(size_t i = 0; i < n; i++) {
+            if(workers_[(start + i) % n]->inbox.TryPush(std::move(task))) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void Run_(size_t index) {
+        Current_() = Slot{this, index};
+        Task task;
+        while(true) {
+            bool found = false;
+            for(int spin = 0; !found && spin < spinRounds_; spin++) {
+                found = Find_(index, task);
+                if(!found) {
+                    if(spinRounds_ > 1) CpuRelax_();
+                    else std::this_thread::yield();
+                }
+            }
+            if(!found) {
+                if(!Park_()) {
+                    return;
+                }
+                continue;
+            }
+            pending_.fetch_sub(1);
+            task();
+            // 捕获的东西 (连接指针、shared_ptr) 现在就放掉，不留到下一个任务
+            task.Reset();
+        }
+    }
+
+    bool Find_(size_t index, Task& task) {
+        Worker& self = *workers_[index];
+        if(Task* node = self.deque.Pop()) {
+            task = std::move(*node);
+            delete node;
+            return true;
+        }
+        if(self.inbox.TryPop(task)) {
+            return true;
+        }
+        // 偷别人的：从下一个开始转一圈，先偷队列，再偷收件箱 (主人正忙着做长任务的那种)
+        size_t n = workers_.size();
+        for(size_t i = 1; i < n; i++) {
+            Worker& victim = *workers_[(index + i) % n];
+            if(Task* node = victim.deque.Steal()) {
+                task = std::move(*node);
+                delete node;
+                return true;
+            }
+            if(victim.inbox.TryPop(task)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // 没活了：睡到有新任务。关门且所有任务都做完时返回 false，线程退出
+    bool Park_() {
+        std::unique_lock<std::mutex> locker(parkMtx_);
+        idle_.fetch_add(1);
+        parkCond_.wait(locker, [this] { return isClosed_ || pending_.load() > 0; });
+        idle_.fetch_sub(1);
+        return !(isClosed_ && pending_.load() == 0);
+    }
+
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::vector<std::thread> threads_;
+
+    std::mutex parkMtx_;
+    std::condition_variable parkCond_;
     bool isClosed_;
+    std::atomic<size_t> pending_;   // 派出去还没被取走的任务数
+    std::atomic<size_t> rejected_;
+    std::atomic<int> idle_;         // 睡着的线程数
+    std::atomic<size_t> next_;      // 外部派任务轮流选收件箱
+    const int spinRounds_;
 };
 
-#endif // THREADPOOL_H
\ No newline at end of file
+#endif // THREADPOOL_H
@@ -0,0 +1,97 @@
+#ifndef URING_LOOP_H
+#define URING_LOOP_H
+
+#include <unordered_map>
+#include <sys/socket.h>
+#include "EventLoop.h"
+#include "IoUring.h"
+#include "http/HttpConn.h"
+
+// io_uring 后端：完成通知
+//   - multishot accept：一个 SQE 持续产出新连接
+//   - multishot recv + provided buffer ring：内核自己挑缓冲区，不用每次 readv
+//   - sendmsg 与 shutdown 链接 (IOSQE_IO_LINK)：短连接发完自动半关闭，不用再回用户态
+//   - 短写由内核 MSG_WAITALL 补齐，仍不完整就从断点重新提交；积压超过高水位时取消 recv
+//   - 大文件用 splice 文件 -> pipe -> socket，和响应头 sendmsg (MSG_MORE) 链成一串提交
+// 整个 loop 只在 io_uring_enter 里阻塞，一次系统调用完成"提交 + 等待"。
+// 线程池对完成通知没有意义，这个后端总是在本线程处理请求。
+class UringLoop : public EventLoop {
+public:
+    explicit UringLoop(int timeoutMs = 60000);
+    ~UringLoop() override = default;
+
+    bool Valid() const { return valid_; }
+
+    void Loop() override;
+    void AddConn(int fd, const sockaddr_in& addr) override;
+
+private:
+    enum OpType {
+        OP_ACCEPT = 1,
+        OP_RECV,
+        OP_SEND,
+        OP_SPLICE_IN,       // 文件 -> pipe
+        OP_SPLICE_OUT,      // pipe -> socket
+        OP_SHUTDOWN,
+        OP_CANCEL,
+        OP_WAKEUP
+    };
+
+    struct Conn {
+        HttpConn http;
+        struct msghdr msg;
+        std::vector<struct iovec> iov;  // sendmsg 在内核里的时候一直要用
+        int inflight;       // 还在内核里的请求数，归零才能真正 close(fd)
+        bool recvArmed;
+        bool recvPaused;    // 待发送数据超过高水位，取消了 recv
+        bool recvCancelPending;  // 取消已经发出，recv 最后一个 CQE 还没回来
+        int sendOps;        // 本轮还没完成的发送类请求 (send / splice)
+        bool closing;
+        // 大文件零拷贝：io_uring 没有 sendfile，用 splice 文件 -> pipe -> socket 代替
+        int pipe[2];
+        size_t pipeBytes;   // 已经搬进 pipe、还没发出去的字节
+        size_t pipeCap;
+        Conn() : sendOps(0), closing(false), pipeBytes(0), pipeCap(0) { pipe[0] = pipe[1] = -1; }
+    };
+
+    static uint64_t UserData_(OpType op, int fd) {
+        return (static_cast<uint64_t>(op) << 32) | static_cast<uint32_t>(fd);
+    }
+
+    io_uring_sqe* Sqe_();
+    void ArmAccept_();
+    void ArmWakeup_();
+    void ArmRecv_(Conn& conn);
+    void PauseRecv_(Conn& conn);
+    void ResumeRecv_(Conn& conn);
+    bool CheckReadRoom_(Conn& conn);
+    void SubmitSend_(Conn& conn);
+
+    void HandleCqe_(const io_uring_cqe* cqe);
+    void OnAccept_(const io_uring_cqe* cqe);
+    void OnRecv_(Conn& conn, const io_uring_cqe* cqe);
+    void OnSend_(Conn& conn, OpType op, int res);
+    bool OpenPipe_(Conn& conn);
+    void ClosePipe_(Conn& conn);
+    void Process_(Conn& conn);
+
+    void CloseConn_(int fd);      // 定时器回调：发起关闭
+    int KeepAlive_(int fd) override;  // 定时器到期前：WebSocket 连接发 ping 续期
+    void ReleaseIdle_() override;
+    void OnPush_(Subscriber& sub) override;
+    void TryRelease_(Conn& conn); // 内核不再引用该连接时真正释放
+
+    static const unsigned BUF_GROUP = 0;
+    static const unsigned BUF_COUNT = 512;      // 必须是 2 的幂
+    static const size_t BUF_SIZE = 8192;
+    static const size_t PIPE_PAGE = 4096;       // pipe 每个槽放一页
+
+    IoUring ring_;
+    bool valid_;
+    bool multishotAccept_;
+    bool multishotRecv_;
+    // fd -> 连接。关闭后不删除，同一个 fd 的下一个连接直接复用
+    std::unordered_map<int, Conn> conns_;
+};
+
+#endif // URING_LOOP_H
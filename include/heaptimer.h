@@ -11,6 +11,8 @@
 #include <chrono>
 
 typedef std::function<void()> TimeoutCallBack;
+// 到期前问一下：返回 > 0 表示这个连接还要留着 (例如 WebSocket 刚排了 ping)，按返回的毫秒数续期，不执行回调
+typedef std::function<int(int id)> ExpireHook;
 typedef std::chrono::high_resolution_clock Clock;
 typedef std::chrono::milliseconds MS;
 typedef Clock::time_point TimeStamp;
@@ -38,9 +40,11 @@ public:
     // 添加定时器
     void add(int id, int timeOut, const TimeoutCallBack& cb);
 
-    // 删除某个连接的定时器
+    // 执行回调并删除定时器 (强制关闭，不经过 ExpireHook)
     void doWork(int id);
 
+    void SetExpireHook(const ExpireHook& hook) { expireHook_ = hook; }
+
     // 核心逻辑：清除所有超时节点
     void tick();
 
@@ -67,6 +71,8 @@ private:
     // 为什么需要它？
     // 因为我们要通过 socket fd 快速找到它在 heap_ 数组里的下标，否则查找是 O(N)
     std::unordered_map<int, size_t> ref_; 
+
+    ExpireHook expireHook_;
 };
 
 #endif // HEAP_TIMER_H
\ No newline at end of file
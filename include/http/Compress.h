@@ -0,0 +1,30 @@
+#ifndef COMPRESS_H
+#define COMPRESS_H
+
+#include <string>
+#include "StrView.h"
+
+// 内容编码。既当 Accept-Encoding 的位掩码用，也标记缓存条目是哪种编码
+enum Encoding {
+    ENC_IDENTITY = 0,
+    ENC_GZIP     = 1 << 0,
+    ENC_BR       = 1 << 1,
+};
+
+// 压缩工具：依赖 zlib / brotli，编译时没找到对应的库就返回 false
+class Compress {
+public:
+    static bool Available(Encoding enc);
+    static bool Encode(Encoding enc, const std::string& in, std::string* out);
+
+    static const char* Name(Encoding enc);       // Content-Encoding 的值
+    static const char* Suffix(Encoding enc);     // 预压缩文件的后缀：".gz" / ".br"
+
+    // 解析 Accept-Encoding，返回客户端接受的编码掩码 (q=0 的不算)
+    static int ParseAccept(StrView header);
+
+    // 文本类 Content-Type 才值得压缩，图片 / 视频本身已经压过了
+    static bool IsCompressible(const std::string& type);
+};
+
+#endif // COMPRESS_H
@@ -0,0 +1,129 @@
+#ifndef EVENT_HUB_H
+#define EVENT_HUB_H
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "Buffer.h"
+#include "StrView.h"
+
+class HttpRequest;
+class RouteParams;
+class Subscriber;
+
+// 发布出去的一条消息，已经按协议编码好 (SSE 的一个 chunk / WebSocket 的一帧)。
+// 所有订阅者共用这一份，各连接的 iovec 直接指向它，最后一个发完的连接释放
+typedef std::shared_ptr<const std::string> SharedPayload;
+
+// 订阅者所在的事件循环。发布时按循环分组，每个循环只唤醒一次，
+// 在循环自己的线程里把这一组连接的输出发出去
+class PushTarget {
+public:
+    virtual ~PushTarget() {}
+    // 任意线程调用
+    virtual void Push(std::vector<std::shared_ptr<Subscriber>> subs) = 0;
+};
+
+// 一个长连接 (SSE 或 WebSocket) 的订阅：订了哪些频道，加上发布过来、还没被连接取走的消息。
+// 连接关闭时 Detach，之后对它的发布和唤醒都不再生效
+class Subscriber : public std::enable_shared_from_this<Subscriber> {
+public:
+    enum Format {
+        SSE,
+        WEBSOCKET,
+    };
+
+    Subscriber(Format format, int fd, PushTarget* target)
+        : format_(format), fd_(fd), target_(target), pendingBytes_(0),
+          scheduled_(false), overflow_(false), closed_(false) {}
+
+    // 任意线程
+    void Subscribe(StrView channel);
+    void Unsubscribe(StrView channel);
+    void Detach();
+
+    // 连接线程：取走积压的消息，追加到 out 后面。积压超过 EventHub::maxPendingBytes
+    // (对端收得太慢) 时返回 false，积压已经丢掉，连接该结束了
+    bool Take(std::vector<SharedPayload>* out);
+
+    Format GetFormat() const { return format_; }
+    int Fd() const { return fd_; }
+    PushTarget* Target() const { return target_; }
+    bool IsClosed() const { return closed_; }
+
+private:
+    friend class EventHub;
+
+    // 发布线程：排进队列，之前是空闲的 (需要唤醒连接) 返回 true
+    bool Enqueue_(const SharedPayload& payload);
+
+    const Format format_;
+    const int fd_;
+    PushTarget* const target_;
+
+    std::mutex mtx_;
+    std::vector<SharedPayload> pending_;
+    size_t pendingBytes_;
+    bool scheduled_;            // 已经唤醒过，连接还没来取
+    bool overflow_;
+    std::atomic<bool> closed_;
+
+    // 在各频道订阅者数组里的下标，退订时 O(1) 删除。受 EventHub 的锁保护
+    std::vector<std::pair<std::string, size_t>> slots_;
+};
+
+// SSE 连接在 onOpen 里拿到的句柄：订阅频道，或者先发几条只给这个连接的事件
+class EventStream {
+public:
+    EventStream(Subscriber& sub, Buffer& out) : sub_(sub), out_(out) {}
+
+    void Subscribe(StrView channel) { sub_.Subscribe(channel); }
+    void Send(StrView data, StrView event = StrView(), StrView id = StrView());
+
+private:
+    Subscriber& sub_;
+    Buffer& out_;
+};
+
+// SSE 端点的处理函数 (Router::Sse)
+typedef std::function<void(const HttpRequest& request, const RouteParams& params,
+                           EventStream& stream)> SseHandler;
+
+// 频道 -> 订阅者。发布的时候每种格式只编码一次，投递给每个订阅者只是排一个指针，
+// 扇出的开销随连接数增长，和消息大小无关
+class EventHub {
+public:
+    static EventHub* Instance();
+
+    // 任意线程。SSE 订阅者收到 event / id / data 组成的事件，WebSocket 订阅者收到 data 的文本帧。
+    // 返回投递到的订阅者个数
+    size_t Publish(StrView channel, StrView data, StrView event = StrView(), StrView id = StrView());
+    size_t Subscribers(StrView channel);
+
+    // SSE 事件按 chunked 编码成一块，data 里的换行拆成多行 "data:"
+    static void AppendSse(Buffer& out, StrView data, StrView event, StrView id);
+
+    // 单个连接积压的上限 (默认 4MB)，超过就断开这个慢连接，不让它拖住内存
+    static size_t maxPendingBytes;
+
+    EventHub() = default;
+    EventHub(const EventHub&) = delete;
+    EventHub& operator=(const EventHub&) = delete;
+
+private:
+    friend class Subscriber;
+
+    void Add_(const std::shared_ptr<Subscriber>& sub, StrView channel);
+    void Remove_(Subscriber* sub, StrView channel);
+    void RemoveAt_(const std::string& channel, size_t index);
+
+    std::mutex mtx_;
+    std::unordered_map<std::string, std::vector<std::shared_ptr<Subscriber>>> channels_;
+};
+
+#endif // EVENT_HUB_H
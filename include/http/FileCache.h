@@ -0,0 +1,110 @@
+#ifndef FILE_CACHE_H
+#define FILE_CACHE_H
+
+#include <atomic>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <sys/stat.h>
+#include "http/Compress.h"
+
+// 缓存里的一个文件。创建后只读，多个连接通过 shared_ptr 共享；
+// 被淘汰或失效时，正在发送它的连接手里那份引用不受影响。
+struct FileEntry {
+    FileEntry();
+    ~FileEntry();
+
+    FileEntry(const FileEntry&) = delete;
+    FileEntry& operator=(const FileEntry&) = delete;
+
+    std::string file;       // 绝对路径 (压缩版本也记原文件的路径)
+    Encoding encoding;      // 内容编码：原文件是 ENC_IDENTITY
+    bool exists;            // stat 成功 (不存在的路径也缓存，404 不用每次 stat)；
+                            // 压缩版本里表示"有这个编码的内容可用"
+    struct stat st;
+    std::string body;       // 小文件：整个内容读进内存
+    int fd;                 // 大文件：常驻的只读 fd，给 sendfile / splice 用，-1 表示没有
+    std::string header;     // 预先拼好的 "Content-type: ...\r\nContent-length: ...\r\n\r\n"
+    std::string etag;       // 强 ETag："inode-size-mtime"，压缩版本再带上编码名
+    std::string lastModified;
+    bool statOnly;          // Peek 返回的临时条目：只有 stat 结果，没有内容
+
+    bool IsDir() const { return exists && S_ISDIR(st.st_mode); }
+    bool IsReadable() const { return exists && (st.st_mode & S_IROTH); }
+    size_t Size() const { return exists ? static_cast<size_t>(st.st_size) : 0; }
+    bool HasContent() const { return !body.empty() || fd >= 0; }
+    size_t Charge() const;  // 计入缓存预算的字节数
+};
+
+// 静态文件缓存：按路径分片，每片一把锁、一条 LRU 链，总共按字节数限额。
+// 命中时不产生任何文件系统调用；资源目录下的变动由后台线程通过 inotify 通知，
+// 把对应的条目踢掉，下次请求重新加载。
+// 同一个文件的 gzip / br 版本和原文件放在同一个分片里，原文件或 .gz/.br 变了一起失效。
+class FileCache {
+public:
+    typedef std::shared_ptr<const FileEntry> EntryPtr;
+
+    static FileCache* Instance();
+
+    // 监视 root 及其子目录，capacity 为 0 时不缓存 (每次请求都重新加载)
+    bool Init(const std::string& root, size_t capacity);
+
+    // path 是相对资源根目录的请求路径 (以 '/' 开头)，永远返回非空。
+    // enc 不是 ENC_IDENTITY 时取压缩版本：优先用磁盘上的 path.gz / path.br，
+    // 没有的话 (且开了 compressText) 把文本文件压缩一次缓存起来
+    EntryPtr Get(const std::string& path, Encoding enc = ENC_IDENTITY);
+    // 只要 stat 信息 (条件请求用)：缓存里有就直接返回，没有就只 stat 一下，不打开文件也不进缓存
+    EntryPtr Peek(const std::string& path);
+
+    // 原文件的 ETag 加上编码名，得到压缩版本的 ETag
+    static std::string ETagOf(const std::string& etag, Encoding enc);
+
+    void Invalidate(const std::string& file); // file 是绝对路径
+    void Clear();
+
+    size_t Bytes() const;
+
+    // 没有预压缩文件时是否现场压缩文本文件
+    static bool compressText;
+
+private:
+    FileCache();
+    ~FileCache();
+
+    static const int SHARD_NUM = 16;
+
+    struct Shard {
+        mutable std::mutex mtx;
+        std::list<std::shared_ptr<FileEntry>> lru;  // 表头最近使用
+        std::unordered_map<std::string, std::list<std::shared_ptr<FileEntry>>::iterator> index;
+        size_t bytes = 0;
+        uint64_t generation = 0;                    // 每次失效 +1，防止把加载期间被改掉的旧内容插回去
+    };
+
+    Shard& ShardOf_(const std::string& key);
+    void EvictLocked_(Shard& shard);
+    void EraseLocked_(Shard& shard, const std::string& key);
+    void InvalidateFile_(const std::string& file);
+    static std::string KeyOf_(const std::string& file, Encoding enc);
+    static std::string Normalize_(const std::string& path);
+    std::shared_ptr<FileEntry> Load_(const std::string& file) const;
+    static void Stat_(FileEntry* entry);
+    std::shared_ptr<FileEntry> LoadEncoded_(const std::string& path, const std::string& file, Encoding enc);
+
+    void AddWatch_(const std::string& dir);
+    void WatchLoop_();
+
+    std::string root_;
+    size_t shardCapacity_;
+    Shard shards_[SHARD_NUM];
+
+    int inotifyFd_;
+    int stopFd_;
+    std::unordered_map<int, std::string> watchDirs_;  // wd -> 目录，只在 Init 和监视线程里访问
+    std::thread watcher_;
+};
+
+#endif // FILE_CACHE_H
@@ -0,0 +1,108 @@
+#ifndef HPACK_H
+#define HPACK_H
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+#include "StrView.h"
+
+// HTTP/2 的头部压缩 (RFC 7541)：61 项静态表 + 按字节数限额的动态表 + 静态 Huffman 编码。
+// 编码器和解码器各自维护一张动态表，分别对应连接两个方向，不能混用。
+
+struct HpackHeader {
+    std::string name;
+    std::string value;
+};
+
+class Hpack {
+public:
+    // 表项大小按 RFC 算：名字 + 值 + 32
+    static size_t EntrySize(size_t nameLen, size_t valueLen) { return nameLen + valueLen + 32; }
+
+    static const size_t STATIC_COUNT = 61;
+    // 1-based，和 RFC 附录 A 的编号一致
+    static StrView StaticName(size_t index);
+    static StrView StaticValue(size_t index);
+
+    // Huffman 编码后的字节数
+    static size_t HuffmanLength(StrView s);
+    static void HuffmanEncode(StrView s, std::string* out);
+    // 填充不是全 1、超过 7 位、或者解出 EOS 都算错
+    static bool HuffmanDecode(const uint8_t* p, size_t len, std::string* out);
+
+    // 整数编码：prefix 位的前缀，first 是首字节里前缀之外的那几位 (表示类型)
+    static void EncodeInt(uint32_t value, int prefix, uint8_t first, std::string* out);
+    // 解出来的值超过 2^28 当作错误，防止溢出
+    static bool DecodeInt(const uint8_t** p, const uint8_t* end, int prefix, uint32_t* value);
+};
+
+// 一个方向上的动态表：新表项插在前面，超过限额从后面淘汰
+class HpackTable {
+public:
+    explicit HpackTable(size_t maxSize = 4096) : size_(0), maxSize_(maxSize) {}
+
+    // index 从 1 开始，包括静态表的 61 项
+    bool Get(size_t index, StrView* name, StrView* value) const;
+    void Add(StrView name, StrView value);
+    void SetMaxSize(size_t maxSize);
+    size_t MaxSize() const { return maxSize_; }
+    size_t Size() const { return size_; }
+    size_t Count() const { return entries_.size(); }
+    const HpackHeader& Entry(size_t i) const { return entries_[i]; }  // 0 是最新的
+    void Clear() { entries_.clear(); size_ = 0; }
+
+private:
+    void Evict_(size_t need);
+
+    std::deque<HpackHeader> entries_;
+    size_t size_;
+    size_t maxSize_;
+};
+
+class HpackDecoder {
+public:
+    // maxTableSize：我们在 SETTINGS_HEADER_TABLE_SIZE 里告诉对端的上限；
+    // maxListSize：SETTINGS_MAX_HEADER_LIST_SIZE，解出来的头部按 名字 + 值 + 32 累加不能超过它
+    explicit HpackDecoder(size_t maxTableSize = 4096, size_t maxListSize = SIZE_MAX)
+        : table_(maxTableSize), limit_(maxTableSize), maxListSize_(maxListSize) {}
+
+    // 解一个完整的头部块 (HEADERS + CONTINUATION 拼起来)。
+    // 出错返回 false，调用方要按 COMPRESSION_ERROR 关掉整个连接：动态表已经不同步了。
+    // 解出来的头部超过 maxListSize 时 *tooLarge 为 true，headers 是空的：超出之后的头部不再拷出来
+    // (一个 1 字节的索引就能引用一个 4KB 的表项，64KB 的块能解出几百 MB)，但整个块照样解完，
+    // 带索引的字面量照样进动态表，和对端保持同步
+    bool Decode(const uint8_t* p, size_t len, std::vector<HpackHeader>* headers, bool* tooLarge);
+    void Reset() { table_.Clear(); table_.SetMaxSize(limit_); }
+
+private:
+    bool ReadString_(const uint8_t** p, const uint8_t* end, std::string* out);
+
+    HpackTable table_;
+    size_t limit_;
+    size_t maxListSize_;
+};
+
+class HpackEncoder {
+public:
+    HpackEncoder() : table_(4096), pendingUpdate_(false) {}
+
+    // 对端 SETTINGS_HEADER_TABLE_SIZE 变了：我们最多用 4096，变小时下一个头部块开头带上大小更新
+    void SetPeerMaxTableSize(size_t size);
+    // 每个头部块开始前调用
+    void Begin(std::string* out);
+    // index 为 false 时不进动态表 (每次都不一样的值，例如 content-length、etag)
+    void Encode(StrView name, StrView value, bool index, std::string* out);
+    void Reset() { table_.Clear(); table_.SetMaxSize(4096); pendingUpdate_ = false; }
+
+private:
+    // 在静态表 + 动态表里找：返回完全匹配的下标，或者只有名字匹配的下标 (都没有为 0)
+    size_t Find_(StrView name, StrView value, bool* exact) const;
+    static void WriteString_(StrView s, std::string* out);
+
+    HpackTable table_;
+    bool pendingUpdate_;
+};
+
+#endif // HPACK_H
@@ -0,0 +1,171 @@
+#ifndef HTTP2_SESSION_H
+#define HTTP2_SESSION_H
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+#include "Buffer.h"
+#include "OutputQueue.h"
+#include "http/Hpack.h"
+#include "http/HttpRequest.h"
+#include "http/HttpResponse.h"
+#include "http/Router.h"
+
+// 一条 h2c (明文 HTTP/2，prior knowledge) 连接的协议状态。HttpConn 在连接开头认出前言之后
+// 把读缓冲区交给它，自己只管收发字节。
+//
+// 每个流的请求头解出来以后拼回一段 HTTP/1.1 请求交给 HttpRequest 解析，再走和 HTTP/1 一样的
+// 路由 / 静态文件逻辑；响应由 HttpResponse 生成 HTTP/1.1 的头部，这里翻译成 HPACK。
+// 这样缓存、Range、304、压缩、动态路由都不用为 HTTP/2 再写一遍。
+//
+// 帧直接写进连接的输出队列：帧头、HEADERS 拷进队列自己的块里，内存里的 body
+// 直接引用缓存条目 / 动态 body，不拷贝；大文件按窗口直接 pread 进队列的块里。
+class Http2Session {
+public:
+    // 客户端连接前言
+    static const char PREFACE[];
+    static const size_t PREFACE_LEN = 24;
+
+    // 缓冲区开头是不是连接前言：1 是，0 不是，-1 还不够长 (已有的字节和前言一致)
+    static int MatchPreface(const Buffer& buff);
+
+    // 我们这边的设置
+    static const uint32_t MAX_CONCURRENT_STREAMS = 256;
+    static const uint32_t INITIAL_WINDOW = 1 << 20;       // 每个流的接收窗口
+    static const uint32_t CONNECTION_WINDOW = 16 << 20;   // 整个连接的接收窗口 (至少放得下一个 maxBodyBytes 的 body)
+    static const uint32_t MAX_FRAME = 16384;              // 对端发来的帧不能超过它 (协议默认值)
+
+    Http2Session();
+
+    // 新连接：清空所有流和 HPACK 状态，往 out (连接的输出队列，和连接一样长寿) 里排好我们的 SETTINGS
+    void Init(OutputQueue* out);
+    // 连接关闭：放掉还没发完的流 (缓存条目的引用)
+    void Reset();
+
+    // 处理 in 里所有完整的帧，响应排进输出；DATA 帧攒到 limit 字节为止，不越过。有东西要发返回 true
+    bool Process(Buffer& in, size_t limit);
+    // 这一批发完了：放掉发完的流
+    void Release();
+
+    // 发了 GOAWAY 或者对端发了 GOAWAY 且流都处理完了：发完就关连接
+    bool IsClosing() const { return closing_; }
+    size_t StreamCount() const { return streams_.size(); }
+    // 还没收全、攒在各个流里的请求 body 占的字节，算进连接的缓冲区预算
+    size_t BodyBytes() const;
+
+private:
+    enum FrameType {
+        DATA = 0x0,
+        HEADERS = 0x1,
+        PRIORITY = 0x2,
+        RST_STREAM = 0x3,
+        SETTINGS = 0x4,
+        PUSH_PROMISE = 0x5,
+        PING = 0x6,
+        GOAWAY = 0x7,
+        WINDOW_UPDATE = 0x8,
+        CONTINUATION = 0x9,
+    };
+
+    enum ErrorCode {
+        NO_ERROR = 0x0,
+        PROTOCOL_ERROR = 0x1,
+        INTERNAL_ERROR = 0x2,
+        FLOW_CONTROL_ERROR = 0x3,
+        STREAM_CLOSED = 0x5,
+        FRAME_SIZE_ERROR = 0x6,
+        REFUSED_STREAM = 0x7,
+        CANCEL = 0x8,
+        COMPRESSION_ERROR = 0x9,
+        ENHANCE_YOUR_CALM = 0xb,
+    };
+
+    struct Stream {
+        uint32_t id;
+        bool remoteClosed;      // 请求收全了 (或者不再收：已经回了 413)
+        bool done;              // 响应发完，这一批发出去之后删掉
+        bool resetAfter;        // 响应发完之后补一个 RST_STREAM(NO_ERROR)，让对端别再发 body
+        int64_t sendWindow;
+        int64_t recvWindow;     // 对端还能发多少 DATA：超过就是 FLOW_CONTROL_ERROR
+        std::vector<HpackHeader> headers;  // 请求头，等 body 收全再用
+        std::string body;
+
+        HttpResponse response;  // 持有缓存条目的引用，body 发完之前不能放
+        const char* data;       // 内存里还没发的 body
+        int fd;                 // 或者文件里的 [offset, offset + remain)
+        off_t offset;
+        size_t remain;
+    };
+
+    bool OnFrame_(uint8_t type, uint8_t flags, uint32_t streamId, const uint8_t* p, size_t len);
+    bool OnHeaders_(uint8_t flags, uint32_t streamId, const uint8_t* p, size_t len);
+    bool OnHeaderBlock_(uint32_t streamId, bool endStream);
+    bool OnData_(uint8_t flags, uint32_t streamId, const uint8_t* p, size_t len);
+    bool OnSettings_(uint8_t flags, uint32_t streamId, const uint8_t* p, size_t len);
+    bool OnWindowUpdate_(uint32_t streamId, const uint8_t* p, size_t len);
+
+    // 请求收全：拼成 HTTP/1.1 交给 HttpRequest，分发，排好响应头
+    void Dispatch_(Stream& stream);
+    // 不处理这个请求，直接回 code (413 / 431)
+    void Reject_(Stream& stream, int code);
+    bool BuildRequest_(Stream& stream);
+    void Respond_(Stream& stream, bool headOnly);
+    void WriteHeaders_(uint32_t streamId, bool endStream);
+    // 按窗口轮流给各个流发 DATA，直到输出攒够 limit (最后一帧裁短，不越过)
+    void Schedule_(size_t limit);
+    void FinishStream_(Stream& stream);
+
+    // 连接错误：发 GOAWAY，丢掉之后的输入。返回 false 方便直接 return
+    bool ConnError_(ErrorCode code);
+    void ResetStream_(uint32_t streamId, ErrorCode code);
+    void WindowUpdate_(uint32_t streamId, uint32_t inc);
+    // 流的 body 不要了 (交给请求、回了错误、流被重置)：放掉内存，窗口还给连接
+    void DropBody_(Stream& stream);
+    // len 字节的连接级接收窗口可以还了，攒够一半发一个 WINDOW_UPDATE
+    void FreeRecv_(size_t len);
+
+    void FrameHeader_(size_t len, uint8_t type, uint8_t flags, uint32_t streamId);
+    void Append_(const void* data, size_t len) { out_->Append(data, len); }
+
+    bool prefaceSettings_;      // 前言后面第一帧必须是 SETTINGS
+    bool closing_;
+    bool goawayReceived_;
+    uint32_t lastStreamId_;     // 对端开过的最大流 id
+
+    // 对端的设置
+    uint32_t peerInitialWindow_;
+    uint32_t peerMaxFrame_;
+    int64_t sendWindow_;        // 连接级发送窗口
+    // 连接级接收窗口：攒在流里的 body 一直占着窗口，交给请求或者丢掉以后才还，
+    // 所以一个连接攒着的 body 不会超过 recvLimit_
+    int64_t recvLimit_;
+    int64_t recvWindow_;        // 对端还能发多少
+    int64_t recvFreed_;         // 已经不占内存、还没用 WINDOW_UPDATE 还回去的字节
+
+    // 正在收的头部块 (HEADERS + CONTINUATION)
+    uint32_t headerStream_;     // 0 表示没有
+    bool headerEndStream_;
+    std::string headerBlock_;
+
+    HpackDecoder decoder_;
+    HpackEncoder encoder_;
+    std::vector<HpackHeader> decoded_;
+
+    std::map<uint32_t, Stream> streams_;
+    std::vector<uint32_t> ready_;   // 有 body 要发的流，轮流发
+
+    // 分发用的临时对象，跨流复用容量。两个都要连续内存：reqBuff_ 给 HTTP/1 解析器，
+    // headBuff_ 里的 HTTP/1 头部要原地切开再做 HPACK 编码
+    Buffer reqBuff_;
+    Buffer headBuff_;
+    HttpRequest request_;
+    RouteParams params_;
+    std::string path_;
+    std::string block_;         // 编码好的响应头部块
+    std::string lower_;
+
+    OutputQueue* out_;
+};
+
+#endif // HTTP2_SESSION_H
@@ -0,0 +1,161 @@
+#ifndef HTTP_CONN_H
+#define HTTP_CONN_H
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <sys/uio.h>
+#include <arpa/inet.h>
+#include "Buffer.h"
+#include "OutputQueue.h"
+#include "http/HttpRequest.h"
+#include "http/HttpResponse.h"
+#include "http/Router.h"
+#include "http/EventHub.h"
+
+class Http2Session;
+class WebSocket;
+
+// 一个 TCP 连接的全部状态：读写缓冲区、解析器、响应。
+// 对象按 fd 常驻在 EventLoop 的连接表里，连接关闭后留着给下一个复用这个 fd 的连接，
+// Buffer / string 的容量跟着保留，keep-alive 连接上的后续请求也不再重新分配。
+class HttpConn {
+public:
+    HttpConn();
+    ~HttpConn();
+
+    HttpConn(const HttpConn&) = delete;
+    HttpConn& operator=(const HttpConn&) = delete;
+
+    // pushTarget：连接所在的事件循环，订阅的频道有新消息时由它来唤醒这个连接
+    void Init(int sockFd, const sockaddr_in& addr, PushTarget* pushTarget = nullptr);
+    void Close();
+
+    // ET 模式：一直读到 EAGAIN，或者读缓冲区到了预算上限 (IsReadBlocked，*saveErrno 设成 EAGAIN)。
+    // 返回本次读到的字节数，0 表示对端关闭，-1 表示出错
+    ssize_t read(int* saveErrno);
+    // 别人代为收好的数据 (io_uring)：照单全收，容量按预算封顶，放不下的才按需要扩
+    void Receive(const char* data, size_t len);
+    // 尽量把待发送数据写完，遇到 EAGAIN 返回
+    ssize_t write(int* saveErrno);
+
+    // 把读缓冲区里所有完整的请求依次解析掉，响应按顺序接到输出队列上，一次 writev 发出去。
+    // 一个完整请求都没有时返回 false
+    bool process();
+
+    // 按路由表分发一个解析好的请求，填好 response (HTTP/2 的流也走这里)。返回匹配到的路由
+    static const Router::Route* Dispatch(const HttpRequest& request, bool keepAlive, RouteParams& params,
+                         std::string& path, HttpResponse& response);
+
+    // 已经发出去 len 字节 (io_uring 这种由别人代为发送的后端用)
+    void AdvanceWrite(size_t len);
+
+    size_t ToWriteBytes() const { return out_.Bytes(); }
+    // 待发送数据超过高水位：暂停读新请求，等对端把数据收走
+    bool IsWriteBlocked() const { return ToWriteBytes() > highWaterMark; }
+    bool IsKeepAlive() const { return isKeepAlive_; }
+    bool IsClosed() const { return isClose_; }
+    bool IsHttp2() const { return isHttp2_; }
+    bool IsWebSocket() const { return isWebSocket_; }
+    bool IsEventStream() const { return isEventStream_; }
+
+    // 定时器线程：连接空闲到超时。长连接排一个 ping (WebSocket) / 注释行 (SSE) 并返回 true，
+    // 下一次 process() 发出去；上一个 ping 也没有回音、或者是普通 HTTP 连接时返回 false，照常关闭
+    bool KeepAliveTick();
+    // 同一个连接上的事件任务和推送任务在线程池里要串行
+    std::mutex& Mutex() { return mtx_; }
+
+    // 缓冲区容量变化之后向 BufferBudget 报账。超出单连接上限或总预算时返回 false
+    bool Account();
+    // 读缓冲区在预算内还能放多少字节：空闲空间 (含前面读走腾出来的) 加上还能扩的容量
+    size_t ReadRoom() const;
+    // 上一次 read 因为读缓冲区满了停下，socket 里可能还有数据。
+    // 和高水位一样先不读：处理掉已经收到的请求腾出空间再读；一个请求都处理不了才说明它本身超过了上限
+    bool IsReadBlocked() const { return readBlocked_; }
+    // 空闲超过 idleReleaseMs (没有半个请求、没有待发数据) 的连接把缓冲区还掉，下次来数据再按需分配。
+    // 返回还掉的字节数
+    size_t ReleaseIdle(int64_t nowMs);
+    static int64_t NowMs();
+
+    int GetFd() const { return fd_; }
+    int GetPort() const { return ntohs(addr_.sin_port); }
+    const char* GetIP() const { return inet_ntoa(addr_.sin_addr); }
+    sockaddr_in GetAddr() const { return addr_; }
+
+    Buffer& ReadBuffer() { return readBuff_; }
+    // 还没发完的输出：各个响应的头部、body (内存 / 文件区间)、推送消息，按顺序排好
+    const OutputQueue& Output() const { return out_; }
+
+    static std::string srcDir;
+    static std::atomic<int> userCount;
+    static size_t highWaterMark;
+    static int idleReleaseMs;   // 0 表示不收缩
+
+    // 一批最多攒多少个流水线请求 (输出段最多是它的两倍，远小于 IOV_MAX)
+    static const size_t MAX_PIPELINE = 32;
+    // 一批最多带多少条推送消息 (每条一段)
+    static const size_t MAX_PUSH_IOV = 256;
+
+private:
+    bool Process_();
+    bool ProcessHttp2_();
+    bool ProcessWebSocket_();
+    bool ProcessEventStream_();
+    bool TakePushed_();
+    void AppendPushed_();
+    void BuildOutput_();
+    void ReleaseBatch_();
+
+    int fd_;
+    struct sockaddr_in addr_;
+    bool isClose_;
+    bool isKeepAlive_;
+
+    // 头部 / body 交替排列：头部引用 writeBuff_，缓存里的 body 和推送消息带着引用计数，
+    // 大文件是文件区间 (sendfile)。HTTP/2 的帧也直接写进来
+    OutputQueue out_;
+
+    // 这两个不换成 ChainBuffer：解析出来的请求行、头部是指向 readBuff_ 的 StrView，要连续内存；
+    // writeBuff_ 只放头部 (body 在 out_ 里)，HttpResponse / WebSocket / EventStream 都按 Buffer 往里写
+    Buffer readBuff_;   // 读缓冲区：跨事件保留，半个请求不会丢
+    Buffer writeBuff_;  // 写缓冲区：这一批所有响应的头部，首尾相接
+    std::string path_;  // 当前请求的路径，跨请求复用容量
+
+    HttpRequest request_;
+    RouteParams params_;
+    std::vector<HttpResponse> responses_;  // 只增不减，没有流水线的连接只用一个
+    std::vector<size_t> headEnd_;          // 第 i 个响应的头部在 writeBuff_ 里的结束位置
+    std::vector<bool> headOnly_;           // 第 i 个请求是 HEAD：只发头部 (Content-Length 照写)
+    size_t batch_;                         // 这一批的响应个数
+
+    // 连接开头是 HTTP/2 前言 (h2c prior knowledge) 时，之后的字节都交给 http2_。
+    // 第一次用到才分配，连接对象复用时留着
+    bool prefaceChecked_;
+    bool isHttp2_;
+    std::unique_ptr<Http2Session> http2_;
+
+    // 101 之后的字节都是 WebSocket 帧。定时器在 loop 线程里看这个标志，工作线程里设置
+    std::atomic<bool> isWebSocket_;
+    std::unique_ptr<WebSocket> ws_;
+
+    // SSE：响应头发完之后只剩推送过来的事件
+    std::atomic<bool> isEventStream_;
+    std::atomic<bool> streamPingDue_;
+
+    // 长连接的订阅。每个连接新建一个：旧的可能还在别的线程的发布、唤醒队列里
+    PushTarget* pushTarget_;
+    std::shared_ptr<Subscriber> sub_;
+    std::vector<SharedPayload> pushed_;    // 取过来的消息，pushHead_ 之前的已经交给 out_
+    size_t pushHead_;
+
+    // 报过账的缓冲区容量，和最后一次读到数据 / 处理请求的时间
+    size_t charged_;
+    bool readBlocked_;
+    int64_t lastActiveMs_;
+
+    std::mutex mtx_;
+};
+
+#endif // HTTP_CONN_H
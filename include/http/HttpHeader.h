@@ -0,0 +1,104 @@
+#ifndef HTTP_HEADER_H
+#define HTTP_HEADER_H
+
+#include <cstddef>
+#include <cstdint>
+#include "StrView.h"
+
+// 常用请求头的编号。解析时查一次完美哈希表认出来，放进 HttpRequest 的固定槽位，
+// 之后按编号取就是一次数组下标；不认识的头放进一个小 vector 里线性找
+enum HeaderId {
+    HDR_HOST,
+    HDR_CONNECTION,
+    HDR_CONTENT_LENGTH,
+    HDR_CONTENT_TYPE,
+    HDR_TRANSFER_ENCODING,
+    HDR_ACCEPT,
+    HDR_ACCEPT_ENCODING,
+    HDR_ACCEPT_LANGUAGE,
+    HDR_RANGE,
+    HDR_IF_RANGE,
+    HDR_IF_NONE_MATCH,
+    HDR_IF_MODIFIED_SINCE,
+    HDR_USER_AGENT,
+    HDR_COOKIE,
+    HDR_REFERER,
+    HDR_UPGRADE,
+    HDR_EXPECT,
+    HDR_AUTHORIZATION,
+    HDR_CACHE_CONTROL,
+    HDR_ORIGIN,
+    HDR_SEC_WEBSOCKET_KEY,
+    HDR_SEC_WEBSOCKET_VERSION,
+    HDR_SEC_WEBSOCKET_PROTOCOL,
+    HDR_SEC_WEBSOCKET_EXTENSIONS,
+    HDR_HTTP2_SETTINGS,
+    HDR_KEEP_ALIVE,
+    HDR_PRAGMA,
+    HDR_X_FORWARDED_FOR,
+    HDR_COUNT,
+    HDR_UNKNOWN = HDR_COUNT
+};
+
+// ---- 编译期建表 ----
+// 名字的顺序必须和 HeaderId 一致
+
+static constexpr const char* HEADER_NAMES[HDR_COUNT] = {
+    "Host", "Connection", "Content-Length", "Content-Type", "Transfer-Encoding",
+    "Accept", "Accept-Encoding", "Accept-Language", "Range", "If-Range",
+    "If-None-Match", "If-Modified-Since", "User-Agent", "Cookie", "Referer",
+    "Upgrade", "Expect", "Authorization", "Cache-Control", "Origin",
+    "Sec-WebSocket-Key", "Sec-WebSocket-Version", "Sec-WebSocket-Protocol", "Sec-WebSocket-Extensions",
+    "HTTP2-Settings", "Keep-Alive", "Pragma", "X-Forwarded-For",
+};
+
+static const unsigned HEADER_TABLE_SIZE = 64;
+
+// 长度、首字母、末字母、中间字母的组合，对上面这张表没有冲突 (下面 static_assert 检查)。
+// | 0x20 把字母转成小写，其他字符变成什么都无所谓，命中之后还要整串比较
+static constexpr unsigned HeaderHash(const char* s, size_t n) {
+    return (static_cast<unsigned>(n)
+            + (static_cast<unsigned char>(s[0]) | 0x20) * 11
+            + (static_cast<unsigned char>(s[n - 1]) | 0x20) * 6
+            + (static_cast<unsigned char>(s[n / 2]) | 0x20)) & (HEADER_TABLE_SIZE - 1);
+}
+
+struct HeaderTable {
+    uint8_t slot[HEADER_TABLE_SIZE];  // 哈希值 -> HeaderId
+    uint8_t len[HDR_COUNT];
+    bool collision;
+};
+
+static constexpr HeaderTable BuildHeaderTable() {
+    HeaderTable t{};
+    for(unsigned i = 0; i < HEADER_TABLE_SIZE; i++) t.slot[i] = HDR_UNKNOWN;
+    for(unsigned id = 0; id < HDR_COUNT; id++) {
+        size_t n = 0;
+        while(HEADER_NAMES[id][n]) n++;
+        t.len[id] = static_cast<uint8_t>(n);
+        unsigned h = HeaderHash(HEADER_NAMES[id], n);
+        if(t.slot[h] != HDR_UNKNOWN) t.collision = true;
+        t.slot[h] = static_cast<uint8_t>(id);
+    }
+    return t;
+}
+
+static constexpr HeaderTable HEADER_TABLE = BuildHeaderTable();
+static_assert(!HEADER_TABLE.collision, "header hash collision: adjust HeaderHash");
+
+class HttpHeader {
+public:
+    // 名字不区分大小写；不在表里返回 HDR_UNKNOWN
+    static HeaderId Lookup(StrView name) {
+        if(name.empty()) return HDR_UNKNOWN;
+        unsigned id = HEADER_TABLE.slot[HeaderHash(name.data(), name.size())];
+        if(id != HDR_UNKNOWN && name.EqualsIgnoreCase(Name(static_cast<HeaderId>(id)))) {
+            return static_cast<HeaderId>(id);
+        }
+        return HDR_UNKNOWN;
+    }
+
+    static StrView Name(HeaderId id) { return StrView(HEADER_NAMES[id], HEADER_TABLE.len[id]); }
+};
+
+#endif // HTTP_HEADER_H
@@ -1,44 +1,145 @@
 #ifndef HTTP_REQUEST_H
 #define HTTP_REQUEST_H
 
+#include <functional>
 #include <string>
 #include <unordered_map>
-#include <regex>
+#include <vector>
+#include <cstdint>
 #include "Buffer.h"  // 因为 Buffer.h 就在 include 下，所以直接引用
+#include "StrView.h"
+#include "http/HttpHeader.h"
 
+// Range 头里的一段：first == -1 表示后缀形式 "-N"，即最后 last 个字节；
+// last == -1 表示 "N-"，一直到文件末尾
+struct ByteRange {
+    long long first;
+    long long last;
+};
+
+// 零拷贝解析器：方法、路径、版本、头部的名字和值都只记成读缓冲区里的位置，不复制出来。
+// 请求没收全时原始字节全部留在 buff 里 (只记偏移，buff 扩容搬家也不受影响)；
+// 收全后一次性从 buff 里取走，视图在下一次往 buff 追加数据之前一直有效，
+// 也就是整个 process() 期间可用。Init() 之后视图作废。
+// body 按 Content-Length 或 chunked 分帧；chunked 在 buff 里原地解码，body() 始终是一段连续的内存。
 class HttpRequest {
 public:
     enum PARSE_STATE {
         REQUEST_LINE,
         HEADERS,
-        BODY,
+        BODY,           // Content-Length 的 body
+        CHUNK_SIZE,     // chunked：等 "长度[;扩展]\r\n"
+        CHUNK_DATA,
+        CHUNK_DATA_END, // 每块数据后面的 "\r\n"
+        TRAILERS,       // 最后一块 (长度 0) 之后的尾部头，到空行为止
         FINISH
     };
 
+    struct Header {
+        StrView key;
+        StrView value;
+    };
+
+    // multipart/form-data 里带 filename 的部分，内容是 body() 里的一段
+    struct FormFile {
+        StrView name;
+        StrView filename;
+        StrView contentType;
+        StrView data;
+    };
+
+    // 流式接收 body：每解码出一段调用一次，body 收完后再以 last == true 调用一次 (data 可能为空)。
+    // data 只在回调期间有效；返回 false 中止这个请求 (回 400 并关闭连接)
+    typedef std::function<bool(const HttpRequest& request, StrView data, bool last)> BodyHandler;
+    // 头部收全且有 body 时调用：返回非空的 BodyHandler 就把 body 流式交给它，不再攒在内存里，
+    // 也不受 maxBodyBytes 限制；返回空函数照常缓冲。回调里可以用 method() / path() / GetHeader()
+    typedef std::function<BodyHandler(const HttpRequest& request)> BodyHandlerFactory;
+
     HttpRequest() { Init(); }
     ~HttpRequest() = default;
 
     void Init();
+    // 增量解析：请求不完整时返回 true 且不消费 buff (流式 body 除外：交出去的数据会从 buff 里挖掉)；
+    // 返回 false 表示请求不能处理，状态码见 ErrorCode()
     bool parse(Buffer& buff);
+    bool IsFinished() const { return state_ == FINISH; }
+    bool IsKeepAlive() const;
+    // parse 返回 false 之后的状态码：400 格式错误，413 body 太大，501 不支持的 Transfer-Encoding
+    int ErrorCode() const { return errorCode_; }
 
-    std::string path() const;
-    std::string method() const;
-    std::string version() const;
+    StrView path() const { return path_; }
+    StrView method() const { return method_; }
+    StrView version() const { return version_; }
+    // 缓冲的 body (chunked 已经解码)；流式交给 BodyHandler 的请求这里是空的
+    StrView body() const { return body_; }
+    // application/x-www-form-urlencoded 和 multipart/form-data 里的普通字段 (已经做过 % 解码)
     std::string GetPost(const std::string& key) const;
     std::string GetPost(const char* key) const;
+    const std::vector<FormFile>& Files() const { return files_; }
+    // 常用头按编号取，一次数组下标；没有这个头返回空视图 (重复出现的取第一个)
+    StrView GetHeader(HeaderId id) const {
+        return (knownMask_ >> id) & 1 ? StrView(base_ + knownSpans_[id].off, knownSpans_[id].len) : StrView();
+    }
+    bool HasHeader(HeaderId id) const { return (knownMask_ >> id) & 1; }
+    // 按名字取，不区分大小写：常用头先查表，其余的在 OtherHeaders() 里线性找
+    StrView GetHeader(StrView key) const;
+    // 不在 HeaderId 表里的头，以及常用头的重复出现
+    const std::vector<Header>& OtherHeaders() const { return others_; }
+    // 解析 "Range: bytes=..."。没有这个头、单位不是 bytes 或者格式不对都返回 false，按整个文件处理
+    bool GetRanges(std::vector<ByteRange>* ranges) const;
+
+    // 请求行 + 头部超过这个长度还没结束，当成恶意请求 (chunked 的尾部头同样按这个算)
+    static const size_t MAX_HEADER_BYTES = 64 * 1024;
+    // chunk 长度行 (含扩展) 的上限
+    static const size_t MAX_CHUNK_LINE = 4096;
+
+    // 缓冲的 body 上限，超过回 413 (默认 8MB)
+    static size_t maxBodyBytes;
+    static BodyHandlerFactory bodyHandlerFactory;
 
 private:
-    bool ParseRequestLine_(const std::string& line);
-    void ParseHeader_(const std::string& line);
-    void ParseBody_(const std::string& line);
+    // 解析过程中只记相对请求开头的偏移，收全后再换成指针
+    struct Span {
+        uint32_t off;
+        uint32_t len;
+    };
+
+    bool ParseRequestLine_(const char* base, size_t start, size_t end);
+    bool ParseHeader_(const char* base, size_t start, size_t end);
+    bool ParseLine_(const char* base, size_t start, size_t end);
+    bool HeadersDone_(const char* base);
+    bool ParseChunkSize_(StrView line);
+    bool StreamBody_(Buffer& buff, char* base);
+    bool Fail_(int code);
+    void Materialize_(const char* base);
+    void Finish_(const char* base);
 
     void ParsePath_();
     void ParsePost_();
+    void ParseUrlencoded_(StrView body);
+    void ParseMultipart_(StrView body, StrView boundary);
 
     PARSE_STATE state_;
-    std::string method_, path_, version_, body_;
-    std::unordered_map<std::string, std::string> header_;
+    int errorCode_;
+    size_t parsed_;       // 已经解析过的原始字节数 (相对请求开头)
+    size_t scanned_;      // 当前这行已经确认没有行尾的位置，半行数据不重复扫描
+    size_t bodyStart_;
+    size_t bodyLen_;      // 已经解码、放在 [bodyStart_, bodyStart_ + bodyLen_) 的 body 字节
+    size_t remaining_;    // 当前 Content-Length body / chunk 还差多少字节
+    size_t trailerStart_;
+    BodyHandler handler_; // 非空表示 body 流式交出去
+
+    Span methodSpan_, pathSpan_, versionSpan_;
+    Span knownSpans_[HDR_COUNT];                      // 常用头的值，按 HeaderId 放
+    uint32_t knownMask_;                              // 哪些槽位有值
+    std::vector<std::pair<Span, Span>> otherSpans_;   // clear() 不释放容量，连接复用时不再分配
+    static_assert(HDR_COUNT <= 32, "knownMask_ is 32 bits");
+
+    const char* base_;    // 请求在 buff 里的起点，视图都从这里算
+    StrView method_, path_, version_, body_;
+    std::vector<Header> others_;
     std::unordered_map<std::string, std::string> post_;
+    std::vector<FormFile> files_;
 };
 
-#endif // HTTP_REQUEST_H
\ No newline at end of file
+#endif // HTTP_REQUEST_H
@@ -2,12 +2,12 @@
 #define HTTP_RESPONSE_H
 
 #include <unordered_map>
-#include <fcntl.h>    // open
-#include <unistd.h>   // close
-#include <sys/stat.h> // stat
-#include <sys/mman.h> // mmap, munmap
 #include <string>
+#include <vector>
+#include <time.h>
 #include "Buffer.h"
+#include "http/FileCache.h"
+#include "http/HttpRequest.h"
 
 class HttpResponse {
 public:
@@ -15,29 +15,80 @@ public:
     ~HttpResponse();
 
     void Init(const std::string& srcDir, std::string& path, bool isKeepAlive = false, int code = -1);
+    // 动态路由的响应：不找文件，由 handler 设置状态码 / Content-Type / 头部并把 body 写进 Body()
+    void InitDynamic(bool isKeepAlive);
+    void SetStatus(int code) { code_ = code; }
+    int Code() const { return code_; }
+    void SetContentType(StrView type) { contentType_.assign(type.data(), type.size()); }
+    // 额外的响应头，例 AddHeader("Location", "/login")
+    void AddHeader(StrView key, StrView value);
+    std::string& Body() { return dynBody_; }
+    // body 不在 Body() 里，由连接之后按 chunked 编码一块块接着发 (SSE)
+    void SetChunked() { chunked_ = true; }
+
+    // Init 之后、MakeResponse 之前调用：取出影响响应的请求头
+    // (Accept-Encoding、Range / If-Range、If-None-Match / If-Modified-Since)
+    void SetRequest(const HttpRequest& request);
     void MakeResponse(Buffer& buff);
-    char* File();
-    size_t FileLen() const;
+    // 要发送的 body：内存里的从 File() 开始，文件里的是 FileFd() 的 [FileOffset, FileOffset + FileLen)
+    const char* File() const;
+    size_t FileLen() const { return bodyLen_; }
+    off_t FileOffset() const { return bodyOffset_; }
+    // 走 sendfile 时返回文件 fd，否则 -1
+    int FileFd() const { return file_ && multipart_.empty() && bodyLen_ > 0 ? file_->fd : -1; }
+    // body 在缓存条目里 (内存或者它打开的文件) 时返回这个条目，输出队列发完之前拿着它；否则为空
+    FileCache::EntryPtr Entry() const { return multipart_.empty() && !dynamic_ ? file_ : nullptr; }
+    bool IsKeepAlive() const { return isKeepAlive_; }
+    // 响应发完：放掉对缓存条目的引用
     void UnmapFile();
 
+    // 按后缀名取 Content-Type
+    static const std::string& FileType(const std::string& path);
+    // RFC 7231 的 IMF-fixdate，例："Sun, 06 Nov 1994 08:49:37 GMT"
+    static std::string HttpDate(time_t t);
+
+    // 不小于这个大小的文件走 sendfile，不再读进内存
+    static size_t sendfileThreshold;
+
 private:
     void AddStateLine_(Buffer& buff);
     void AddHeader_(Buffer& buff);
     void AddContent_(Buffer& buff);
 
+    void MakeDynamic_(Buffer& buff);
     void ErrorHtml_();
-    std::string GetFileType_();
+    static int StatusOf_(const FileEntry& file);
+    bool NotModified_();
+    bool IfRangeMatches_() const;
+    void ApplyRanges_();
 
     int code_;
     bool isKeepAlive_;
+    bool dynamic_;
+    bool chunked_;
+    int acceptEncoding_;
     std::string path_;
     std::string srcDir_; // 资源的根目录
-    
-    char* mmFile_;       // mmap 映射的内存指针
-    struct stat mmFileStat_; // 文件状态信息
-    
+
+    FileCache::EntryPtr file_;  // 文件的 stat、预拼好的头部和内容都来自 FileCache
+
+    std::vector<ByteRange> ranges_;
+    std::string ifRange_;
+    std::string ifNoneMatch_;
+    std::string ifModifiedSince_;
+    std::string etag_;          // 这次响应的 ETag (304 时是客户端命中的那个)
+    std::vector<std::pair<size_t, size_t>> parts_;  // 落到文件上的区间 [first, last]
+    std::string multipart_;     // 多段 Range 拼好的 multipart/byteranges body
+    std::string boundary_;
+    off_t bodyOffset_;
+    size_t bodyLen_;
+
+    std::string contentType_;   // 动态响应的 Content-Type
+    std::string extraHeaders_;  // AddHeader 加的额外头部 (动态响应、405 的 Allow)，已经拼成 "Key: value\r\n..."
+    std::string dynBody_;       // 动态响应的 body
+
     static const std::unordered_map<std::string, std::string> SUFFIX_TYPE; // 后缀名 -> Content-Type
-    static const std::unordered_map<int, std::string> CODE_STATUS; // 状态码 -> 描述
+    static const std::unordered_map<int, std::string> STATUS_LINE; // 状态码 -> 整行状态行
 };
 
 #endif // HTTP_RESPONSE_H
\ No newline at end of file
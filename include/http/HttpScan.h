@@ -0,0 +1,42 @@
+#ifndef HTTP_SCAN_H
+#define HTTP_SCAN_H
+
+#include <cstddef>
+
+// HTTP 头部的分隔符扫描。解析器最热的就是这两个循环，按 CPU 支持情况
+// 选 AVX2 (一次 32 字节) / SSE4.2 (一次 16 字节) / 逐字节 三种实现，启动时检测一次。
+class HttpScan {
+public:
+    enum Impl {
+        SCALAR,
+        SSE42,
+        AVX2,
+    };
+
+    // 从 p 开始找第一个控制字符 (< 0x20 且不是 '\t'，或者 0x7f)。
+    // 合法的行里它就是行尾的 '\r'，别的控制字符说明请求非法。找不到返回 end
+    static const char* FindLineEnd(const char* p, const char* end) {
+        return lineEnd_(p, end);
+    }
+
+    // 从 p 开始找头部名字的结束：第一个 ':'、空白、控制字符或者非 ASCII 字节。
+    // 合法的头部行里它就是冒号。找不到返回 end
+    static const char* FindNameEnd(const char* p, const char* end) {
+        return nameEnd_(p, end);
+    }
+
+    static bool Supported(Impl impl);
+    // 强制使用某种实现 (测试 / 基准用)，不支持时返回 false
+    static bool Use(Impl impl);
+    static Impl Current() { return current_; }
+    static const char* Name(Impl impl);
+
+private:
+    typedef const char* (*ScanFn)(const char*, const char*);
+
+    static ScanFn lineEnd_;
+    static ScanFn nameEnd_;
+    static Impl current_;
+};
+
+#endif // HTTP_SCAN_H
@@ -0,0 +1,117 @@
+#ifndef ROUTER_H
+#define ROUTER_H
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include "StrView.h"
+#include "http/EventHub.h"
+
+class HttpRequest;
+class HttpResponse;
+struct WebSocketHandler;
+
+// 路由参数：":id" / "*path" 匹配到的部分。key 指向路由表，value 指向请求路径，
+// 都只在这次请求处理期间有效
+struct RouteParam {
+    StrView key;
+    StrView value;
+};
+
+class RouteParams {
+public:
+    // 没有这个参数返回空视图
+    StrView Get(StrView key) const {
+        for(const RouteParam& p : params_) {
+            if(p.key == key) return p.value;
+        }
+        return StrView();
+    }
+    size_t Size() const { return params_.size(); }
+    const RouteParam& operator[](size_t i) const { return params_[i]; }
+
+    void Clear() { params_.clear(); }
+    void Push(StrView key, StrView value) { params_.push_back(RouteParam{key, value}); }
+    void Pop() { params_.pop_back(); }
+
+private:
+    std::vector<RouteParam> params_;  // clear() 不释放容量，连接复用时不再分配
+};
+
+// 方法 + 路径模式 -> 处理函数。路径存在一棵压缩前缀树 (radix tree) 里，匹配只沿着请求路径走一遍，
+// 不随路由条数线性增长。模式里可以有：
+//   ":name"  匹配一段 (到下一个 '/' 为止)，例 "/api/users/:id"
+//   "*name"  匹配剩下的全部，只能放在最后，例 "/static/*path"
+// 同一个位置上静态段优先于 ":name"，":name" 优先于 "*name"；走不通会回退去试下一种。
+// 路由在启动时注册，事件循环开始之后只读，不加锁。
+class Router {
+public:
+    // handler 直接填响应：状态码、Content-Type、额外的头，body 写进 response.Body()
+    typedef std::function<void(const HttpRequest& request, const RouteParams& params,
+                               HttpResponse& response)> Handler;
+
+    struct Route {
+        std::string method;     // "*" 表示任意方法
+        std::string pattern;
+        Handler handler;        // 空表示静态文件：按请求路径去资源目录里找
+        std::shared_ptr<const WebSocketHandler> websocket;  // 不为空时是 WebSocket 端点，handler 不用
+        std::shared_ptr<const SseHandler> sse;              // 不为空时是 SSE 端点，同上
+    };
+
+    enum MatchResult {
+        MATCHED,
+        NOT_FOUND,
+        METHOD_NOT_ALLOWED,     // 路径能匹配上，但没有这个方法的路由
+    };
+
+    static Router* Instance();
+
+    // 同一个方法 + 模式重复注册、同一位置的参数名冲突、'*' 不在最后时返回 false
+    bool Add(const std::string& method, const std::string& pattern, Handler handler);
+    bool Get(const std::string& pattern, Handler handler) { return Add("GET", pattern, std::move(handler)); }
+    bool Post(const std::string& pattern, Handler handler) { return Add("POST", pattern, std::move(handler)); }
+    // WebSocket 端点 (GET)：合法的升级请求回 101 之后连接交给这组回调，别的请求回 426
+    bool WebSocket(const std::string& pattern, WebSocketHandler handler);
+    // SSE 端点 (GET)：回 200 text/event-stream 之后连接一直开着，handler 在这里订阅频道
+    bool Sse(const std::string& pattern, SseHandler handler);
+    // prefix 下的所有请求都按静态文件处理 (任意方法，路径原样拿去资源目录里找)
+    bool Static(const std::string& prefix);
+
+    // 没匹配上返回 nullptr，原因在 result 里；METHOD_NOT_ALLOWED 时 allow (可以不传) 填上
+    // 这条路径能用的方法，例 "GET, HEAD, POST"，直接当 Allow 头用。
+    // 具体方法的路由先匹配：路径对上了、方法没对上就是 405，不会落到 Static() 的 "*" 里去。
+    // 没有 HEAD 路由时 HEAD 用 GET 的
+    const Route* Match(StrView method, StrView path, RouteParams* params, MatchResult* result,
+                       std::string* allow = nullptr) const;
+
+    void Clear();
+    size_t Size() const { return routes_.size(); }
+
+    Router();
+    ~Router();
+    Router(const Router&) = delete;
+    Router& operator=(const Router&) = delete;
+
+private:
+    struct Node {
+        std::string prefix;                         // 压缩后的静态段
+        std::string indices;                        // 各静态子节点 prefix 的首字母，和 children 一一对应
+        std::vector<std::unique_ptr<Node>> children;
+        std::unique_ptr<Node> param;                // ":name" 子节点
+        std::unique_ptr<Node> catchAll;             // "*name" 子节点
+        std::string name;                           // 参数节点的参数名
+        std::vector<size_t> routes;                 // 在这里结束的路由 (routes_ 的下标)，按方法区分
+    };
+
+    Node* InsertStatic_(Node* node, StrView text);
+    // anyMethod 为 false 时不看 "*" 路由，路径对上的节点的方法记进 allow
+    bool MatchNode_(const Node* node, StrView method, StrView path, RouteParams* params,
+                    const Route** route, bool anyMethod, std::string* allow) const;
+    const Route* FindMethod_(const Node* node, StrView method, bool anyMethod, std::string* allow) const;
+
+    std::unique_ptr<Node> root_;
+    std::vector<Route> routes_;
+};
+
+#endif // ROUTER_H
@@ -0,0 +1,124 @@
+#ifndef WEBSOCKET_H
+#define WEBSOCKET_H
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include "Buffer.h"
+#include "StrView.h"
+
+class HttpRequest;
+class RouteParams;
+class Subscriber;
+class WebSocket;
+
+// 注册在路由上的一组回调 (Router::WebSocket)，都在处理这个连接的线程里调用，
+// 回调里可以直接 ws.Send() 回消息
+struct WebSocketHandler {
+    std::function<void(WebSocket& ws, const HttpRequest& request, const RouteParams& params)> onOpen;
+    // 一条完整的消息 (分片已经拼好)，data 只在回调期间有效
+    std::function<void(WebSocket& ws, StrView data, bool binary)> onMessage;
+    // 会话结束时调用一次：对端发来的关闭码 (没带是 1005)、我们关闭时用的码，或者 TCP 直接断了 (1006)
+    std::function<void(WebSocket& ws, uint16_t code)> onClose;
+};
+
+// RFC 6455 服务端：握手之后 HttpConn 把读缓冲区交给它解帧，发出去的帧写进 HttpConn 的写缓冲区，
+// 和普通响应走同一条 writev 路径。不支持扩展 (permessage-deflate)。
+class WebSocket {
+public:
+    enum Opcode {
+        CONTINUATION = 0x0,
+        TEXT = 0x1,
+        BINARY = 0x2,
+        CLOSE = 0x8,
+        PING = 0x9,
+        PONG = 0xa,
+    };
+
+    // 关闭码
+    enum CloseCode {
+        NORMAL = 1000,
+        GOING_AWAY = 1001,
+        PROTOCOL_ERROR = 1002,
+        INVALID_DATA = 1007,
+        TOO_BIG = 1009,
+        TRY_AGAIN_LATER = 1013,
+        NO_STATUS = 1005,   // 这两个只用来通知 onClose，不会出现在帧里
+        ABNORMAL = 1006,
+    };
+
+    // 请求是不是合法的升级请求：GET、Upgrade: websocket、Connection 里有 upgrade、版本 13、有 key
+    static bool IsUpgrade(const HttpRequest& request);
+    // Sec-WebSocket-Accept = base64(sha1(key + GUID))
+    static std::string AcceptKey(StrView key);
+    // 按 4 字节掩码原地异或，mask[0] 对应 p[0]。和 HttpScan 一样启动时按 CPU 选实现
+    static void Unmask(char* p, size_t len, const uint8_t mask[4]) { unmask_(p, len, mask); }
+    enum UnmaskImpl {
+        UNMASK_SCALAR,
+        UNMASK_SSE2,
+        UNMASK_AVX2,
+    };
+    // 强制使用某种实现 (测试 / 基准用)，不支持时返回 false
+    static bool UseUnmask(UnmaskImpl impl);
+    static UnmaskImpl CurrentUnmask() { return unmaskImpl_; }
+    // 服务端的帧不带掩码
+    static void WriteFrame(Buffer& out, Opcode op, StrView payload, bool fin = true);
+    // 合法的 UTF-8 (文本消息和关闭原因必须是)
+    static bool IsUtf8(StrView s);
+
+    // 单条消息 (拼好分片之后) 的上限，超过用 1009 关闭 (默认 1MB)
+    static size_t maxMessageBytes;
+
+    WebSocket();
+
+    // 101 写进 out 之后调用：onOpen 里发的消息紧跟在 101 后面。
+    // sub 是这个连接的订阅者，回调里 Subscribe 之后频道上发布的消息由连接直接发出去
+    void Open(std::shared_ptr<const WebSocketHandler> handler, const HttpRequest& request,
+              const RouteParams& params, Buffer& out, std::shared_ptr<Subscriber> sub = nullptr);
+    // 依次处理 in 里完整的帧，回调里的回复写进 out，out 攒到 limit 字节就先停下 (剩下的帧留在 in 里)。
+    // 到期的 ping 也在这里发。协议错误时排好关闭帧，之后的输入都丢掉
+    void Process(Buffer& in, Buffer& out, size_t limit);
+    // TCP 连接断了：没收发过关闭帧的话通知一次 onClose(1006)
+    void Disconnect();
+
+    // 以下只能在回调里调用
+    void Send(StrView data, bool binary = false);
+    void Close(uint16_t code = NORMAL, StrView reason = StrView());
+    // 订阅 / 退订 EventHub 的频道，发布的消息按文本帧收到
+    void Subscribe(StrView channel);
+    void Unsubscribe(StrView channel);
+
+    // 回调之外由连接主动关闭 (例如订阅的消息积压太多)，关闭帧写进 out
+    void Shutdown(Buffer& out, uint16_t code);
+
+    // 连接空闲到超时：还没发 ping 就排一个 (下一次 Process 发出去) 并返回 true；
+    // 上一个 ping 之后对端一直没有动静，返回 false，连接该关了
+    bool KeepAliveTick();
+    // 发过关闭帧：写完就关 TCP (不等对端回关闭帧)
+    bool IsClosing() const { return closeSent_; }
+
+private:
+    typedef void (*UnmaskFn)(char*, size_t, const uint8_t*);
+    static UnmaskFn unmask_;
+    static UnmaskImpl unmaskImpl_;
+
+    // 返回 false 表示不再往下处理 (发了关闭帧)
+    bool OnFrame_(uint8_t op, bool fin, char* payload, size_t len);
+    void Deliver_(StrView data, bool binary);
+    void Fail_(uint16_t code);
+    void Notify_(uint16_t code);
+
+    std::shared_ptr<const WebSocketHandler> handler_;
+    std::shared_ptr<Subscriber> sub_;
+    Buffer* out_;               // Process 期间有效
+    bool closeSent_;
+    bool closeNotified_;        // onClose 已经调用过
+    uint8_t fragOp_;            // 分片消息的类型，0 表示不在分片中
+    std::string message_;       // 分片消息拼到这里
+    std::atomic<bool> pingDue_;     // 定时器线程置位，处理线程发出去
+    std::atomic<bool> pingSent_;    // ping 发出之后对端还没发过任何帧
+};
+
+#endif // WEBSOCKET_H
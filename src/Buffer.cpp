@@ -4,14 +4,17 @@
 #include <unistd.h>  // write
 #include <sys/uio.h> // readv
 #include <assert.h>
+#include <algorithm>
 
-Buffer::Buffer(int initBuffSize) : buffer_(initBuffSize), readPos_(0), writePos_(0) {}
+Buffer::Buffer(int initBuffSize)
+    : buffer_(new char[initBuffSize]), capacity_(initBuffSize), readPos_(0), writePos_(0) {}
 
 size_t Buffer::readableBytes() const { return writePos_ - readPos_; }
-size_t Buffer::writableBytes() const { return buffer_.size() - writePos_; }
+size_t Buffer::writableBytes() const { return capacity_ - writePos_; }
 size_t Buffer::prependableBytes() const { return readPos_; }
 
 const char* Buffer::peek() const { return BeginPtr_() + readPos_; }
+char* Buffer::peek() { return BeginPtr_() + readPos_; }
 
 void Buffer::retrieve(size_t len) {
     assert(len <= readableBytes());
@@ -24,25 +27,59 @@ void Buffer::retrieveUntil(const char* end) {
 }
 
 void Buffer::retrieveAll() {
-    bzero(&buffer_[0], buffer_.size());
+    // 只需要重置下标，旧内容会被覆盖，不用清零
     readPos_ = 0;
     writePos_ = 0;
 }
 
+void Buffer::erase(size_t pos, size_t len) {
+    assert(pos + len <= readableBytes());
+    char* p = peek() + pos;
+    memmove(p, p + len, readableBytes() - pos - len);
+    writePos_ -= len;
+}
+
+void Buffer::shrink(size_t reserve) {
+    size_t readable = readableBytes();
+    std::unique_ptr<char[]> smaller(new char[readable + reserve]);
+    std::copy(peek(), peek() + readable, smaller.get());
+    buffer_.swap(smaller);
+    capacity_ = readable + reserve;
+    readPos_ = 0;
+    writePos_ = readable;
+}
+
 std::string Buffer::retrieveAllToStr() {
     std::string str(peek(), readableBytes());
     retrieveAll();
     return str;
 }
 
-const char* Buffer::BeginPtr_() const { return &*buffer_.begin(); }
-char* Buffer::BeginPtr_() { return &*buffer_.begin(); }
+const char* Buffer::BeginPtr_() const { return buffer_.get(); }
+char* Buffer::BeginPtr_() { return buffer_.get(); }
 
-void Buffer::MakeSpace_(size_t len) {
+void Buffer::ensureWritable(size_t len, size_t maxCapacity) {
+    if(writableBytes() < len) {
+        MakeSpace_(len, maxCapacity);
+    }
+}
+
+void Buffer::MakeSpace_(size_t len, size_t maxCapacity) {
+    size_t readable = readableBytes();
     if (writableBytes() + prependableBytes() < len) {
-        buffer_.resize(writePos_ + len + 1);
+        // 按倍数扩：连续追加的总拷贝量是线性的。换一块新内存，只拷可读的部分，
+        // 前面已经读走的不再跟着搬
+        // 新内存不清零：只拷可读的部分，后面的空间等着被写。
+        // 翻倍超过 maxCapacity 时只扩到 maxCapacity (但至少放得下这次的数据)
+        size_t size = std::max(capacity_ * 2, readable + len);
+        size = std::min(size, std::max(maxCapacity, readable + len));
+        std::unique_ptr<char[]> bigger(new char[size]);
+        std::copy(BeginPtr_() + readPos_, BeginPtr_() + writePos_, bigger.get());
+        buffer_.swap(bigger);
+        capacity_ = size;
+        readPos_ = 0;
+        writePos_ = readable;
     } else {
-        size_t readable = readableBytes();
         std::copy(BeginPtr_() + readPos_, BeginPtr_() + writePos_, BeginPtr_());
         readPos_ = 0;
         writePos_ = readPos_ + readable;
@@ -66,16 +103,19 @@ void Buffer::append(const void* data, size_t len) {
     append(static_cast<const char*>(data), len);
 }
 
-ssize_t Buffer::readFd(int fd, int* saveErrno) {
+ssize_t Buffer::readFd(int fd, int* saveErrno, size_t maxLen) {
     char extrabuf[65536];
     struct iovec vec[2];
-    const size_t writable = writableBytes();
+    // 栈上的 extrabuf 也只开到 maxLen 为止：不然一次读就能让容量翻倍再多 64KB
+    const size_t room = writableBytes() + prependableBytes();
+    const size_t writable = std::min(writableBytes(), maxLen);
+    const size_t extra = std::min(sizeof(extrabuf), maxLen - writable);
     vec[0].iov_base = BeginPtr_() + writePos_;
     vec[0].iov_len = writable;
     vec[1].iov_base = extrabuf;
-    vec[1].iov_len = sizeof(extrabuf);
+    vec[1].iov_len = extra;
 
-    const int iovcnt = (writable < sizeof(extrabuf)) ? 2 : 1;
+    const int iovcnt = (writable < sizeof(extrabuf) && extra > 0) ? 2 : 1;
     const ssize_t len = readv(fd, vec, iovcnt);
 
     if (len < 0) {
@@ -83,7 +123,10 @@ ssize_t Buffer::readFd(int fd, int* saveErrno) {
     } else if (static_cast<size_t>(len) <= writable) {
         writePos_ += len;
     } else {
-        writePos_ = buffer_.size();
+        writePos_ += writable;
+        // 挪出前面读走的空间以外，容量最多再涨 maxLen - room
+        size_t grow = maxLen > room ? maxLen - room : 0;
+        ensureWritable(len - writable, grow > SIZE_MAX - capacity_ ? SIZE_MAX : capacity_ + grow);
         append(extrabuf, len - writable);
     }
     return len;
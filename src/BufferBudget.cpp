@@ -0,0 +1,39 @@
+#include "BufferBudget.h"
+#include <algorithm>
+
+BufferBudget* BufferBudget::Instance() {
+    static BufferBudget budget;
+    return &budget;
+}
+
+bool BufferBudget::Charge(size_t from, size_t to) {
+    if(to <= from) {
+        used_ -= from - to;
+        return true;
+    }
+    size_t used = used_ += to - from;
+    size_t peak = peak_;
+    while(used > peak && !peak_.compare_exchange_weak(peak, used)) {}
+    if((perConn_ > 0 && to > perConn_) || (limit_ > 0 && used > limit_)) {
+        rejected_++;
+        return false;
+    }
+    return true;
+}
+
+size_t BufferBudget::Headroom(size_t charged) const {
+    size_t room = SIZE_MAX;
+    if(perConn_ > 0) {
+        room = perConn_ > charged ? perConn_ - charged : 0;
+    }
+    if(limit_ > 0) {
+        size_t used = used_;
+        room = std::min(room, limit_ > used ? limit_ - used : 0);
+    }
+    return room;
+}
+
+void BufferBudget::CountRelease(size_t bytes) {
+    releases_++;
+    releasedBytes_ += bytes;
+}
@@ -0,0 +1,238 @@
+#include "ChainBuffer.h"
+#include <cstring>
+#include <algorithm>
+#include <assert.h>
+#include <errno.h>
+
+// std::min 按引用取参数，类里的常量要有定义
+const size_t ChainBuffer::BLOCK_SIZE;
+const size_t ChainBuffer::MAX_FREE_BLOCKS;
+
+// 线程退出时把留着的块都释放掉。块可以在一个线程拿、另一个线程还 (线程池处理、loop 线程关闭)，
+// 每个链表都有上限，块在线程之间流动也不会越攒越多
+struct ChainBuffer::FreeList {
+    Block* head = nullptr;
+    size_t count = 0;
+
+    ~FreeList() {
+        while(head) {
+            Block* next = head->next;
+            delete head;
+            head = next;
+        }
+    }
+};
+
+ChainBuffer::FreeList& ChainBuffer::LocalFreeList_() {
+    static thread_local FreeList list;
+    return list;
+}
+
+ChainBuffer::Block* ChainBuffer::NewBlock_() {
+    FreeList& list = LocalFreeList_();
+    Block* block = list.head;
+    if(block) {
+        list.head = block->next;
+        list.count--;
+    } else {
+        // 不要值初始化：new Block() 会把 16KB 清零
+        block = new Block;
+    }
+    block->next = nullptr;
+    block->read = 0;
+    block->write = 0;
+    return block;
+}
+
+void ChainBuffer::FreeBlock_(Block* block) {
+    FreeList& list = LocalFreeList_();
+    if(list.count >= MAX_FREE_BLOCKS) {
+        delete block;
+        return;
+    }
+    block->next = list.head;
+    list.head = block;
+    list.count++;
+}
+
+size_t ChainBuffer::FreeBlocks() {
+    return LocalFreeList_().count;
+}
+
+ChainBuffer::ChainBuffer() : head_(nullptr), tail_(nullptr), size_(0), blocks_(0) {}
+
+ChainBuffer::~ChainBuffer() {
+    retrieveAll();
+}
+
+ChainBuffer::ChainBuffer(ChainBuffer&& other) noexcept
+    : head_(other.head_), tail_(other.tail_), size_(other.size_), blocks_(other.blocks_) {
+    other.head_ = other.tail_ = nullptr;
+    other.size_ = other.blocks_ = 0;
+}
+
+ChainBuffer& ChainBuffer::operator=(ChainBuffer&& other) noexcept {
+    if(this != &other) {
+        retrieveAll();
+        std::swap(head_, other.head_);
+        std::swap(tail_, other.tail_);
+        std::swap(size_, other.size_);
+        std::swap(blocks_, other.blocks_);
+    }
+    return *this;
+}
+
+void ChainBuffer::PushBlock_(Block* block) {
+    if(tail_) {
+        tail_->next = block;
+    } else {
+        head_ = block;
+    }
+    tail_ = block;
+    blocks_++;
+}
+
+void ChainBuffer::append(const void* data, size_t len) {
+    const char* p = static_cast<const char*>(data);
+    while(len > 0) {
+        if(!tail_ || tail_->write == BLOCK_SIZE) {
+            PushBlock_(NewBlock_());
+        }
+        size_t n = std::min(len, BLOCK_SIZE - tail_->write);
+        memcpy(tail_->data + tail_->write, p, n);
+        tail_->write += n;
+        size_ += n;
+        p += n;
+        len -= n;
+    }
+}
+
+char* ChainBuffer::reserve(size_t len) {
+    assert(len <= BLOCK_SIZE);
+    if(!tail_ || BLOCK_SIZE - tail_->write < len) {
+        PushBlock_(NewBlock_());
+    }
+    return tail_->data + tail_->write;
+}
+
+void ChainBuffer::commit(size_t len) {
+    assert(tail_ && tail_->write + len <= BLOCK_SIZE);
+    tail_->write += len;
+    size_ += len;
+}
+
+void ChainBuffer::retrieve(size_t len) {
+    assert(len <= size_);
+    size_ -= len;
+    while(len > 0) {
+        size_t n = std::min(len, head_->write - head_->read);
+        head_->read += n;
+        len -= n;
+        if(head_->read == head_->write && (head_ != tail_ || head_->write == BLOCK_SIZE)) {
+            // 读完的块马上还掉；尾块还能接着写的话留着
+            Block* next = head_->next;
+            FreeBlock_(head_);
+            head_ = next;
+            blocks_--;
+            if(!head_) tail_ = nullptr;
+        }
+    }
+    if(size_ == 0 && head_) {
+        // 只剩一个读空的尾块：下标归零，下一次从块头开始写
+        head_->read = head_->write = 0;
+    }
+}
+
+void ChainBuffer::retrieveAll() {
+    while(head_) {
+        Block* next = head_->next;
+        FreeBlock_(head_);
+        head_ = next;
+    }
+    tail_ = nullptr;
+    size_ = 0;
+    blocks_ = 0;
+}
+
+std::string ChainBuffer::retrieveAllToStr() {
+    std::string str;
+    str.reserve(size_);
+    for(Block* b = head_; b; b = b->next) {
+        str.append(b->data + b->read, b->write - b->read);
+    }
+    retrieveAll();
+    return str;
+}
+
+size_t ChainBuffer::peekIov(std::vector<struct iovec>* iov, size_t maxIov) const {
+    size_t total = 0;
+    for(Block* b = head_; b && maxIov > 0; b = b->next) {
+        size_t n = b->write - b->read;
+        if(n == 0) continue;
+        iov->push_back({b->data + b->read, n});
+        total += n;
+        maxIov--;
+    }
+    return total;
+}
+
+ssize_t ChainBuffer::readFd(int fd, int* saveErrno) {
+    // 尾块剩下的空间 + 最多 4 个新块 (64KB)，和 Buffer::readFd 一次读的量相当
+    static const int EXTRA_BLOCKS = 4;
+    struct iovec vec[EXTRA_BLOCKS + 1];
+    Block* extra[EXTRA_BLOCKS];
+    int iovcnt = 0;
+    size_t tailRoom = tail_ ? BLOCK_SIZE - tail_->write : 0;
+    if(tailRoom > 0) {
+        vec[iovcnt++] = {tail_->data + tail_->write, tailRoom};
+    }
+    for(int i = 0; i < EXTRA_BLOCKS; i++) {
+        extra[i] = NewBlock_();
+        vec[iovcnt++] = {extra[i]->data, BLOCK_SIZE};
+    }
+
+    const ssize_t len = readv(fd, vec, iovcnt);
+    if(len < 0) {
+        *saveErrno = errno;
+    }
+    size_t left = len > 0 ? static_cast<size_t>(len) : 0;
+    size_t n = std::min(left, tailRoom);
+    if(n > 0) {
+        tail_->write += n;
+        size_ += n;
+        left -= n;
+    }
+    for(int i = 0; i < EXTRA_BLOCKS; i++) {
+        if(left == 0) {
+            FreeBlock_(extra[i]);
+            continue;
+        }
+        n = std::min(left, BLOCK_SIZE);
+        extra[i]->write = n;
+        PushBlock_(extra[i]);
+        size_ += n;
+        left -= n;
+    }
+    return len;
+}
+
+ssize_t ChainBuffer::writeFd(int fd, int* saveErrno) {
+    static const int MAX_IOV = 64;
+    struct iovec vec[MAX_IOV];
+    int iovcnt = 0;
+    for(Block* b = head_; b && iovcnt < MAX_IOV; b = b->next) {
+        if(b->write > b->read) {
+            vec[iovcnt++] = {b->data + b->read, b->write - b->read};
+        }
+    }
+    if(iovcnt == 0) {
+        return 0;
+    }
+    ssize_t len = writev(fd, vec, iovcnt);
+    if(len < 0) {
+        *saveErrno = errno;
+        return len;
+    }
+    retrieve(len);
+    return len;
+}
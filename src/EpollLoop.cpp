@@ -0,0 +1,240 @@
+#include "EpollLoop.h"
+#include "log.h"
+#include <cerrno>
+
+EpollLoop::EpollLoop(ThreadPool* pool, int timeoutMs)
+    : EventLoop(pool, timeoutMs), epoller_(4096) {
+    epoller_.AddFd(wakeupFd_, EPOLLIN);
+}
+
+void EpollLoop::Listen(int port, bool reusePort) {
+    EventLoop::Listen(port, reusePort);
+    listenSock_->SetNonBlocking();
+    epoller_.AddFd(listenSock_->Fd(), EPOLLIN | EPOLLET);
+}
+
+void EpollLoop::Loop() {
+    while(!quit_) {
+        // 1. 获取最近的超时时间
+        int timeMs = timer_.getNextTick();
+
+        // 2. 阻塞等待事件
+        int number = epoller_.Wait(timeMs);
+        if(number < 0 && errno != EINTR) {
+            LOG_ERROR("Epoll wait failure");
+            break;
+        }
+
+        for(int i = 0; i < number; i++) {
+            int fd = epoller_.GetEventFd(i);
+            uint32_t events = epoller_.GetEvents(i);
+
+            if(fd == wakeupFd_) {
+                HandleWakeup_();
+            }
+            // A. 新连接
+            else if(listenSock_ && fd == listenSock_->Fd()) {
+                HandleAccept_();
+            }
+            // B. 异常断开
+            else if(events & (EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
+                timer_.doWork(fd); // 移除定时器并关闭
+            }
+            // C. 读写事件
+            else if(events & (EPOLLIN | EPOLLOUT)) {
+                HandleEvent_(&conns_[fd], events);
+            }
+        }
+
+        // 3. 跨线程投递过来的任务 (新连接、关闭请求等)
+        DoPendingFunctors_();
+    }
+}
+
+uint32_t EpollLoop::ConnEvent_() const {
+    // 交给线程池时必须 ONESHOT，保证同一时刻只有一个线程在处理某个 fd，每次处理完按需重新注册；
+    // 本线程处理时 EPOLLIN | EPOLLOUT 一次注册到底，ET 下 EPOLLOUT 只在发送缓冲区腾出空间时触发，
+    // 写不完也不需要 epoll_ctl
+    uint32_t ev = EPOLLIN | EPOLLET | EPOLLRDHUP;
+    return pool_ ? (ev | EPOLLONESHOT) : (ev | EPOLLOUT);
+}
+
+void EpollLoop::HandleAccept_() {
+    // ET 模式下必须把全连接队列 accept 干净
+    while(true) {
+        struct sockaddr_in addr;
+        socklen_t len = sizeof(addr);
+        int fd = accept4(listenSock_->Fd(), (struct sockaddr*)&addr, &len, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if(fd < 0) {
+            if(errno == EINTR) continue;
+            if(errno != EAGAIN && errno != EWOULDBLOCK) {
+                LOG_ERROR("Accept error: %d", errno);
+            }
+            return;
+        }
+        DispatchConn_(fd, addr);
+    }
+}
+
+void EpollLoop::HandleWakeup_() {
+    uint64_t one = 0;
+    ssize_t n = read(wakeupFd_, &one, sizeof(one));
+    (void)n;
+}
+
+void EpollLoop::AddConn(int fd, const sockaddr_in& addr) {
+    HttpConn* conn = &conns_[fd];
+    conn->Init(fd, addr, this);
+    epoller_.AddFd(fd, ConnEvent_());
+    timer_.add(fd, timeoutMs_, std::bind(&EpollLoop::CloseConn_, this, conn));
+    LOG_INFO("Client[%d](%s:%d) in, userCount:%d", fd, conn->GetIP(), conn->GetPort(), (int)HttpConn::userCount);
+}
+
+void EpollLoop::CloseConn_(HttpConn* conn) {
+    // 线程池模式下等正在处理它的工作线程做完；本线程处理时调用方可能已经拿着这把锁
+    std::unique_lock<std::mutex> locker(conn->Mutex(), std::defer_lock);
+    if(pool_) {
+        locker.lock();
+    }
+    epoller_.DelFd(conn->GetFd());
+    conn->Close();
+}
+
+int EpollLoop::KeepAlive_(int fd) {
+    auto it = conns_.find(fd);
+    if(it == conns_.end() || !it->second.KeepAliveTick()) {
+        return 0;
+    }
+    // 连接在这里被关掉的话 timer 里已经没有它，续期不生效
+    Wake_(&it->second);
+    return timeoutMs_;
+}
+
+void EpollLoop::ReleaseIdle_() {
+    int64_t now = HttpConn::NowMs();
+    for(auto& item : conns_) {
+        HttpConn& conn = item.second;
+        // 工作线程正在处理的连接下次再说，loop 线程不在这里等
+        std::unique_lock<std::mutex> locker(conn.Mutex(), std::defer_lock);
+        if(pool_ && !locker.try_lock()) {
+            continue;
+        }
+        conn.ReleaseIdle(now);
+    }
+}
+
+void EpollLoop::OnPush_(Subscriber& sub) {
+    auto it = conns_.find(sub.Fd());
+    if(it == conns_.end() || it->second.IsClosed()) {
+        return;
+    }
+    timer_.adjust(sub.Fd(), timeoutMs_);
+    Wake_(&it->second);
+}
+
+void EpollLoop::Wake_(HttpConn* conn) {
+    // 交给线程池时不能靠重新注册 EPOLLOUT 触发：工作线程可能正拿着这个连接 (ONESHOT 已经摘掉)，
+    // 重新注册会让第二个线程同时处理它。直接派一个任务，和事件任务一样在连接锁里串行
+    Dispatch_(conn, 0);
+}
+
+void EpollLoop::RequestClose_(HttpConn* conn) {
+    // 关闭动作必须回到 loop 线程做 (定时器、连接表都不是线程安全的)
+    int fd = conn->GetFd();
+    if(pool_) {
+        QueueInLoop([this, fd]() { timer_.doWork(fd); });
+    } else {
+        timer_.doWork(fd);
+    }
+}
+
+void EpollLoop::HandleEvent_(HttpConn* conn, uint32_t events) {
+    // 只要有活动，就更新定时器 (往后延)
+    timer_.adjust(conn->GetFd(), timeoutMs_);
+    Dispatch_(conn, events);
+}
+
+void EpollLoop::Dispatch_(HttpConn* conn, uint32_t events) {
+    // 线程池的队列满了就在 loop 线程里自己做：这段时间不 accept、不读新事件，压力自然传回客户端
+    if(!pool_ || !pool_->AddTask([this, conn, events]() { OnEvent_(conn, events); })) {
+        OnEvent_(conn, events);
+    }
+}
+
+void EpollLoop::OnEvent_(HttpConn* conn, uint32_t events) {
+    // 同一个连接可能同时有事件任务和推送任务在线程池里
+    std::lock_guard<std::mutex> locker(conn->Mutex());
+    if(conn->IsClosed()) {
+        return;
+    }
+    // 1. 先把上次没发完的数据接着发
+    bool wasBlocked = conn->IsWriteBlocked();
+    if(!Flush_(conn)) {
+        return;
+    }
+
+    // 2. 待发送数据没超过高水位才读新数据。
+    //    之前因为背压 (待发送超过高水位、读缓冲区到了预算上限) 跳过了读，ET 不会再通知一次，
+    //    能读的时候要主动补读
+    bool wantRead = (events & EPOLLIN) || wasBlocked || conn->IsReadBlocked();
+    while(true) {
+        if(!conn->IsWriteBlocked() && wantRead) {
+            int saveErrno = 0;
+            ssize_t ret = conn->read(&saveErrno);
+            if(ret <= 0 && saveErrno != EAGAIN && saveErrno != EWOULDBLOCK) {
+                // 对端关闭或出错
+                RequestClose_(conn);
+                return;
+            }
+        }
+
+        // 3. 上一批响应发完了才处理新的请求；读缓冲区里的流水线请求一次处理成一批
+        while(conn->ToWriteBytes() == 0 && conn->process()) {
+            if(!Flush_(conn)) {
+                return;
+            }
+        }
+
+        // 读缓冲区满了停下的：处理完腾出了空间就接着读。还有没发完的就等 EPOLLOUT 之后再读
+        if(!conn->IsReadBlocked() || conn->ToWriteBytes() > 0) {
+            break;
+        }
+        if(conn->ReadRoom() == 0) {
+            // 什么都发完了还是一个完整的请求都凑不齐：这个请求本身就超过了上限
+            LOG_WARN("Client[%d] request exceeds buffer budget, closing", conn->GetFd());
+            RequestClose_(conn);
+            return;
+        }
+        wantRead = true;
+    }
+
+    // 4. 重置 ONESHOT：有积压就关注 EPOLLOUT，超过高水位就不再关注 EPOLLIN
+    if(pool_) {
+        uint32_t ev = EPOLLET | EPOLLRDHUP;
+        if(conn->ToWriteBytes() > 0) ev |= EPOLLOUT;
+        if(!conn->IsWriteBlocked()) ev |= EPOLLIN;
+        epoller_.ModFd(conn->GetFd(), ev);
+    }
+}
+
+bool EpollLoop::Flush_(HttpConn* conn) {
+    if(conn->ToWriteBytes() == 0) {
+        return true;
+    }
+    int saveErrno = 0;
+    conn->write(&saveErrno);
+    if(conn->ToWriteBytes() > 0) {
+        if(saveErrno == EAGAIN || saveErrno == EWOULDBLOCK) {
+            // 发送缓冲区满：记住进度，等 EPOLLOUT
+            return true;
+        }
+        RequestClose_(conn);
+        return false;
+    }
+    // 一个响应发完：短连接直接关闭
+    if(!conn->IsKeepAlive()) {
+        RequestClose_(conn);
+        return false;
+    }
+    return true;
+}
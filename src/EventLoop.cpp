@@ -0,0 +1,103 @@
+#include "EventLoop.h"
+#include "EpollLoop.h"
+#include "UringLoop.h"
+#include "log.h"
+#include "http/HttpConn.h"
+#include <sys/eventfd.h>
+
+std::unique_ptr<EventLoop> EventLoop::Create(Backend backend, ThreadPool* pool, int timeoutMs) {
+    if(backend == URING) {
+        std::unique_ptr<UringLoop> loop(new UringLoop(timeoutMs));
+        if(loop->Valid()) {
+            return std::unique_ptr<EventLoop>(loop.release());
+        }
+        LOG_WARN("io_uring unavailable, falling back to epoll");
+    }
+    return std::unique_ptr<EventLoop>(new EpollLoop(pool, timeoutMs));
+}
+
+EventLoop::EventLoop(ThreadPool* pool, int timeoutMs)
+    : pool_(pool), timeoutMs_(timeoutMs), quit_(false), next_(0) {
+    wakeupFd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    assert(wakeupFd_ >= 0);
+    timer_.SetExpireHook(std::bind(&EventLoop::OnExpire_, this, std::placeholders::_1));
+    if(HttpConn::idleReleaseMs > 0) {
+        timer_.add(SWEEP_TIMER, HttpConn::idleReleaseMs, []() {});
+    }
+}
+
+EventLoop::~EventLoop() {
+    close(wakeupFd_);
+}
+
+void EventLoop::Listen(int port, bool reusePort) {
+    listenSock_.reset(new Socket());
+    listenSock_->SetReuseAddr();
+    if(reusePort) {
+        listenSock_->SetReusePort();
+    }
+    listenSock_->Bind(port);
+    listenSock_->Listen();
+}
+
+void EventLoop::SetSubLoops(const std::vector<EventLoop*>& loops) {
+    subLoops_ = loops;
+}
+
+void EventLoop::Quit() {
+    quit_ = true;
+    uint64_t one = 1;
+    ssize_t n = write(wakeupFd_, &one, sizeof(one));
+    (void)n;
+}
+
+void EventLoop::QueueInLoop(Functor cb) {
+    {
+        std::lock_guard<std::mutex> locker(mtx_);
+        pendingFunctors_.push_back(std::move(cb));
+    }
+    uint64_t one = 1;
+    ssize_t n = write(wakeupFd_, &one, sizeof(one));
+    (void)n;
+}
+
+void EventLoop::Push(std::vector<std::shared_ptr<Subscriber>> subs) {
+    QueueInLoop([this, subs = std::move(subs)]() {
+        for(const std::shared_ptr<Subscriber>& sub : subs) {
+            // 关闭连接也在 loop 线程里做，这里看到没关就是还没关
+            if(!sub->IsClosed()) {
+                OnPush_(*sub);
+            }
+        }
+    });
+}
+
+int EventLoop::OnExpire_(int id) {
+    if(id != SWEEP_TIMER) {
+        return KeepAlive_(id);
+    }
+    ReleaseIdle_();
+    return HttpConn::idleReleaseMs;
+}
+
+void EventLoop::DispatchConn_(int fd, const sockaddr_in& addr) {
+    if(subLoops_.empty()) {
+        AddConn(fd, addr);
+        return;
+    }
+    // 主 Reactor：轮询挑一个子 loop，把 fd 交给它
+    EventLoop* loop = subLoops_[next_];
+    next_ = (next_ + 1) % subLoops_.size();
+    loop->QueueInLoop([loop, fd, addr]() { loop->AddConn(fd, addr); });
+}
+
+void EventLoop::DoPendingFunctors_() {
+    std::vector<Functor> functors;
+    {
+        std::lock_guard<std::mutex> locker(mtx_);
+        functors.swap(pendingFunctors_);
+    }
+    for(Functor& cb : functors) {
+        cb();
+    }
+}
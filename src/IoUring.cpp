@@ -0,0 +1,201 @@
+#include "IoUring.h"
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <signal.h>
+#include <cerrno>
+#include <cstring>
+#include <cstdlib>
+#include <ctime>
+
+static int SysSetup(unsigned entries, io_uring_params* p) {
+    return static_cast<int>(syscall(__NR_io_uring_setup, entries, p));
+}
+
+static int SysEnter(int fd, unsigned toSubmit, unsigned minComplete, unsigned flags, void* arg, size_t argSize) {
+    return static_cast<int>(syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, arg, argSize));
+}
+
+static int SysRegister(int fd, unsigned opcode, void* arg, unsigned nrArgs) {
+    return static_cast<int>(syscall(__NR_io_uring_register, fd, opcode, arg, nrArgs));
+}
+
+IoUring::IoUring(unsigned entries)
+    : ringFd_(-1), sqeTail_(0), submitted_(0),
+      sqRing_(MAP_FAILED), sqRingSize_(0), sqHead_(nullptr), sqTail_(nullptr), sqArray_(nullptr),
+      sqMask_(0), sqEntries_(0), sqes_(nullptr), sqesSize_(0),
+      cqRing_(MAP_FAILED), cqHead_(nullptr), cqTail_(nullptr), cqMask_(0), cqes_(nullptr),
+      bufRing_(nullptr), bufRingSize_(0), bufRingMask_(0), bufRingTail_(0),
+      bufBase_(nullptr), bufSize_(0) {
+    io_uring_params p;
+    memset(&p, 0, sizeof(p));
+    // multishot 会产生大量 CQE，CQ 开到 SQ 的 4 倍
+    p.flags = IORING_SETUP_CQSIZE | IORING_SETUP_COOP_TASKRUN;
+    p.cq_entries = entries * 4;
+    int fd = SysSetup(entries, &p);
+    if(fd < 0 && errno == EINVAL) {
+        // 老内核不认识 COOP_TASKRUN
+        memset(&p, 0, sizeof(p));
+        p.flags = IORING_SETUP_CQSIZE;
+        p.cq_entries = entries * 4;
+        fd = SysSetup(entries, &p);
+    }
+    if(fd < 0) {
+        return;
+    }
+    // 需要 SINGLE_MMAP 和 EXT_ARG (带超时的 io_uring_enter)，没有就当不支持
+    if(!(p.features & IORING_FEAT_SINGLE_MMAP) || !(p.features & IORING_FEAT_EXT_ARG)) {
+        close(fd);
+        return;
+    }
+
+    sqRingSize_ = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    size_t cqRingSize = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+    if(cqRingSize > sqRingSize_) sqRingSize_ = cqRingSize;
+    sqRing_ = mmap(nullptr, sqRingSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    if(sqRing_ == MAP_FAILED) {
+        close(fd);
+        return;
+    }
+    cqRing_ = sqRing_;   // SINGLE_MMAP: SQ/CQ 共用一块映射
+
+    sqesSize_ = p.sq_entries * sizeof(io_uring_sqe);
+    void* sqes = mmap(nullptr, sqesSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if(sqes == MAP_FAILED) {
+        munmap(sqRing_, sqRingSize_);
+        sqRing_ = MAP_FAILED;
+        close(fd);
+        return;
+    }
+    sqes_ = static_cast<io_uring_sqe*>(sqes);
+
+    char* sq = static_cast<char*>(sqRing_);
+    sqHead_ = reinterpret_cast<unsigned*>(sq + p.sq_off.head);
+    sqTail_ = reinterpret_cast<unsigned*>(sq + p.sq_off.tail);
+    sqArray_ = reinterpret_cast<unsigned*>(sq + p.sq_off.array);
+    sqMask_ = *reinterpret_cast<unsigned*>(sq + p.sq_off.ring_mask);
+    sqEntries_ = p.sq_entries;
+    // SQE 下标和 array 一一对应，初始化一次即可
+    for(unsigned i = 0; i < sqEntries_; i++) {
+        sqArray_[i] = i;
+    }
+    sqeTail_ = submitted_ = *sqTail_;
+
+    char* cq = static_cast<char*>(cqRing_);
+    cqHead_ = reinterpret_cast<unsigned*>(cq + p.cq_off.head);
+    cqTail_ = reinterpret_cast<unsigned*>(cq + p.cq_off.tail);
+    cqMask_ = *reinterpret_cast<unsigned*>(cq + p.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<io_uring_cqe*>(cq + p.cq_off.cqes);
+
+    ringFd_ = fd;
+}
+
+IoUring::~IoUring() {
+    if(bufRing_) {
+        munmap(bufRing_, bufRingSize_);
+        free(bufBase_);
+    }
+    if(sqes_) munmap(sqes_, sqesSize_);
+    if(sqRing_ != MAP_FAILED) munmap(sqRing_, sqRingSize_);
+    if(ringFd_ >= 0) close(ringFd_);
+}
+
+io_uring_sqe* IoUring::GetSqe() {
+    unsigned head = __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE);
+    if(sqeTail_ - head >= sqEntries_) {
+        // SQ 满了：先把已有的提交掉
+        Submit();
+        head = __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE);
+        if(sqeTail_ - head >= sqEntries_) {
+            return nullptr;
+        }
+    }
+    io_uring_sqe* sqe = &sqes_[sqeTail_ & sqMask_];
+    sqeTail_++;
+    memset(sqe, 0, sizeof(*sqe));
+    return sqe;
+}
+
+int IoUring::Submit() {
+    unsigned toSubmit = sqeTail_ - submitted_;
+    if(toSubmit == 0) return 0;
+    __atomic_store_n(sqTail_, sqeTail_, __ATOMIC_RELEASE);
+    submitted_ = sqeTail_;
+    int ret;
+    do {
+        ret = SysEnter(ringFd_, toSubmit, 0, 0, nullptr, 0);
+    } while(ret < 0 && errno == EINTR);
+    return ret;
+}
+
+int IoUring::SubmitAndWait(int timeoutMs) {
+    unsigned toSubmit = sqeTail_ - submitted_;
+    __atomic_store_n(sqTail_, sqeTail_, __ATOMIC_RELEASE);
+    submitted_ = sqeTail_;
+
+    // 已经有 CQE 就不要阻塞，只提交
+    unsigned minComplete = 1;
+    if(*cqHead_ != __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE)) {
+        minComplete = 0;
+    }
+
+    __kernel_timespec ts;
+    io_uring_getevents_arg arg;
+    memset(&arg, 0, sizeof(arg));
+    arg.sigmask_sz = _NSIG / 8;
+    if(timeoutMs >= 0) {
+        ts.tv_sec = timeoutMs / 1000;
+        ts.tv_nsec = static_cast<long long>(timeoutMs % 1000) * 1000000;
+        arg.ts = reinterpret_cast<uint64_t>(&ts);
+    }
+    int ret = SysEnter(ringFd_, toSubmit, minComplete,
+                       IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &arg, sizeof(arg));
+    if(ret < 0 && (errno == ETIME || errno == EINTR)) {
+        return 0;
+    }
+    return ret;
+}
+
+bool IoUring::SetupBufRing(uint16_t bgid, unsigned entries, size_t bufSize) {
+    // entries 必须是 2 的幂
+    bufRingSize_ = entries * sizeof(io_uring_buf);
+    void* ring = mmap(nullptr, bufRingSize_, PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+    if(ring == MAP_FAILED) {
+        return false;
+    }
+
+    io_uring_buf_reg reg;
+    memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = reinterpret_cast<uint64_t>(ring);
+    reg.ring_entries = entries;
+    reg.bgid = bgid;
+    if(SysRegister(ringFd_, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+        munmap(ring, bufRingSize_);
+        return false;
+    }
+
+    bufRing_ = static_cast<io_uring_buf_ring*>(ring);
+    bufRingMask_ = entries - 1;
+    bufRingTail_ = 0;
+    bufSize_ = bufSize;
+    bufBase_ = static_cast<char*>(malloc(entries * bufSize));
+    if(!bufBase_) {
+        return false;
+    }
+    for(unsigned i = 0; i < entries; i++) {
+        RecycleBuf(static_cast<uint16_t>(i));
+    }
+    return true;
+}
+
+void IoUring::RecycleBuf(uint16_t bid) {
+    // 注意：内核头文件里 bufs[] 用 __DECLARE_FLEX_ARRAY 声明，C++ 中空 struct 占 1 字节，
+    // bufRing_->bufs 会整体偏移 8 字节。直接把环当作 io_uring_buf 数组来索引。
+    io_uring_buf* buf = reinterpret_cast<io_uring_buf*>(bufRing_) + (bufRingTail_ & bufRingMask_);
+    buf->addr = reinterpret_cast<uint64_t>(Buf(bid));
+    buf->len = static_cast<uint32_t>(bufSize_);
+    buf->bid = bid;
+    bufRingTail_++;
+    // tail 和 bufs[0].resv 共用同一个位置，发布时用 release 语义
+    __atomic_store_n(&bufRing_->tail, bufRingTail_, __ATOMIC_RELEASE);
+}
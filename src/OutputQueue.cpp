@@ -0,0 +1,180 @@
+#include "OutputQueue.h"
+#include <cstring>
+#include <algorithm>
+#include <assert.h>
+#include <errno.h>
+#include <sys/socket.h>
+#include <sys/sendfile.h>
+
+// 比这短的追加不跨块：帧头、chunk 长度行拆成两段反而多占一个 iovec
+static const size_t SMALL_APPEND = 64;
+
+OutputQueue::OutputQueue() : head_(0), firstFile_(0), bytes_(0), memBytes_(0), reserved_(nullptr) {}
+
+void OutputQueue::Push_(Kind kind, const char* data, size_t len, Holder holder) {
+    if(len == 0) {
+        return;
+    }
+    bytes_ += len;
+    bool noFile = firstFile_ == segments_.size();
+    if(kind != FILE && noFile) {
+        memBytes_ += len;
+    }
+    if((kind == OWNED || kind == REF) && segments_.size() > head_) {
+        // 紧挨着上一段 (同一个块里接着写的、同一个 Buffer 里相邻的头部) 就合并，少占一个 iovec
+        Segment& last = segments_.back();
+        if(last.kind == kind && last.data + last.len == data) {
+            last.len += len;
+            return;
+        }
+    }
+    segments_.push_back({kind, data, -1, 0, len, std::move(holder)});
+    if(kind != FILE && noFile) {
+        firstFile_++;
+    }
+}
+
+void OutputQueue::Append(const void* data, size_t len) {
+    const char* p = static_cast<const char*>(data);
+    while(len > 0) {
+        // 先填满尾块再接新块；小片段放不下就整个进新块
+        size_t n = std::min(len, owned_.writableBytes());
+        if(n == 0 || (n < len && len <= SMALL_APPEND)) {
+            n = std::min(len, ChainBuffer::BLOCK_SIZE);
+        }
+        memcpy(Reserve(n), p, n);
+        Commit(n);
+        p += n;
+        len -= n;
+    }
+}
+
+char* OutputQueue::Reserve(size_t len) {
+    reserved_ = owned_.reserve(len);
+    return reserved_;
+}
+
+void OutputQueue::Commit(size_t len) {
+    owned_.commit(len);
+    Push_(OWNED, reserved_, len, Holder());
+    reserved_ += len;
+}
+
+void OutputQueue::AppendRef(const void* data, size_t len) {
+    Push_(REF, static_cast<const char*>(data), len, Holder());
+}
+
+void OutputQueue::AppendShared(Holder holder, const void* data, size_t len) {
+    Push_(SHARED, static_cast<const char*>(data), len, std::move(holder));
+}
+
+void OutputQueue::AppendFile(int fd, off_t offset, size_t len, Holder holder) {
+    if(len == 0) {
+        return;
+    }
+    Push_(FILE, nullptr, len, std::move(holder));
+    segments_.back().fd = fd;
+    segments_.back().offset = offset;
+}
+
+size_t OutputQueue::PeekIov(std::vector<struct iovec>* iov, size_t maxIov) const {
+    size_t total = 0;
+    for(size_t i = head_; i < firstFile_ && maxIov > 0; i++, maxIov--) {
+        const Segment& seg = segments_[i];
+        iov->push_back({const_cast<char*>(seg.data), seg.len});
+        total += seg.len;
+    }
+    return total;
+}
+
+const OutputQueue::Segment* OutputQueue::FirstFile() const {
+    return firstFile_ < segments_.size() ? &segments_[firstFile_] : nullptr;
+}
+
+void OutputQueue::FindFile_() {
+    memBytes_ = 0;
+    firstFile_ = head_;
+    while(firstFile_ < segments_.size() && segments_[firstFile_].kind != FILE) {
+        memBytes_ += segments_[firstFile_].len;
+        firstFile_++;
+    }
+}
+
+void OutputQueue::Advance(size_t len) {
+    assert(len <= bytes_);
+    bytes_ -= len;
+    while(len > 0) {
+        Segment& seg = segments_[head_];
+        size_t n = std::min(len, seg.len);
+        seg.len -= n;
+        len -= n;
+        if(seg.kind == FILE) {
+            seg.offset += n;
+        } else {
+            seg.data += n;
+            memBytes_ -= n;
+            if(seg.kind == OWNED) {
+                owned_.retrieve(n);
+            }
+        }
+        if(seg.len > 0) {
+            break;
+        }
+        // 这一段发完了：共享的内存 / 文件马上放掉，不等整批
+        seg.holder.reset();
+        head_++;
+        if(seg.kind == FILE) {
+            FindFile_();
+        }
+    }
+    if(head_ == segments_.size()) {
+        segments_.clear();
+        head_ = 0;
+        firstFile_ = 0;
+    }
+}
+
+void OutputQueue::Clear() {
+    segments_.clear();
+    head_ = 0;
+    firstFile_ = 0;
+    bytes_ = 0;
+    memBytes_ = 0;
+    owned_.retrieveAll();
+}
+
+ssize_t OutputQueue::WriteFd(int fd, int* saveErrno) {
+    if(bytes_ == 0) {
+        return 0;
+    }
+    ssize_t len;
+    if(memBytes_ == 0) {
+        const Segment& seg = segments_[head_];
+        off_t offset = seg.offset;
+        len = sendfile(fd, seg.fd, &offset, seg.len);
+        if(len == 0) {
+            // 文件在发送过程中被截短了，剩下的永远发不出去
+            *saveErrno = EIO;
+            return -1;
+        }
+    } else {
+        iov_.clear();
+        size_t n = PeekIov(&iov_);
+        if(n == memBytes_ && FirstFile()) {
+            // 内存部分后面紧跟文件：MSG_MORE 让内核先攒着，和文件开头拼成满 MSS 的包再发
+            struct msghdr msg;
+            memset(&msg, 0, sizeof(msg));
+            msg.msg_iov = iov_.data();
+            msg.msg_iovlen = iov_.size();
+            len = sendmsg(fd, &msg, MSG_MORE | MSG_NOSIGNAL);
+        } else {
+            len = writev(fd, iov_.data(), static_cast<int>(iov_.size()));
+        }
+    }
+    if(len < 0) {
+        *saveErrno = errno;
+        return len;
+    }
+    Advance(static_cast<size_t>(len));
+    return len;
+}
@@ -57,6 +57,15 @@ void Socket::SetReuseAddr() {
     setsockopt(fd_, SOL_SOCKET, SO_REUSEADDR, &optval, sizeof(optval));
 }
 
+// SO_REUSEPORT：每个 EventLoop 各自 bind 同一个端口，
+// 内核按四元组哈希把新连接分散到各个监听 socket 上，accept 不再集中在一个线程
+void Socket::SetReusePort() {
+    int optval = 1;
+    if(setsockopt(fd_, SOL_SOCKET, SO_REUSEPORT, &optval, sizeof(optval)) < 0) {
+        throw std::runtime_error("Set SO_REUSEPORT error!");
+    }
+}
+
 // 【面试必考】设置非阻塞
 // 场景：配合 Epoll 的 ET (边缘触发) 模式必须使用非阻塞 IO
 void Socket::SetNonBlocking() {
@@ -0,0 +1,495 @@
+#include "UringLoop.h"
+#include "log.h"
+#include <poll.h>
+#include <fcntl.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+UringLoop::UringLoop(int timeoutMs)
+    : EventLoop(nullptr, timeoutMs), ring_(4096), valid_(false),
+      multishotAccept_(true), multishotRecv_(true) {
+    if(!ring_.Valid()) {
+        return;
+    }
+    // PBUF_RING 需要 5.19+，注册失败就整体回退到 epoll
+    valid_ = ring_.SetupBufRing(BUF_GROUP, BUF_COUNT, BUF_SIZE);
+}
+
+io_uring_sqe* UringLoop::Sqe_() {
+    io_uring_sqe* sqe = ring_.GetSqe();
+    // GetSqe 内部已经提交过一次，还拿不到说明内核处理不过来，等一等再试
+    while(!sqe) {
+        ring_.SubmitAndWait(0);
+        sqe = ring_.GetSqe();
+    }
+    return sqe;
+}
+
+void UringLoop::ArmAccept_() {
+    io_uring_sqe* sqe = Sqe_();
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = listenSock_->Fd();
+    // 监听 socket 保持阻塞：非阻塞 fd 会让 io_uring 直接返回 -EAGAIN 而不是挂 poll
+    sqe->accept_flags = SOCK_CLOEXEC;
+    if(multishotAccept_) {
+        sqe->ioprio |= IORING_ACCEPT_MULTISHOT;
+    }
+    sqe->user_data = UserData_(OP_ACCEPT, listenSock_->Fd());
+}
+
+void UringLoop::ArmWakeup_() {
+    // eventfd 是非阻塞的，用 multishot poll 代替 read
+    io_uring_sqe* sqe = Sqe_();
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = wakeupFd_;
+    sqe->poll32_events = POLLIN;
+    sqe->len = IORING_POLL_ADD_MULTI;
+    sqe->user_data = UserData_(OP_WAKEUP, wakeupFd_);
+}
+
+void UringLoop::ArmRecv_(Conn& conn) {
+    io_uring_sqe* sqe = Sqe_();
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = conn.http.GetFd();
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = BUF_GROUP;
+    if(multishotRecv_) {
+        sqe->ioprio |= IORING_RECV_MULTISHOT;
+    }
+    sqe->user_data = UserData_(OP_RECV, conn.http.GetFd());
+    conn.recvArmed = true;
+    conn.inflight++;
+}
+
+void UringLoop::PauseRecv_(Conn& conn) {
+    conn.recvPaused = true;
+    if(!conn.recvArmed || conn.recvCancelPending) {
+        return;
+    }
+    // multishot recv 停不下来，只能取消；对应的 recv CQE 会以 -ECANCELED 结束
+    io_uring_sqe* sqe = Sqe_();
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->addr = UserData_(OP_RECV, conn.http.GetFd());
+    sqe->user_data = UserData_(OP_CANCEL, conn.http.GetFd());
+    conn.inflight++;
+    conn.recvCancelPending = true;
+}
+
+void UringLoop::ResumeRecv_(Conn& conn) {
+    // 取消还没了结时不能动：发送完成可能比取消先回来，这时 recv 还挂着，
+    // 紧接着会来一个 -ECANCELED。等它回来 (OnRecv_) 再决定。
+    // 读缓冲区在预算里放不下下一块 recv 数据时也不恢复，等处理掉已经收到的请求
+    if(!conn.recvPaused || conn.recvCancelPending || conn.closing || conn.http.IsWriteBlocked() ||
+       conn.http.ReadRoom() < BUF_SIZE) {
+        return;
+    }
+    conn.recvPaused = false;
+    if(!conn.recvArmed) {
+        ArmRecv_(conn);
+    }
+}
+
+bool UringLoop::OpenPipe_(Conn& conn) {
+    if(conn.pipe[0] >= 0) {
+        return true;
+    }
+    if(pipe2(conn.pipe, O_CLOEXEC) < 0) {
+        return false;
+    }
+    // pipe 越大，一轮 splice 搬得越多；调不上去就用默认的 64KB
+    fcntl(conn.pipe[1], F_SETPIPE_SZ, 1024 * 1024);
+    int cap = fcntl(conn.pipe[1], F_GETPIPE_SZ);
+    conn.pipeCap = cap > 0 ? static_cast<size_t>(cap) : 65536;
+    conn.pipeBytes = 0;
+    return true;
+}
+
+void UringLoop::ClosePipe_(Conn& conn) {
+    if(conn.pipe[0] >= 0) {
+        close(conn.pipe[0]);
+        close(conn.pipe[1]);
+        conn.pipe[0] = conn.pipe[1] = -1;
+    }
+    conn.pipeBytes = 0;
+}
+
+void UringLoop::SubmitSend_(Conn& conn) {
+    // 一轮发送：[sendmsg 队列开头的内存段] -> [splice 紧跟着的文件->pipe] -> [splice pipe->socket] -> [shutdown]
+    // 用 IOSQE_IO_LINK 串起来一次提交；任何一步短了链就断，后面的收到 -ECANCELED，
+    // 等这一轮的 CQE 全部回来后从断点再提交下一轮。文件后面还有内存段的话下一轮接着发
+    int fd = conn.http.GetFd();
+    const OutputQueue& out = conn.http.Output();
+    io_uring_sqe* last = nullptr;
+    size_t roundBytes = 0;
+
+    // 内存段超过 IOV_MAX 的话这一轮只发前面的，文件留到下一轮
+    conn.iov.clear();
+    size_t memBytes = out.PeekIov(&conn.iov);
+    const OutputQueue::Segment* file = memBytes == out.MemBytes() ? out.FirstFile() : nullptr;
+
+    if(memBytes > 0) {
+        memset(&conn.msg, 0, sizeof(conn.msg));
+        conn.msg.msg_iov = conn.iov.data();
+        conn.msg.msg_iovlen = conn.iov.size();
+
+        io_uring_sqe* sqe = Sqe_();
+        sqe->opcode = IORING_OP_SENDMSG;
+        sqe->fd = fd;
+        sqe->addr = reinterpret_cast<uint64_t>(&conn.msg);
+        sqe->len = 1;
+        // WAITALL：让内核自己把短写补完；后面还有文件时 MSG_MORE 让头和文件拼包
+        sqe->msg_flags = MSG_NOSIGNAL | MSG_WAITALL;
+        if(file) {
+            sqe->msg_flags |= MSG_MORE;
+        }
+        sqe->user_data = UserData_(OP_SEND, fd);
+        conn.inflight++;
+        conn.sendOps++;
+        roundBytes += memBytes;
+        last = sqe;
+    }
+
+    if(file) {
+        if(!OpenPipe_(conn)) {
+            LOG_ERROR("Client[%d] pipe2 error: %d", fd, errno);
+            if(conn.sendOps == 0) timer_.doWork(fd);
+            return;
+        }
+        // pipe 里还有上一轮没搬走的 (短写，或者 splice 进来的比要求的少)：这一轮只往外搬。
+        // 否则 pipe 按页占槽，文件偏移不对齐时塞满了字节数还没到 pipeCap，
+        // 再 splice 进去会一直等 pipe 腾地方，而往外搬的那一步链在它后面，永远等不到。
+        size_t inLen = 0;
+        if(conn.pipeBytes == 0) {
+            // 少搬一页：不对齐的偏移会多占一页
+            inLen = std::min(file->len, conn.pipeCap - PIPE_PAGE);
+            if(last) last->flags |= IOSQE_IO_LINK;
+            io_uring_sqe* sqe = Sqe_();
+            sqe->opcode = IORING_OP_SPLICE;
+            sqe->splice_fd_in = file->fd;
+            sqe->splice_off_in = file->offset;
+            sqe->fd = conn.pipe[1];
+            sqe->off = static_cast<uint64_t>(-1);
+            sqe->len = static_cast<uint32_t>(inLen);
+            sqe->splice_flags = SPLICE_F_MOVE;
+            sqe->user_data = UserData_(OP_SPLICE_IN, fd);
+            conn.inflight++;
+            conn.sendOps++;
+            last = sqe;
+        }
+        size_t outLen = conn.pipeBytes + inLen;
+        if(last) last->flags |= IOSQE_IO_LINK;
+        io_uring_sqe* sqe = Sqe_();
+        sqe->opcode = IORING_OP_SPLICE;
+        sqe->splice_fd_in = conn.pipe[0];
+        sqe->splice_off_in = static_cast<uint64_t>(-1);
+        sqe->fd = fd;
+        sqe->off = static_cast<uint64_t>(-1);
+        sqe->len = static_cast<uint32_t>(outLen);
+        sqe->splice_flags = SPLICE_F_MOVE;
+        sqe->user_data = UserData_(OP_SPLICE_OUT, fd);
+        conn.inflight++;
+        conn.sendOps++;
+        roundBytes += outLen;
+        last = sqe;
+    }
+
+    // 响应是 Connection: close 且这一轮能发完：把 shutdown 链在最后，发完由内核直接半关闭
+    if(!conn.http.IsKeepAlive() && roundBytes == conn.http.ToWriteBytes()) {
+        last->flags |= IOSQE_IO_LINK;
+        io_uring_sqe* shut = Sqe_();
+        shut->opcode = IORING_OP_SHUTDOWN;
+        shut->fd = fd;
+        shut->len = SHUT_WR;
+        shut->user_data = UserData_(OP_SHUTDOWN, fd);
+        conn.inflight++;
+    }
+}
+
+void UringLoop::Loop() {
+    if(listenSock_) {
+        ArmAccept_();
+    }
+    ArmWakeup_();
+
+    while(!quit_) {
+        // 1. 获取最近的超时时间
+        int timeMs = timer_.getNextTick();
+
+        // 2. 提交本轮积攒的所有 SQE，同时等待完成事件 (一次系统调用)
+        if(ring_.SubmitAndWait(timeMs) < 0) {
+            LOG_ERROR("io_uring_enter failure: %d", errno);
+            break;
+        }
+
+        ring_.ForEachCqe([this](const io_uring_cqe* cqe) { HandleCqe_(cqe); });
+
+        // 3. 跨线程投递过来的任务 (新连接、关闭请求等)
+        DoPendingFunctors_();
+    }
+}
+
+void UringLoop::HandleCqe_(const io_uring_cqe* cqe) {
+    OpType op = static_cast<OpType>(cqe->user_data >> 32);
+    int fd = static_cast<int>(cqe->user_data & 0xffffffff);
+
+    if(op == OP_ACCEPT) {
+        OnAccept_(cqe);
+        return;
+    }
+    if(op == OP_WAKEUP) {
+        uint64_t one = 0;
+        ssize_t n = read(wakeupFd_, &one, sizeof(one));
+        (void)n;
+        if(!(cqe->flags & IORING_CQE_F_MORE)) {
+            ArmWakeup_();
+        }
+        return;
+    }
+
+    auto it = conns_.find(fd);
+    if(it == conns_.end() || it->second.http.IsClosed()) {
+        // 不可能发生：连接在 inflight 归零前不会关闭。缓冲区还是要还回去
+        if(cqe->flags & IORING_CQE_F_BUFFER) {
+            ring_.RecycleBuf(static_cast<uint16_t>(cqe->flags >> IORING_CQE_BUFFER_SHIFT));
+        }
+        return;
+    }
+    Conn& conn = it->second;
+
+    switch(op) {
+        case OP_RECV:
+            OnRecv_(conn, cqe);
+            break;
+        case OP_SEND:
+        case OP_SPLICE_IN:
+        case OP_SPLICE_OUT:
+            conn.inflight--;
+            conn.sendOps--;
+            OnSend_(conn, op, cqe->res);
+            break;
+        case OP_SHUTDOWN:
+        case OP_CANCEL:
+            conn.inflight--;
+            break;
+        default:
+            break;
+    }
+    TryRelease_(conn);
+}
+
+void UringLoop::OnAccept_(const io_uring_cqe* cqe) {
+    bool more = cqe->flags & IORING_CQE_F_MORE;
+    if(cqe->res >= 0) {
+        struct sockaddr_in addr;
+        socklen_t len = sizeof(addr);
+        memset(&addr, 0, sizeof(addr));
+        getpeername(cqe->res, (struct sockaddr*)&addr, &len);
+        DispatchConn_(cqe->res, addr);
+    } else if(cqe->res == -EINVAL && multishotAccept_) {
+        // 内核不支持 multishot accept (< 5.19)，退化成每次重新提交
+        multishotAccept_ = false;
+        LOG_WARN("multishot accept unsupported, using one-shot accept");
+    } else if(cqe->res != -EINTR && cqe->res != -EAGAIN) {
+        LOG_ERROR("Accept error: %d", -cqe->res);
+    }
+    if(!more && !quit_) {
+        ArmAccept_();
+    }
+}
+
+void UringLoop::AddConn(int fd, const sockaddr_in& addr) {
+    Conn& conn = conns_[fd];
+    conn.http.Init(fd, addr, this);
+    conn.inflight = 0;
+    conn.recvArmed = false;
+    conn.recvPaused = false;
+    conn.recvCancelPending = false;
+    conn.sendOps = 0;
+    conn.closing = false;
+    conn.pipeBytes = 0;
+    ArmRecv_(conn);
+    timer_.add(fd, timeoutMs_, std::bind(&UringLoop::CloseConn_, this, fd));
+    LOG_INFO("Client[%d](%s:%d) in, userCount:%d", fd, conn.http.GetIP(), conn.http.GetPort(), (int)HttpConn::userCount);
+}
+
+void UringLoop::OnRecv_(Conn& conn, const io_uring_cqe* cqe) {
+    bool cancelled = false;
+    if(!(cqe->flags & IORING_CQE_F_MORE)) {
+        // multishot 结束 (出错、EOF、缓冲区耗尽、被取消) 或者本来就是 one-shot
+        conn.recvArmed = false;
+        conn.inflight--;
+        // 暂停发出的取消到这里才算了结 (也可能取消到达之前 recv 已经自己结束了)
+        cancelled = conn.recvCancelPending;
+        conn.recvCancelPending = false;
+    }
+
+    int res = cqe->res;
+    if(cqe->flags & IORING_CQE_F_BUFFER) {
+        uint16_t bid = static_cast<uint16_t>(cqe->flags >> IORING_CQE_BUFFER_SHIFT);
+        // 关闭中的连接还会陆续收到已经在内核里的数据，不用再攒
+        if(res > 0 && !conn.closing) {
+            conn.http.Receive(ring_.Buf(bid), res);
+        }
+        ring_.RecycleBuf(bid);
+    }
+
+    if(conn.closing) {
+        return;
+    }
+    if(res == -ECANCELED && cancelled) {
+        // 这期间积压可能已经发完了 (OnSend_ 那时候还不能恢复)
+        ResumeRecv_(conn);
+        return;
+    }
+    if(res == -EINVAL && multishotRecv_) {
+        // 内核不支持 multishot recv (< 6.0)
+        multishotRecv_ = false;
+        LOG_WARN("multishot recv unsupported, using one-shot recv");
+    }
+    else if(res == 0 || (res < 0 && res != -ENOBUFS)) {
+        // 对端关闭或出错
+        timer_.doWork(conn.http.GetFd());
+        return;
+    }
+
+    if(res > 0) {
+        // 只要有活动，就更新定时器 (往后延)
+        timer_.adjust(conn.http.GetFd(), timeoutMs_);
+        if(conn.sendOps == 0 && conn.http.ToWriteBytes() == 0) {
+            Process_(conn);
+        }
+        if(!CheckReadRoom_(conn)) {
+            return;
+        }
+    }
+    // ENOBUFS：缓冲区已经还回去了，重新挂上即可；暂停中的等积压降下来
+    if(!conn.recvArmed && !conn.closing) {
+        if(conn.recvPaused) {
+            ResumeRecv_(conn);
+        } else {
+            ArmRecv_(conn);
+        }
+    }
+}
+
+void UringLoop::Process_(Conn& conn) {
+    if(conn.http.process()) {
+        SubmitSend_(conn);
+        if(conn.http.IsWriteBlocked()) {
+            PauseRecv_(conn);
+        }
+    }
+}
+
+// 读缓冲区在预算里放不下下一块 recv 数据：有响应在发就先停收 (和高水位一样)，发完处理掉请求再收。
+// 什么都发完了还是放不下，说明一个请求本身就超过了上限，关掉。返回 false 表示关了
+bool UringLoop::CheckReadRoom_(Conn& conn) {
+    if(conn.http.ReadRoom() >= BUF_SIZE) {
+        return true;
+    }
+    if(conn.sendOps == 0 && conn.http.ToWriteBytes() == 0) {
+        LOG_WARN("Client[%d] request exceeds buffer budget, closing", conn.http.GetFd());
+        timer_.doWork(conn.http.GetFd());
+        return false;
+    }
+    PauseRecv_(conn);
+    return true;
+}
+
+void UringLoop::OnSend_(Conn& conn, OpType op, int res) {
+    if(res < 0 && res != -ECANCELED) {
+        if(!conn.closing) {
+            timer_.doWork(conn.http.GetFd());
+        }
+        return;
+    }
+    if(res > 0) {
+        if(op == OP_SPLICE_IN) {
+            conn.pipeBytes += res;
+        } else {
+            if(op == OP_SPLICE_OUT) {
+                conn.pipeBytes -= res;
+            }
+            conn.http.AdvanceWrite(static_cast<size_t>(res));
+        }
+    }
+    if(conn.sendOps > 0 || conn.closing) {
+        // 这一轮还有请求在内核里
+        return;
+    }
+
+    // 降到高水位以下，恢复读
+    ResumeRecv_(conn);
+    // 短写：从断点重新提交下一轮
+    if(conn.http.ToWriteBytes() > 0) {
+        SubmitSend_(conn);
+        return;
+    }
+    // keep-alive：读缓冲区里可能已经有下一个请求了。处理完腾出了空间的话恢复读
+    if(conn.http.IsKeepAlive()) {
+        Process_(conn);
+        if(CheckReadRoom_(conn)) {
+            ResumeRecv_(conn);
+        }
+    }
+}
+
+int UringLoop::KeepAlive_(int fd) {
+    auto it = conns_.find(fd);
+    if(it == conns_.end() || it->second.closing || !it->second.http.KeepAliveTick()) {
+        return 0;
+    }
+    Conn& conn = it->second;
+    // 正在发送的话，这一轮发完 OnSend_ 会再调 Process_，ping 跟着出去
+    if(conn.sendOps == 0 && conn.http.ToWriteBytes() == 0) {
+        Process_(conn);
+    }
+    return timeoutMs_;
+}
+
+void UringLoop::ReleaseIdle_() {
+    int64_t now = HttpConn::NowMs();
+    for(auto& item : conns_) {
+        Conn& conn = item.second;
+        // 内核还拿着写缓冲区里的地址 (在途的 send) 时不能换内存
+        if(conn.closing || conn.sendOps > 0) {
+            continue;
+        }
+        conn.http.ReleaseIdle(now);
+    }
+}
+
+void UringLoop::OnPush_(Subscriber& sub) {
+    auto it = conns_.find(sub.Fd());
+    if(it == conns_.end() || it->second.closing) {
+        return;
+    }
+    Conn& conn = it->second;
+    timer_.adjust(sub.Fd(), timeoutMs_);
+    // 同 KeepAlive_：发送中的话等 OnSend_ 那次 Process_ 一起取
+    if(conn.sendOps == 0 && conn.http.ToWriteBytes() == 0) {
+        Process_(conn);
+    }
+}
+
+void UringLoop::CloseConn_(int fd) {
+    auto it = conns_.find(fd);
+    if(it == conns_.end() || it->second.closing) {
+        return;
+    }
+    Conn& conn = it->second;
+    conn.closing = true;
+    // shutdown 会让挂着的 recv 以 0 返回、在途的 send 以错误返回；
+    // 等内核把它们都吐出来 (inflight 归零) 再 close，fd 才不会被提前复用
+    shutdown(fd, SHUT_RDWR);
+    TryRelease_(conn);
+}
+
+void UringLoop::TryRelease_(Conn& conn) {
+    if(!conn.closing || conn.inflight > 0) {
+        return;
+    }
+    ClosePipe_(conn);
+    conn.http.Close();
+}
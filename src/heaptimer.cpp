@@ -14,12 +14,12 @@ void HeapTimer::swapNode_(size_t i, size_t j) {
 // 上滤操作
 void HeapTimer::siftup_(size_t i) {
     assert(i >= 0 && i < heap_.size());
-    size_t j = (i - 1) / 2;
-    while(j >= 0) {
+    // 注意 size_t 无符号：i == 0 时 (i - 1) / 2 会溢出，必须用 i > 0 做循环条件
+    while(i > 0) {
+        size_t j = (i - 1) / 2;
         if(heap_[j] < heap_[i]) { break; }
         swapNode_(i, j);
         i = j;
-        j = (i - 1) / 2;
     }
 }
 
@@ -62,6 +62,17 @@ void HeapTimer::add(int id, int timeOut, const TimeoutCallBack& cb) {
     }
 }
 
+// 调整定时器：连接有活动时把过期时间往后延，回调不变
+void HeapTimer::adjust(int id, int newExpires) {
+    if(ref_.count(id) == 0) {
+        return;
+    }
+    size_t i = ref_[id];
+    heap_[i].expire = Clock::now() + MS(newExpires);
+    // 过期时间只会变大，下滤即可
+    siftdown_(i, heap_.size());
+}
+
 // 删除指定连接的定时器
 void HeapTimer::doWork(int id) {
     if(heap_.empty() || ref_.count(id) == 0) {
@@ -89,6 +100,11 @@ void HeapTimer::tick() {
         if(std::chrono::duration_cast<MS>(node.expire - Clock::now()).count() > 0) { 
             break; 
         }
+        int extend = expireHook_ ? expireHook_(node.id) : 0;
+        if(extend > 0) {
+            adjust(node.id, extend);
+            continue;
+        }
         node.cb();
         pop();
     }
@@ -0,0 +1,115 @@
+#include "http/Compress.h"
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef HAVE_BROTLI
+#include <brotli/encode.h>
+#endif
+
+bool Compress::Available(Encoding enc) {
+    switch(enc) {
+#ifdef HAVE_ZLIB
+        case ENC_GZIP: return true;
+#endif
+#ifdef HAVE_BROTLI
+        case ENC_BR: return true;
+#endif
+        default: return false;
+    }
+}
+
+bool Compress::Encode(Encoding enc, const std::string& in, std::string* out) {
+#ifdef HAVE_ZLIB
+    if(enc == ENC_GZIP) {
+        z_stream zs = {};
+        // windowBits 加 16 输出 gzip 格式；每个文件只压一次，用最高压缩级别
+        if(deflateInit2(&zs, Z_BEST_COMPRESSION, Z_DEFLATED, 15 + 16, 9, Z_DEFAULT_STRATEGY) != Z_OK) {
+            return false;
+        }
+        out->resize(deflateBound(&zs, in.size()));
+        zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(in.data()));
+        zs.avail_in = in.size();
+        zs.next_out = reinterpret_cast<Bytef*>(&(*out)[0]);
+        zs.avail_out = out->size();
+        int ret = deflate(&zs, Z_FINISH);
+        out->resize(zs.total_out);
+        deflateEnd(&zs);
+        return ret == Z_STREAM_END;
+    }
+#endif
+#ifdef HAVE_BROTLI
+    if(enc == ENC_BR) {
+        size_t outLen = BrotliEncoderMaxCompressedSize(in.size());
+        if(outLen == 0) return false;
+        out->resize(outLen);
+        // quality 11 压几百 KB 要几百毫秒，第一次请求等不起，9 已经比 gzip 好不少
+        if(!BrotliEncoderCompress(9, BROTLI_DEFAULT_WINDOW, BROTLI_MODE_TEXT,
+                                  in.size(), reinterpret_cast<const uint8_t*>(in.data()),
+                                  &outLen, reinterpret_cast<uint8_t*>(&(*out)[0]))) {
+            return false;
+        }
+        out->resize(outLen);
+        return true;
+    }
+#endif
+    (void)enc; (void)in; (void)out;
+    return false;
+}
+
+const char* Compress::Name(Encoding enc) {
+    switch(enc) {
+        case ENC_GZIP: return "gzip";
+        case ENC_BR:   return "br";
+        default:       return "identity";
+    }
+}
+
+const char* Compress::Suffix(Encoding enc) {
+    switch(enc) {
+        case ENC_GZIP: return ".gz";
+        case ENC_BR:   return ".br";
+        default:       return "";
+    }
+}
+
+// 例："gzip, deflate, br;q=0.8"、"gzip;q=0, *"
+int Compress::ParseAccept(StrView header) {
+    int mask = 0;
+    size_t i = 0;
+    while(i < header.size()) {
+        size_t end = header.find(',', i);
+        if(end == StrView::npos) end = header.size();
+        StrView item = header.substr(i, end - i);
+        i = end + 1;
+
+        size_t semi = item.find(';');
+        if(semi != StrView::npos) {
+            // 只关心 q=0 (明确拒绝)；"q=0.5" 之类都当成接受
+            StrView param = item.substr(semi + 1).Trim();
+            item = item.substr(0, semi);
+            if(param.size() >= 3 && (param[0] == 'q' || param[0] == 'Q') && param[1] == '=') {
+                StrView q = param.substr(2);
+                bool zero = true;
+                for(char c : q) {
+                    if(c != '0' && c != '.') { zero = false; break; }
+                }
+                if(zero) continue;
+            }
+        }
+        item = item.Trim();
+
+        if(item.EqualsIgnoreCase("gzip") || item.EqualsIgnoreCase("x-gzip")) {
+            mask |= ENC_GZIP;
+        } else if(item.EqualsIgnoreCase("br")) {
+            mask |= ENC_BR;
+        }
+    }
+    return mask;
+}
+
+bool Compress::IsCompressible(const std::string& type) {
+    return type.compare(0, 5, "text/") == 0
+        || type.find("javascript") != std::string::npos
+        || type.find("json") != std::string::npos
+        || type.find("xml") != std::string::npos;
+}
@@ -0,0 +1,210 @@
+#include "http/EventHub.h"
+#include "http/WebSocket.h"
+#include <cstdio>
+
+size_t EventHub::maxPendingBytes = 4 * 1024 * 1024;
+
+EventHub* EventHub::Instance() {
+    static EventHub hub;
+    return &hub;
+}
+
+// ---------------- Subscriber ----------------
+
+void Subscriber::Subscribe(StrView channel) {
+    EventHub::Instance()->Add_(shared_from_this(), channel);
+}
+
+void Subscriber::Unsubscribe(StrView channel) {
+    EventHub::Instance()->Remove_(this, channel);
+}
+
+void Subscriber::Detach() {
+    // 先置位：之后的 Subscribe 不会再把它加回去
+    closed_ = true;
+    EventHub* hub = EventHub::Instance();
+    {
+        std::lock_guard<std::mutex> locker(hub->mtx_);
+        while(!slots_.empty()) {
+            std::pair<std::string, size_t> slot = slots_.back();
+            hub->RemoveAt_(slot.first, slot.second);
+        }
+    }
+    std::lock_guard<std::mutex> locker(mtx_);
+    pending_.clear();
+    pendingBytes_ = 0;
+}
+
+bool Subscriber::Enqueue_(const SharedPayload& payload) {
+    std::lock_guard<std::mutex> locker(mtx_);
+    if(closed_ || overflow_) {
+        return false;
+    }
+    pendingBytes_ += payload->size();
+    if(pendingBytes_ > EventHub::maxPendingBytes) {
+        // 慢连接：积压直接丢掉，连接下次来取的时候看到 overflow_ 就结束
+        overflow_ = true;
+        pending_.clear();
+        pendingBytes_ = 0;
+    } else {
+        pending_.push_back(payload);
+    }
+    bool wake = !scheduled_;
+    scheduled_ = true;
+    return wake;
+}
+
+bool Subscriber::Take(std::vector<SharedPayload>* out) {
+    std::lock_guard<std::mutex> locker(mtx_);
+    scheduled_ = false;
+    if(out->empty()) {
+        out->swap(pending_);
+    } else {
+        out->insert(out->end(), pending_.begin(), pending_.end());
+        pending_.clear();
+    }
+    pendingBytes_ = 0;
+    return !overflow_;
+}
+
+// ---------------- EventStream ----------------
+
+void EventStream::Send(StrView data, StrView event, StrView id) {
+    EventHub::AppendSse(out_, data, event, id);
+}
+
+// ---------------- EventHub ----------------
+
+void EventHub::Add_(const std::shared_ptr<Subscriber>& sub, StrView channel) {
+    std::lock_guard<std::mutex> locker(mtx_);
+    if(sub->closed_) {
+        return;
+    }
+    std::string name = channel.ToString();
+    for(const auto& slot : sub->slots_) {
+        if(slot.first == name) return;
+    }
+    std::vector<std::shared_ptr<Subscriber>>& subs = channels_[name];
+    sub->slots_.emplace_back(name, subs.size());
+    subs.push_back(sub);
+}
+
+void EventHub::Remove_(Subscriber* sub, StrView channel) {
+    std::lock_guard<std::mutex> locker(mtx_);
+    for(const auto& slot : sub->slots_) {
+        if(StrView(slot.first) == channel) {
+            RemoveAt_(slot.first, slot.second);
+            return;
+        }
+    }
+}
+
+// 拿最后一个订阅者填到 index 的位置，顺便改它记下的下标。调用方持有 mtx_
+void EventHub::RemoveAt_(const std::string& channel, size_t index) {
+    auto it = channels_.find(channel);
+    std::vector<std::shared_ptr<Subscriber>>& subs = it->second;
+    std::shared_ptr<Subscriber> removed = subs[index];
+    if(index + 1 != subs.size()) {
+        subs[index] = std::move(subs.back());
+        for(auto& slot : subs[index]->slots_) {
+            if(slot.first == channel) {
+                slot.second = index;
+                break;
+            }
+        }
+    }
+    subs.pop_back();
+
+    auto& slots = removed->slots_;
+    for(size_t i = 0; i < slots.size(); i++) {
+        if(slots[i].first == channel) {
+            slots[i] = std::move(slots.back());
+            slots.pop_back();
+            break;
+        }
+    }
+    if(subs.empty()) {
+        channels_.erase(it);
+    }
+}
+
+size_t EventHub::Subscribers(StrView channel) {
+    std::lock_guard<std::mutex> locker(mtx_);
+    auto it = channels_.find(channel.ToString());
+    return it == channels_.end() ? 0 : it->second.size();
+}
+
+void EventHub::AppendSse(Buffer& out, StrView data, StrView event, StrView id) {
+    // 先拼事件本身，再按长度加 chunk 头。event / id 里不能有换行，有的话去掉
+    std::string body;
+    auto field = [&body](const char* name, StrView value) {
+        body += name;
+        for(char c : value) {
+            if(c != '\r' && c != '\n') body.push_back(c);
+        }
+        body.push_back('\n');
+    };
+    if(!id.empty()) field("id: ", id);
+    if(!event.empty()) field("event: ", event);
+    size_t pos = 0;
+    do {
+        size_t nl = data.find('\n', pos);
+        StrView line = data.substr(pos, nl == StrView::npos ? StrView::npos : nl - pos);
+        if(!line.empty() && line[line.size() - 1] == '\r') line = line.substr(0, line.size() - 1);
+        body += "data: ";
+        body.append(line.data(), line.size());
+        body.push_back('\n');
+        pos = nl == StrView::npos ? data.size() + 1 : nl + 1;
+    } while(pos <= data.size());
+    body.push_back('\n');
+
+    char head[20];
+    int n = snprintf(head, sizeof(head), "%zx\r\n", body.size());
+    out.append(head, n);
+    out.append(body);
+    out.append("\r\n", 2);
+}
+
+size_t EventHub::Publish(StrView channel, StrView data, StrView event, StrView id) {
+    // 每种格式最多编码一次，第一个需要它的订阅者出现时才编码
+    SharedPayload formatted[2];
+    Buffer buff;
+    auto payloadFor = [&](Subscriber::Format format) -> const SharedPayload& {
+        SharedPayload& p = formatted[format];
+        if(!p) {
+            if(format == Subscriber::SSE) {
+                AppendSse(buff, data, event, id);
+            } else {
+                WebSocket::WriteFrame(buff, WebSocket::TEXT, data);
+            }
+            p = std::make_shared<const std::string>(buff.retrieveAllToStr());
+        }
+        return p;
+    };
+
+    // 按事件循环分组，锁外再唤醒：一个循环一次 QueueInLoop，不是一个连接一次
+    std::vector<std::pair<PushTarget*, std::vector<std::shared_ptr<Subscriber>>>> wakes;
+    size_t delivered = 0;
+    {
+        std::lock_guard<std::mutex> locker(mtx_);
+        auto it = channels_.find(channel.ToString());
+        if(it == channels_.end()) {
+            return 0;
+        }
+        for(const std::shared_ptr<Subscriber>& sub : it->second) {
+            bool wake = sub->Enqueue_(payloadFor(sub->format_));
+            delivered++;
+            if(!wake || !sub->target_) continue;
+            size_t i = 0;
+            while(i < wakes.size() && wakes[i].first != sub->target_) i++;
+            if(i == wakes.size()) {
+                wakes.emplace_back(sub->target_, std::vector<std::shared_ptr<Subscriber>>());
+            }
+            wakes[i].second.push_back(sub);
+        }
+    }
+    for(auto& w : wakes) {
+        w.first->Push(std::move(w.second));
+    }
+    return delivered;
+}
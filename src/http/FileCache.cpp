@@ -0,0 +1,401 @@
+#include "http/FileCache.h"
+#include "http/HttpResponse.h"
+#include "log.h"
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <dirent.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+
+// 只留一个 fd 的大文件条目不占多少内存，但要按这个数计费，免得缓存攒下太多打开的 fd
+static const size_t FD_ENTRY_COST = 4096;
+// 太小的文件压缩后省不了几个字节，还要多一次解压
+static const size_t MIN_COMPRESS_SIZE = 256;
+
+bool FileCache::compressText = false;
+
+FileEntry::FileEntry() : encoding(ENC_IDENTITY), exists(false), fd(-1), statOnly(false) {
+    memset(&st, 0, sizeof(st));
+}
+
+FileEntry::~FileEntry() {
+    if(fd >= 0) {
+        close(fd);
+    }
+}
+
+size_t FileEntry::Charge() const {
+    return sizeof(FileEntry) + file.size() + header.size() + body.size() + etag.size() + lastModified.size()
+        + (fd >= 0 ? FD_ENTRY_COST : 0);
+}
+
+FileCache* FileCache::Instance() {
+    static FileCache instance;
+    return &instance;
+}
+
+FileCache::FileCache() : shardCapacity_(0), inotifyFd_(-1), stopFd_(-1) {}
+
+FileCache::~FileCache() {
+    if(watcher_.joinable()) {
+        uint64_t one = 1;
+        ssize_t n = write(stopFd_, &one, sizeof(one));
+        (void)n;
+        watcher_.join();
+    }
+    if(inotifyFd_ >= 0) close(inotifyFd_);
+    if(stopFd_ >= 0) close(stopFd_);
+}
+
+bool FileCache::Init(const std::string& root, size_t capacity) {
+    root_ = root;
+    shardCapacity_ = capacity / SHARD_NUM;
+    if(shardCapacity_ == 0) {
+        return true;
+    }
+
+    // 没有 inotify 就发现不了文件变化，宁可不缓存也不返回旧内容
+    inotifyFd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    stopFd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if(inotifyFd_ < 0 || stopFd_ < 0) {
+        LOG_WARN("FileCache: inotify unavailable (%s), cache disabled", strerror(errno));
+        shardCapacity_ = 0;
+        return false;
+    }
+    AddWatch_(root_);
+    if(watchDirs_.empty()) {
+        shardCapacity_ = 0;
+        return false;
+    }
+    watcher_ = std::thread(&FileCache::WatchLoop_, this);
+    LOG_INFO("FileCache: %zu bytes, watching %zu dirs under %s",
+             capacity, watchDirs_.size(), root_.c_str());
+    return true;
+}
+
+FileCache::EntryPtr FileCache::Get(const std::string& path, Encoding enc) {
+    std::string norm = Normalize_(path);
+    std::string file = root_ + norm;
+    if(shardCapacity_ == 0) {
+        return enc == ENC_IDENTITY ? Load_(file) : LoadEncoded_(norm, file, enc);
+    }
+
+    std::string key = KeyOf_(file, enc);
+    Shard& shard = ShardOf_(file);
+    uint64_t generation;
+    {
+        std::lock_guard<std::mutex> locker(shard.mtx);
+        auto it = shard.index.find(key);
+        if(it != shard.index.end()) {
+            shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+            return *it->second;
+        }
+        generation = shard.generation;
+    }
+
+    // 加载在锁外做：读文件可能很慢，不能挡住同一分片上的命中
+    std::shared_ptr<FileEntry> entry = enc == ENC_IDENTITY ? Load_(file) : LoadEncoded_(norm, file, enc);
+    size_t charge = entry->Charge();
+    if(charge > shardCapacity_) {
+        return entry;
+    }
+
+    std::lock_guard<std::mutex> locker(shard.mtx);
+    if(shard.generation != generation) {
+        // 加载期间分片里有文件变了，这份内容可能已经过期，只给这一次请求用
+        return entry;
+    }
+    auto it = shard.index.find(key);
+    if(it != shard.index.end()) {
+        // 别的线程先一步插进去了
+        return *it->second;
+    }
+    shard.lru.push_front(entry);
+    shard.index[key] = shard.lru.begin();
+    shard.bytes += charge;
+    EvictLocked_(shard);
+    return entry;
+}
+
+FileCache::EntryPtr FileCache::Peek(const std::string& path) {
+    std::string file = root_ + Normalize_(path);
+    if(shardCapacity_ > 0) {
+        Shard& shard = ShardOf_(file);
+        std::lock_guard<std::mutex> locker(shard.mtx);
+        auto it = shard.index.find(file);
+        if(it != shard.index.end()) {
+            shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+            return *it->second;
+        }
+    }
+    std::shared_ptr<FileEntry> entry = std::make_shared<FileEntry>();
+    entry->file = file;
+    entry->statOnly = true;
+    Stat_(entry.get());
+    return entry;
+}
+
+std::string FileCache::ETagOf(const std::string& etag, Encoding enc) {
+    if(enc == ENC_IDENTITY || etag.size() < 2) {
+        return etag;
+    }
+    // "abc" -> "abc-gzip"
+    return etag.substr(0, etag.size() - 1) + "-" + Compress::Name(enc) + "\"";
+}
+
+void FileCache::Invalidate(const std::string& file) {
+    InvalidateFile_(file);
+    // x.html.gz 变了：x.html 的 gzip 版本跟着失效
+    for(Encoding enc : {ENC_GZIP, ENC_BR}) {
+        std::string suffix = Compress::Suffix(enc);
+        if(file.size() > suffix.size()
+           && file.compare(file.size() - suffix.size(), suffix.size(), suffix) == 0) {
+            InvalidateFile_(file.substr(0, file.size() - suffix.size()));
+        }
+    }
+}
+
+void FileCache::InvalidateFile_(const std::string& file) {
+    Shard& shard = ShardOf_(file);
+    std::lock_guard<std::mutex> locker(shard.mtx);
+    shard.generation++;
+    EraseLocked_(shard, file);
+    EraseLocked_(shard, KeyOf_(file, ENC_GZIP));
+    EraseLocked_(shard, KeyOf_(file, ENC_BR));
+}
+
+void FileCache::Clear() {
+    for(Shard& shard : shards_) {
+        std::lock_guard<std::mutex> locker(shard.mtx);
+        shard.generation++;
+        shard.index.clear();
+        shard.lru.clear();
+        shard.bytes = 0;
+    }
+}
+
+size_t FileCache::Bytes() const {
+    size_t total = 0;
+    for(const Shard& shard : shards_) {
+        std::lock_guard<std::mutex> locker(shard.mtx);
+        total += shard.bytes;
+    }
+    return total;
+}
+
+FileCache::Shard& FileCache::ShardOf_(const std::string& key) {
+    return shards_[std::hash<std::string>()(key) % SHARD_NUM];
+}
+
+void FileCache::EvictLocked_(Shard& shard) {
+    while(shard.bytes > shardCapacity_ && !shard.lru.empty()) {
+        const FileEntry& victim = *shard.lru.back();
+        EraseLocked_(shard, KeyOf_(victim.file, victim.encoding));
+    }
+}
+
+void FileCache::EraseLocked_(Shard& shard, const std::string& key) {
+    auto it = shard.index.find(key);
+    if(it == shard.index.end()) {
+        return;
+    }
+    shard.bytes -= (*it->second)->Charge();
+    shard.lru.erase(it->second);
+    shard.index.erase(it);
+}
+
+// 压缩版本的 key 加上编码名前缀，绝对路径以 '/' 开头，不会和原文件撞上
+std::string FileCache::KeyOf_(const std::string& file, Encoding enc) {
+    if(enc == ENC_IDENTITY) {
+        return file;
+    }
+    return std::string(Compress::Name(enc)) + ":" + file;
+}
+
+// 合并重复的 '/'，消掉 "." 和 ".."，".." 最多退到资源根目录：
+// 既让同一个文件只有一个 key，也堵住 "/../" 跳出资源目录
+std::string FileCache::Normalize_(const std::string& path) {
+    std::vector<std::string> parts;
+    size_t i = 0;
+    while(i < path.size()) {
+        size_t j = path.find('/', i);
+        if(j == std::string::npos) j = path.size();
+        std::string seg = path.substr(i, j - i);
+        if(seg == "..") {
+            if(!parts.empty()) parts.pop_back();
+        } else if(!seg.empty() && seg != ".") {
+            parts.push_back(seg);
+        }
+        i = j + 1;
+    }
+    std::string result;
+    for(const std::string& seg : parts) {
+        result += '/';
+        result += seg;
+    }
+    return result.empty() ? "/" : result;
+}
+
+std::shared_ptr<FileEntry> FileCache::Load_(const std::string& file) const {
+    std::shared_ptr<FileEntry> entry = std::make_shared<FileEntry>();
+    entry->file = file;
+    Stat_(entry.get());
+
+    size_t length = 0;
+    if(entry->IsReadable() && !entry->IsDir() && entry->Size() > 0) {
+        size_t size = entry->Size();
+        int fd = open(file.data(), O_RDONLY | O_CLOEXEC);
+        if(fd >= 0 && size >= HttpResponse::sendfileThreshold) {
+            // 大文件只留 fd，内容由 sendfile / splice 直接从页缓存发出去
+            entry->fd = fd;
+            length = size;
+        } else if(fd >= 0) {
+            // 小文件拷一份到内存，而不是长期 mmap：文件被截断时映射会 SIGBUS，拷贝不会
+            entry->body.resize(size);
+            size_t got = 0;
+            while(got < size) {
+                ssize_t n = pread(fd, &entry->body[got], size - got, got);
+                if(n <= 0) break;
+                got += n;
+            }
+            close(fd);
+            if(got == size) {
+                length = size;
+            } else {
+                entry->body.clear();
+            }
+        }
+    }
+
+    entry->header = "Content-type: " + HttpResponse::FileType(file) + "\r\n";
+    entry->header += "Content-length: " + std::to_string(length) + "\r\n\r\n";
+    return entry;
+}
+
+std::shared_ptr<FileEntry> FileCache::LoadEncoded_(const std::string& path, const std::string& file, Encoding enc) {
+    std::shared_ptr<FileEntry> entry = std::make_shared<FileEntry>();
+    entry->file = file;
+    entry->encoding = enc;
+
+    EntryPtr origin = Get(path);
+    if(!origin->IsReadable() || origin->IsDir()) {
+        return entry;
+    }
+    std::string type = HttpResponse::FileType(file);
+
+    // 1. 预压缩好的 path.gz / path.br
+    std::shared_ptr<FileEntry> sidecar = Load_(file + Compress::Suffix(enc));
+    if(sidecar->IsReadable() && !sidecar->IsDir() && (!sidecar->body.empty() || sidecar->fd >= 0)) {
+        entry->exists = true;
+        entry->st = sidecar->st;
+        entry->body.swap(sidecar->body);
+        std::swap(entry->fd, sidecar->fd);
+    }
+    // 2. 现场压缩：只压放在内存里的文本文件，压完没变小就算了
+    else if(compressText && !origin->body.empty() && origin->Size() >= MIN_COMPRESS_SIZE
+            && Compress::IsCompressible(type)) {
+        std::string out;
+        if(Compress::Encode(enc, origin->body, &out) && out.size() < origin->body.size()) {
+            entry->exists = true;
+            entry->st = origin->st;
+            entry->st.st_size = out.size();
+            entry->body.swap(out);
+        }
+    }
+    if(!entry->exists) {
+        return entry;
+    }
+
+    // 压缩版本跟着原文件变：ETag / Last-Modified 都从原文件来
+    entry->etag = ETagOf(origin->etag, enc);
+    entry->lastModified = origin->lastModified;
+    entry->header = "Content-type: " + type + "\r\n";
+    entry->header += "Content-length: " + std::to_string(entry->Size()) + "\r\n\r\n";
+    return entry;
+}
+
+void FileCache::Stat_(FileEntry* entry) {
+    entry->exists = stat(entry->file.data(), &entry->st) == 0;
+    if(!entry->exists) {
+        return;
+    }
+    char etag[64];
+    unsigned long long mtime = entry->st.st_mtim.tv_sec * 1000000000ULL + entry->st.st_mtim.tv_nsec;
+    snprintf(etag, sizeof(etag), "\"%llx-%llx-%llx\"",
+             static_cast<unsigned long long>(entry->st.st_ino),
+             static_cast<unsigned long long>(entry->st.st_size), mtime);
+    entry->etag = etag;
+    entry->lastModified = HttpResponse::HttpDate(entry->st.st_mtime);
+}
+
+void FileCache::AddWatch_(const std::string& dir) {
+    const uint32_t mask = IN_CLOSE_WRITE | IN_MODIFY | IN_ATTRIB | IN_CREATE | IN_DELETE
+                        | IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR;
+    int wd = inotify_add_watch(inotifyFd_, dir.data(), mask);
+    if(wd < 0) {
+        LOG_WARN("FileCache: watch %s failed: %s", dir.c_str(), strerror(errno));
+        return;
+    }
+    watchDirs_[wd] = dir;
+
+    DIR* d = opendir(dir.data());
+    if(!d) return;
+    while(struct dirent* ent = readdir(d)) {
+        if(ent->d_type == DT_DIR && strcmp(ent->d_name, ".") != 0 && strcmp(ent->d_name, "..") != 0) {
+            AddWatch_(dir + "/" + ent->d_name);
+        }
+    }
+    closedir(d);
+}
+
+void FileCache::WatchLoop_() {
+    alignas(struct inotify_event) char buf[16 * 1024];
+    struct pollfd fds[2] = {{inotifyFd_, POLLIN, 0}, {stopFd_, POLLIN, 0}};
+    while(true) {
+        if(poll(fds, 2, -1) < 0) {
+            if(errno == EINTR) continue;
+            break;
+        }
+        if(fds[1].revents) {
+            break;
+        }
+        ssize_t len;
+        while((len = read(inotifyFd_, buf, sizeof(buf))) > 0) {
+            for(char* p = buf; p < buf + len; ) {
+                struct inotify_event* ev = reinterpret_cast<struct inotify_event*>(p);
+                p += sizeof(struct inotify_event) + ev->len;
+
+                if(ev->mask & IN_Q_OVERFLOW) {
+                    // 丢了事件，不知道哪些文件变了，只能全部作废
+                    Clear();
+                    continue;
+                }
+                auto it = watchDirs_.find(ev->wd);
+                if(it == watchDirs_.end()) continue;
+                if(ev->mask & (IN_DELETE_SELF | IN_MOVE_SELF | IN_IGNORED)) {
+                    // 整个目录没了：下面所有路径都要重新 stat
+                    watchDirs_.erase(it);
+                    Clear();
+                    continue;
+                }
+                if(ev->len == 0) continue;
+
+                std::string file = it->second + "/" + ev->name;
+                if((ev->mask & IN_ISDIR) && (ev->mask & (IN_CREATE | IN_MOVED_TO))) {
+                    AddWatch_(file);
+                }
+                if(ev->mask & IN_ISDIR) {
+                    // 目录改名 / 删除会影响它下面所有缓存的路径
+                    Clear();
+                } else {
+                    Invalidate(file);
+                }
+            }
+        }
+    }
+}
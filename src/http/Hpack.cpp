@@ -0,0 +1,443 @@
+#include "http/Hpack.h"
+
+// ---------------- 静态表 (RFC 7541 附录 A) ----------------
+
+static const char* const STATIC_TABLE[Hpack::STATIC_COUNT][2] = {
+    {":authority", ""},
+    {":method", "GET"},
+    {":method", "POST"},
+    {":path", "/"},
+    {":path", "/index.html"},
+    {":scheme", "http"},
+    {":scheme", "https"},
+    {":status", "200"},
+    {":status", "204"},
+    {":status", "206"},
+    {":status", "304"},
+    {":status", "400"},
+    {":status", "404"},
+    {":status", "500"},
+    {"accept-charset", ""},
+    {"accept-encoding", "gzip, deflate"},
+    {"accept-language", ""},
+    {"accept-ranges", ""},
+    {"accept", ""},
+    {"access-control-allow-origin", ""},
+    {"age", ""},
+    {"allow", ""},
+    {"authorization", ""},
+    {"cache-control", ""},
+    {"content-disposition", ""},
+    {"content-encoding", ""},
+    {"content-language", ""},
+    {"content-length", ""},
+    {"content-location", ""},
+    {"content-range", ""},
+    {"content-type", ""},
+    {"cookie", ""},
+    {"date", ""},
+    {"etag", ""},
+    {"expect", ""},
+    {"expires", ""},
+    {"from", ""},
+    {"host", ""},
+    {"if-match", ""},
+    {"if-modified-since", ""},
+    {"if-none-match", ""},
+    {"if-range", ""},
+    {"if-unmodified-since", ""},
+    {"last-modified", ""},
+    {"link", ""},
+    {"location", ""},
+    {"max-forwards", ""},
+    {"proxy-authenticate", ""},
+    {"proxy-authorization", ""},
+    {"range", ""},
+    {"referer", ""},
+    {"refresh", ""},
+    {"retry-after", ""},
+    {"server", ""},
+    {"set-cookie", ""},
+    {"strict-transport-security", ""},
+    {"transfer-encoding", ""},
+    {"user-agent", ""},
+    {"vary", ""},
+    {"via", ""},
+    {"www-authenticate", ""},
+};
+
+StrView Hpack::StaticName(size_t index) { return StrView(STATIC_TABLE[index - 1][0]); }
+StrView Hpack::StaticValue(size_t index) { return StrView(STATIC_TABLE[index - 1][1]); }
+
+// ---------------- Huffman (RFC 7541 附录 B) ----------------
+
+struct HuffCode {
+    uint32_t code;
+    uint8_t len;
+};
+
+// 256 个字节 + EOS，码字右对齐
+static const HuffCode HUFF_CODES[257] = {
+    {0x00001ff8, 13}, {0x007fffd8, 23}, {0x0fffffe2, 28}, {0x0fffffe3, 28},
+    {0x0fffffe4, 28}, {0x0fffffe5, 28}, {0x0fffffe6, 28}, {0x0fffffe7, 28},
+    {0x0fffffe8, 28}, {0x00ffffea, 24}, {0x3ffffffc, 30}, {0x0fffffe9, 28},
+    {0x0fffffea, 28}, {0x3ffffffd, 30}, {0x0fffffeb, 28}, {0x0fffffec, 28},
+    {0x0fffffed, 28}, {0x0fffffee, 28}, {0x0fffffef, 28}, {0x0ffffff0, 28},
+    {0x0ffffff1, 28}, {0x0ffffff2, 28}, {0x3ffffffe, 30}, {0x0ffffff3, 28},
+    {0x0ffffff4, 28}, {0x0ffffff5, 28}, {0x0ffffff6, 28}, {0x0ffffff7, 28},
+    {0x0ffffff8, 28}, {0x0ffffff9, 28}, {0x0ffffffa, 28}, {0x0ffffffb, 28},
+    {0x00000014,  6}, {0x000003f8, 10}, {0x000003f9, 10}, {0x00000ffa, 12},
+    {0x00001ff9, 13}, {0x00000015,  6}, {0x000000f8,  8}, {0x000007fa, 11},
+    {0x000003fa, 10}, {0x000003fb, 10}, {0x000000f9,  8}, {0x000007fb, 11},
+    {0x000000fa,  8}, {0x00000016,  6}, {0x00000017,  6}, {0x00000018,  6},
+    {0x00000000,  5}, {0x00000001,  5}, {0x00000002,  5}, {0x00000019,  6},
+    {0x0000001a,  6}, {0x0000001b,  6}, {0x0000001c,  6}, {0x0000001d,  6},
+    {0x0000001e,  6}, {0x0000001f,  6}, {0x0000005c,  7}, {0x000000fb,  8},
+    {0x00007ffc, 15}, {0x00000020,  6}, {0x00000ffb, 12}, {0x000003fc, 10},
+    {0x00001ffa, 13}, {0x00000021,  6}, {0x0000005d,  7}, {0x0000005e,  7},
+    {0x0000005f,  7}, {0x00000060,  7}, {0x00000061,  7}, {0x00000062,  7},
+    {0x00000063,  7}, {0x00000064,  7}, {0x00000065,  7}, {0x00000066,  7},
+    {0x00000067,  7}, {0x00000068,  7}, {0x00000069,  7}, {0x0000006a,  7},
+    {0x0000006b,  7}, {0x0000006c,  7}, {0x0000006d,  7}, {0x0000006e,  7},
+    {0x0000006f,  7}, {0x00000070,  7}, {0x00000071,  7}, {0x00000072,  7},
+    {0x000000fc,  8}, {0x00000073,  7}, {0x000000fd,  8}, {0x00001ffb, 13},
+    {0x0007fff0, 19}, {0x00001ffc, 13}, {0x00003ffc, 14}, {0x00000022,  6},
+    {0x00007ffd, 15}, {0x00000003,  5}, {0x00000023,  6}, {0x00000004,  5},
+    {0x00000024,  6}, {0x00000005,  5}, {0x00000025,  6}, {0x00000026,  6},
+    {0x00000027,  6}, {0x00000006,  5}, {0x00000074,  7}, {0x00000075,  7},
+    {0x00000028,  6}, {0x00000029,  6}, {0x0000002a,  6}, {0x00000007,  5},
+    {0x0000002b,  6}, {0x00000076,  7}, {0x0000002c,  6}, {0x00000008,  5},
+    {0x00000009,  5}, {0x0000002d,  6}, {0x00000077,  7}, {0x00000078,  7},
+    {0x00000079,  7}, {0x0000007a,  7}, {0x0000007b,  7}, {0x00007ffe, 15},
+    {0x000007fc, 11}, {0x00003ffd, 14}, {0x00001ffd, 13}, {0x0ffffffc, 28},
+    {0x000fffe6, 20}, {0x003fffd2, 22}, {0x000fffe7, 20}, {0x000fffe8, 20},
+    {0x003fffd3, 22}, {0x003fffd4, 22}, {0x003fffd5, 22}, {0x007fffd9, 23},
+    {0x003fffd6, 22}, {0x007fffda, 23}, {0x007fffdb, 23}, {0x007fffdc, 23},
+    {0x007fffdd, 23}, {0x007fffde, 23}, {0x00ffffeb, 24}, {0x007fffdf, 23},
+    {0x00ffffec, 24}, {0x00ffffed, 24}, {0x003fffd7, 22}, {0x007fffe0, 23},
+    {0x00ffffee, 24}, {0x007fffe1, 23}, {0x007fffe2, 23}, {0x007fffe3, 23},
+    {0x007fffe4, 23}, {0x001fffdc, 21}, {0x003fffd8, 22}, {0x007fffe5, 23},
+    {0x003fffd9, 22}, {0x007fffe6, 23}, {0x007fffe7, 23}, {0x00ffffef, 24},
+    {0x003fffda, 22}, {0x001fffdd, 21}, {0x000fffe9, 20}, {0x003fffdb, 22},
+    {0x003fffdc, 22}, {0x007fffe8, 23}, {0x007fffe9, 23}, {0x001fffde, 21},
+    {0x007fffea, 23}, {0x003fffdd, 22}, {0x003fffde, 22}, {0x00fffff0, 24},
+    {0x001fffdf, 21}, {0x003fffdf, 22}, {0x007fffeb, 23}, {0x007fffec, 23},
+    {0x001fffe0, 21}, {0x001fffe1, 21}, {0x003fffe0, 22}, {0x001fffe2, 21},
+    {0x007fffed, 23}, {0x003fffe1, 22}, {0x007fffee, 23}, {0x007fffef, 23},
+    {0x000fffea, 20}, {0x003fffe2, 22}, {0x003fffe3, 22}, {0x003fffe4, 22},
+    {0x007ffff0, 23}, {0x003fffe5, 22}, {0x003fffe6, 22}, {0x007ffff1, 23},
+    {0x03ffffe0, 26}, {0x03ffffe1, 26}, {0x000fffeb, 20}, {0x0007fff1, 19},
+    {0x003fffe7, 22}, {0x007ffff2, 23}, {0x003fffe8, 22}, {0x01ffffec, 25},
+    {0x03ffffe2, 26}, {0x03ffffe3, 26}, {0x03ffffe4, 26}, {0x07ffffde, 27},
+    {0x07ffffdf, 27}, {0x03ffffe5, 26}, {0x00fffff1, 24}, {0x01ffffed, 25},
+    {0x0007fff2, 19}, {0x001fffe3, 21}, {0x03ffffe6, 26}, {0x07ffffe0, 27},
+    {0x07ffffe1, 27}, {0x03ffffe7, 26}, {0x07ffffe2, 27}, {0x00fffff2, 24},
+    {0x001fffe4, 21}, {0x001fffe5, 21}, {0x03ffffe8, 26}, {0x03ffffe9, 26},
+    {0x0ffffffd, 28}, {0x07ffffe3, 27}, {0x07ffffe4, 27}, {0x07ffffe5, 27},
+    {0x000fffec, 20}, {0x00fffff3, 24}, {0x000fffed, 20}, {0x001fffe6, 21},
+    {0x003fffe9, 22}, {0x001fffe7, 21}, {0x001fffe8, 21}, {0x007ffff3, 23},
+    {0x003fffea, 22}, {0x003fffeb, 22}, {0x01ffffee, 25}, {0x01ffffef, 25},
+    {0x00fffff4, 24}, {0x00fffff5, 24}, {0x03ffffea, 26}, {0x007ffff4, 23},
+    {0x03ffffeb, 26}, {0x07ffffe6, 27}, {0x03ffffec, 26}, {0x03ffffed, 26},
+    {0x07ffffe7, 27}, {0x07ffffe8, 27}, {0x07ffffe9, 27}, {0x07ffffea, 27},
+    {0x07ffffeb, 27}, {0x0ffffffe, 28}, {0x07ffffec, 27}, {0x07ffffed, 27},
+    {0x07ffffee, 27}, {0x07ffffef, 27}, {0x07fffff0, 27}, {0x03ffffee, 26},
+    {0x3fffffff, 30},
+};
+
+// 这套编码是范式 Huffman：同样长度的码字按符号顺序连续分配。
+// 解码时取接下来 32 位左对齐，和每种长度的上界比一下就知道这个码字有多长，不用逐位走树
+struct HuffDecodeTable {
+    uint64_t limit[31];     // 长度为 L 的码字左对齐后的上界 (不含)
+    uint32_t first[31];     // 长度为 L 的第一个码字
+    uint16_t offset[31];    // 长度为 L 的第一个符号在 symbols 里的位置
+    uint16_t symbols[257];  // 按 (码长, 符号) 排好序
+    int minLen;
+};
+
+static HuffDecodeTable BuildDecodeTable() {
+    HuffDecodeTable t = {};
+    t.minLen = 30;
+    uint16_t n = 0;
+    uint32_t code = 0;
+    for(int len = 1; len <= 30; len++) {
+        t.first[len] = code;
+        t.offset[len] = n;
+        for(int sym = 0; sym < 257; sym++) {
+            if(HUFF_CODES[sym].len == len) {
+                t.symbols[n++] = static_cast<uint16_t>(sym);
+                code++;
+            }
+        }
+        if(n > 0 && t.minLen == 30) t.minLen = len;
+        t.limit[len] = static_cast<uint64_t>(code) << (32 - len);
+        code <<= 1;
+    }
+    return t;
+}
+
+static const HuffDecodeTable HUFF_DECODE = BuildDecodeTable();
+
+size_t Hpack::HuffmanLength(StrView s) {
+    size_t bits = 0;
+    for(char c : s) bits += HUFF_CODES[static_cast<unsigned char>(c)].len;
+    return (bits + 7) / 8;
+}
+
+void Hpack::HuffmanEncode(StrView s, std::string* out) {
+    uint64_t acc = 0;
+    int bits = 0;
+    for(char c : s) {
+        const HuffCode& h = HUFF_CODES[static_cast<unsigned char>(c)];
+        acc = (acc << h.len) | h.code;
+        bits += h.len;
+        while(bits >= 8) {
+            bits -= 8;
+            out->push_back(static_cast<char>(acc >> bits));
+        }
+        acc &= (1ull << bits) - 1;
+    }
+    if(bits > 0) {
+        // 用 EOS 的高位 (全 1) 补齐最后一个字节
+        out->push_back(static_cast<char>((acc << (8 - bits)) | (0xff >> bits)));
+    }
+}
+
+bool Hpack::HuffmanDecode(const uint8_t* p, size_t len, std::string* out) {
+    const uint8_t* end = p + len;
+    uint64_t acc = 0;
+    int bits = 0;
+    while(true) {
+        while(bits <= 56 && p < end) {
+            acc = (acc << 8) | *p++;
+            bits += 8;
+        }
+        if(bits == 0) break;
+
+        // 不够 32 位时低位补 1，剩下的要是合法填充，补完之后一定落在比剩余位数更长的码字上
+        uint64_t w = bits >= 32 ? (acc >> (bits - 32)) & 0xffffffffu
+                                : ((acc << (32 - bits)) | ((1ull << (32 - bits)) - 1)) & 0xffffffffu;
+        int n = HUFF_DECODE.minLen;
+        while(n <= 30 && w >= HUFF_DECODE.limit[n]) n++;
+        if(n > bits) {
+            return bits <= 7 && (acc & ((1ull << bits) - 1)) == (1ull << bits) - 1;
+        }
+        uint16_t sym = HUFF_DECODE.symbols[HUFF_DECODE.offset[n] + (w >> (32 - n)) - HUFF_DECODE.first[n]];
+        if(sym == 256) return false;
+        out->push_back(static_cast<char>(sym));
+        bits -= n;
+        acc &= (1ull << bits) - 1;
+    }
+    return true;
+}
+
+// ---------------- 整数 ----------------
+
+void Hpack::EncodeInt(uint32_t value, int prefix, uint8_t first, std::string* out) {
+    uint32_t max = (1u << prefix) - 1;
+    if(value < max) {
+        out->push_back(static_cast<char>(first | value));
+        return;
+    }
+    out->push_back(static_cast<char>(first | max));
+    value -= max;
+    while(value >= 128) {
+        out->push_back(static_cast<char>((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    out->push_back(static_cast<char>(value));
+}
+
+bool Hpack::DecodeInt(const uint8_t** p, const uint8_t* end, int prefix, uint32_t* value) {
+    if(*p >= end) return false;
+    uint32_t max = (1u << prefix) - 1;
+    uint32_t v = *(*p)++ & max;
+    if(v == max) {
+        int shift = 0;
+        uint8_t b;
+        do {
+            if(*p >= end || shift > 21) return false;
+            b = *(*p)++;
+            v += static_cast<uint32_t>(b & 0x7f) << shift;
+            shift += 7;
+        } while(b & 0x80);
+    }
+    *value = v;
+    return true;
+}
+
+// ---------------- 动态表 ----------------
+
+bool HpackTable::Get(size_t index, StrView* name, StrView* value) const {
+    if(index == 0) return false;
+    if(index <= Hpack::STATIC_COUNT) {
+        *name = Hpack::StaticName(index);
+        *value = Hpack::StaticValue(index);
+        return true;
+    }
+    index -= Hpack::STATIC_COUNT + 1;
+    if(index >= entries_.size()) return false;
+    *name = entries_[index].name;
+    *value = entries_[index].value;
+    return true;
+}
+
+void HpackTable::Evict_(size_t need) {
+    while(!entries_.empty() && size_ + need > maxSize_) {
+        const HpackHeader& h = entries_.back();
+        size_ -= Hpack::EntrySize(h.name.size(), h.value.size());
+        entries_.pop_back();
+    }
+}
+
+void HpackTable::Add(StrView name, StrView value) {
+    size_t size = Hpack::EntrySize(name.size(), value.size());
+    if(size > maxSize_) {
+        // 比整张表还大：按 RFC 清空表，这一项也不加
+        Clear();
+        return;
+    }
+    Evict_(size);
+    entries_.push_front(HpackHeader{name.ToString(), value.ToString()});
+    size_ += size;
+}
+
+void HpackTable::SetMaxSize(size_t maxSize) {
+    maxSize_ = maxSize;
+    Evict_(0);
+}
+
+// ---------------- 解码 ----------------
+
+bool HpackDecoder::ReadString_(const uint8_t** p, const uint8_t* end, std::string* out) {
+    if(*p >= end) return false;
+    bool huffman = (**p & 0x80) != 0;
+    uint32_t len;
+    if(!Hpack::DecodeInt(p, end, 7, &len) || len > static_cast<size_t>(end - *p)) return false;
+    out->clear();
+    bool ok = true;
+    if(huffman) {
+        ok = Hpack::HuffmanDecode(*p, len, out);
+    } else {
+        out->assign(reinterpret_cast<const char*>(*p), len);
+    }
+    *p += len;
+    return ok;
+}
+
+bool HpackDecoder::Decode(const uint8_t* p, size_t len, std::vector<HpackHeader>* headers, bool* tooLarge) {
+    const uint8_t* end = p + len;
+    headers->clear();
+    // 按 RFC 7540 6.5.2 算的头部列表大小，只增不减：超过上限以后一个也不再留
+    size_t listSize = 0;
+    while(p < end) {
+        uint8_t b = *p;
+        uint32_t index;
+        StrView name, value;
+        if(b & 0x80) {
+            // 索引：名字和值都在表里
+            if(!Hpack::DecodeInt(&p, end, 7, &index) || !table_.Get(index, &name, &value)) return false;
+            listSize += Hpack::EntrySize(name.size(), value.size());
+            if(listSize > maxListSize_) {
+                headers->clear();
+                continue;
+            }
+            headers->push_back(HpackHeader{name.ToString(), value.ToString()});
+            continue;
+        }
+        if((b & 0xe0) == 0x20) {
+            // 动态表大小更新：只能出现在块的开头，不能超过我们在 SETTINGS 里给的上限
+            if(listSize > 0 || !Hpack::DecodeInt(&p, end, 5, &index) || index > limit_) return false;
+            table_.SetMaxSize(index);
+            continue;
+        }
+
+        // 三种字面量：带索引 (01)、不带索引 (0000)、永不索引 (0001)
+        bool addToTable = (b & 0x40) != 0;
+        if(!Hpack::DecodeInt(&p, end, addToTable ? 6 : 4, &index)) return false;
+        headers->emplace_back();
+        HpackHeader& h = headers->back();
+        if(index == 0) {
+            if(!ReadString_(&p, end, &h.name)) return false;
+        } else {
+            if(!table_.Get(index, &name, &value)) return false;
+            h.name = name.ToString();
+        }
+        if(!ReadString_(&p, end, &h.value)) return false;
+        if(addToTable) table_.Add(h.name, h.value);
+        listSize += Hpack::EntrySize(h.name.size(), h.value.size());
+        if(listSize > maxListSize_) {
+            headers->clear();
+        }
+    }
+    *tooLarge = listSize > maxListSize_;
+    return true;
+}
+
+// ---------------- 编码 ----------------
+
+void HpackEncoder::SetPeerMaxTableSize(size_t size) {
+    size_t maxSize = size < 4096 ? size : 4096;
+    if(maxSize != table_.MaxSize()) {
+        table_.SetMaxSize(maxSize);
+        pendingUpdate_ = true;
+    }
+}
+
+void HpackEncoder::Begin(std::string* out) {
+    if(pendingUpdate_) {
+        Hpack::EncodeInt(static_cast<uint32_t>(table_.MaxSize()), 5, 0x20, out);
+        pendingUpdate_ = false;
+    }
+}
+
+size_t HpackEncoder::Find_(StrView name, StrView value, bool* exact) const {
+    size_t nameIdx = 0;
+    *exact = false;
+    for(size_t i = 1; i <= Hpack::STATIC_COUNT; i++) {
+        if(Hpack::StaticName(i) != name) continue;
+        if(Hpack::StaticValue(i) == value) {
+            *exact = true;
+            return i;
+        }
+        if(nameIdx == 0) nameIdx = i;
+    }
+    for(size_t i = 0; i < table_.Count(); i++) {
+        const HpackHeader& h = table_.Entry(i);
+        if(StrView(h.name) != name) continue;
+        if(StrView(h.value) == value) {
+            *exact = true;
+            return Hpack::STATIC_COUNT + 1 + i;
+        }
+        if(nameIdx == 0) nameIdx = Hpack::STATIC_COUNT + 1 + i;
+    }
+    return nameIdx;
+}
+
+void HpackEncoder::WriteString_(StrView s, std::string* out) {
+    size_t huffLen = Hpack::HuffmanLength(s);
+    if(huffLen < s.size()) {
+        Hpack::EncodeInt(static_cast<uint32_t>(huffLen), 7, 0x80, out);
+        Hpack::HuffmanEncode(s, out);
+    } else {
+        Hpack::EncodeInt(static_cast<uint32_t>(s.size()), 7, 0x00, out);
+        out->append(s.data(), s.size());
+    }
+}
+
+void HpackEncoder::Encode(StrView name, StrView value, bool index, std::string* out) {
+    bool exact;
+    size_t idx = Find_(name, value, &exact);
+    if(exact) {
+        Hpack::EncodeInt(static_cast<uint32_t>(idx), 7, 0x80, out);
+        return;
+    }
+    if(idx > 0) {
+        Hpack::EncodeInt(static_cast<uint32_t>(idx), index ? 6 : 4, index ? 0x40 : 0x00, out);
+    } else {
+        out->push_back(static_cast<char>(index ? 0x40 : 0x00));
+        WriteString_(name, out);
+    }
+    WriteString_(value, out);
+    if(index) table_.Add(name, value);
+}
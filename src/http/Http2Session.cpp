@@ -0,0 +1,711 @@
+#include "http/Http2Session.h"
+#include "http/HttpConn.h"
+#include <algorithm>
+#include <cstring>
+#include <unistd.h>
+
+const char Http2Session::PREFACE[] = "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n";
+
+static const uint8_t FLAG_END_STREAM = 0x1;
+static const uint8_t FLAG_ACK = 0x1;
+static const uint8_t FLAG_END_HEADERS = 0x4;
+static const uint8_t FLAG_PADDED = 0x8;
+static const uint8_t FLAG_PRIORITY = 0x20;
+
+static const int64_t MAX_WINDOW = 0x7fffffff;
+// 比这小的 body 片段直接拷进 out_，不值得多占一个 iovec
+static const size_t COPY_THRESHOLD = 1024;
+// 一批最多这么多段，一次 writev / sendmsg 就能发完 (iovec 上限是 1024)
+static const size_t MAX_SEGMENTS = 512;
+
+static uint32_t ReadU32(const uint8_t* p) {
+    return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+           (static_cast<uint32_t>(p[2]) << 8) | p[3];
+}
+
+static void WriteU32(uint8_t* p, uint32_t v) {
+    p[0] = static_cast<uint8_t>(v >> 24);
+    p[1] = static_cast<uint8_t>(v >> 16);
+    p[2] = static_cast<uint8_t>(v >> 8);
+    p[3] = static_cast<uint8_t>(v);
+}
+
+static void WriteFrameHeader(void* out, size_t len, uint8_t type, uint8_t flags, uint32_t streamId) {
+    uint8_t* h = static_cast<uint8_t*>(out);
+    h[0] = static_cast<uint8_t>(len >> 16);
+    h[1] = static_cast<uint8_t>(len >> 8);
+    h[2] = static_cast<uint8_t>(len);
+    h[3] = type;
+    h[4] = flags;
+    WriteU32(h + 5, streamId);
+}
+
+int Http2Session::MatchPreface(const Buffer& buff) {
+    size_t n = buff.readableBytes() < PREFACE_LEN ? buff.readableBytes() : PREFACE_LEN;
+    if(memcmp(buff.peek(), PREFACE, n) != 0) return 0;
+    return n < PREFACE_LEN ? -1 : 1;
+}
+
+Http2Session::Http2Session()
+    : prefaceSettings_(true), closing_(false), goawayReceived_(false), lastStreamId_(0),
+      peerInitialWindow_(65535), peerMaxFrame_(16384), sendWindow_(65535), recvLimit_(CONNECTION_WINDOW), recvWindow_(CONNECTION_WINDOW), recvFreed_(0),
+      headerStream_(0), headerEndStream_(false), decoder_(4096, HttpRequest::MAX_HEADER_BYTES), out_(nullptr) {}
+
+void Http2Session::Init(OutputQueue* out) {
+    Reset();
+    out_ = out;
+    prefaceSettings_ = true;
+    closing_ = false;
+    goawayReceived_ = false;
+    lastStreamId_ = 0;
+    peerInitialWindow_ = 65535;
+    peerMaxFrame_ = 16384;
+    sendWindow_ = 65535;
+    // 一个请求的 body 最多 maxBodyBytes，窗口比它小的话大 body 收不全，流又不会释放窗口
+    recvLimit_ = std::min<int64_t>(std::max<int64_t>(CONNECTION_WINDOW, HttpRequest::maxBodyBytes + MAX_FRAME),
+                                   MAX_WINDOW);
+    recvWindow_ = recvLimit_;
+    recvFreed_ = 0;
+    headerStream_ = 0;
+    headerBlock_.clear();
+    decoder_.Reset();
+    encoder_.Reset();
+
+    // 我们的 SETTINGS 不用等对端的，认出前言就发；再把连接级接收窗口一次放大
+    uint8_t settings[18];
+    const uint16_t ids[3] = { 0x3, 0x4, 0x6 };  // MAX_CONCURRENT_STREAMS / INITIAL_WINDOW_SIZE / MAX_HEADER_LIST_SIZE
+    const uint32_t values[3] = { MAX_CONCURRENT_STREAMS, INITIAL_WINDOW,
+                                 static_cast<uint32_t>(HttpRequest::MAX_HEADER_BYTES) };
+    for(int i = 0; i < 3; i++) {
+        settings[i * 6] = static_cast<uint8_t>(ids[i] >> 8);
+        settings[i * 6 + 1] = static_cast<uint8_t>(ids[i]);
+        WriteU32(settings + i * 6 + 2, values[i]);
+    }
+    FrameHeader_(sizeof(settings), SETTINGS, 0, 0);
+    Append_(settings, sizeof(settings));
+    WindowUpdate_(0, static_cast<uint32_t>(recvLimit_ - 65535));
+}
+
+void Http2Session::Reset() {
+    for(auto& kv : streams_) {
+        kv.second.response.UnmapFile();
+    }
+    streams_.clear();
+    ready_.clear();
+}
+
+bool Http2Session::Process(Buffer& in, size_t limit) {
+    while(!closing_ && in.readableBytes() >= 9) {
+        const uint8_t* h = reinterpret_cast<const uint8_t*>(in.peek());
+        size_t len = (static_cast<size_t>(h[0]) << 16) | (static_cast<size_t>(h[1]) << 8) | h[2];
+        if(len > MAX_FRAME) {
+            ConnError_(FRAME_SIZE_ERROR);
+            break;
+        }
+        if(in.readableBytes() < 9 + len) {
+            // 半个帧留着等下一次可读事件
+            break;
+        }
+        bool ok = OnFrame_(h[3], h[4], ReadU32(h + 5) & 0x7fffffff, h + 9, len);
+        in.retrieve(9 + len);
+        if(!ok) break;
+    }
+    if(closing_) {
+        in.retrieveAll();
+    }
+    if(goawayReceived_ && streams_.empty()) {
+        closing_ = true;
+    }
+    Schedule_(limit);
+    return !out_->Empty();
+}
+
+size_t Http2Session::BodyBytes() const {
+    size_t bytes = 0;
+    for(const auto& kv : streams_) {
+        bytes += kv.second.body.capacity();
+    }
+    return bytes;
+}
+
+void Http2Session::Release() {
+    for(auto it = streams_.begin(); it != streams_.end(); ) {
+        if(it->second.done) {
+            it->second.response.UnmapFile();
+            it = streams_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+// ---------------- 收帧 ----------------
+
+bool Http2Session::OnFrame_(uint8_t type, uint8_t flags, uint32_t streamId, const uint8_t* p, size_t len) {
+    if(prefaceSettings_) {
+        if(type != SETTINGS || (flags & FLAG_ACK)) return ConnError_(PROTOCOL_ERROR);
+        prefaceSettings_ = false;
+    }
+    // 头部块没收完之前只能是同一个流的 CONTINUATION
+    if(headerStream_ != 0 && (type != CONTINUATION || streamId != headerStream_)) {
+        return ConnError_(PROTOCOL_ERROR);
+    }
+
+    switch(type) {
+    case DATA:
+        return OnData_(flags, streamId, p, len);
+    case HEADERS:
+        return OnHeaders_(flags, streamId, p, len);
+    case PRIORITY:
+        // 不做优先级调度，只检查格式
+        if(streamId == 0) return ConnError_(PROTOCOL_ERROR);
+        if(len != 5) ResetStream_(streamId, FRAME_SIZE_ERROR);
+        return true;
+    case RST_STREAM: {
+        if(streamId == 0 || streamId > lastStreamId_) return ConnError_(PROTOCOL_ERROR);
+        if(len != 4) return ConnError_(FRAME_SIZE_ERROR);
+        auto it = streams_.find(streamId);
+        if(it != streams_.end()) {
+            // 对端不要了：剩下的 body 不再发，这一批发完之后删掉
+            it->second.done = true;
+            DropBody_(it->second);
+        }
+        return true;
+    }
+    case SETTINGS:
+        return OnSettings_(flags, streamId, p, len);
+    case PUSH_PROMISE:
+        // 客户端不能推送
+        return ConnError_(PROTOCOL_ERROR);
+    case PING:
+        if(streamId != 0) return ConnError_(PROTOCOL_ERROR);
+        if(len != 8) return ConnError_(FRAME_SIZE_ERROR);
+        if(!(flags & FLAG_ACK)) {
+            FrameHeader_(8, PING, FLAG_ACK, 0);
+            Append_(p, 8);
+        }
+        return true;
+    case GOAWAY:
+        if(streamId != 0) return ConnError_(PROTOCOL_ERROR);
+        // 对端不再开新流：手上的处理完就关
+        goawayReceived_ = true;
+        return true;
+    case WINDOW_UPDATE:
+        return OnWindowUpdate_(streamId, p, len);
+    case CONTINUATION:
+        if(headerStream_ == 0) return ConnError_(PROTOCOL_ERROR);
+        if(headerBlock_.size() + len > HttpRequest::MAX_HEADER_BYTES) return ConnError_(ENHANCE_YOUR_CALM);
+        headerBlock_.append(reinterpret_cast<const char*>(p), len);
+        if(flags & FLAG_END_HEADERS) {
+            return OnHeaderBlock_(streamId, headerEndStream_);
+        }
+        return true;
+    default:
+        // 不认识的帧类型按协议忽略
+        return true;
+    }
+}
+
+bool Http2Session::OnHeaders_(uint8_t flags, uint32_t streamId, const uint8_t* p, size_t len) {
+    if(streamId == 0) return ConnError_(PROTOCOL_ERROR);
+    size_t pad = 0;
+    if(flags & FLAG_PADDED) {
+        if(len < 1) return ConnError_(PROTOCOL_ERROR);
+        pad = p[0];
+        p++;
+        len--;
+    }
+    if(flags & FLAG_PRIORITY) {
+        if(len < 5) return ConnError_(PROTOCOL_ERROR);
+        p += 5;
+        len -= 5;
+    }
+    if(pad > len) return ConnError_(PROTOCOL_ERROR);
+    headerBlock_.assign(reinterpret_cast<const char*>(p), len - pad);
+    headerStream_ = streamId;
+    headerEndStream_ = (flags & FLAG_END_STREAM) != 0;
+    if(flags & FLAG_END_HEADERS) {
+        return OnHeaderBlock_(streamId, headerEndStream_);
+    }
+    return true;
+}
+
+bool Http2Session::OnHeaderBlock_(uint32_t streamId, bool endStream) {
+    headerStream_ = 0;
+    // 不管这个流要不要，头部块都得解：动态表是整个连接共享的。
+    // 解出来超过 SETTINGS_MAX_HEADER_LIST_SIZE 的不留头部，回 431
+    bool tooLarge = false;
+    if(!decoder_.Decode(reinterpret_cast<const uint8_t*>(headerBlock_.data()), headerBlock_.size(),
+                        &decoded_, &tooLarge)) {
+        return ConnError_(COMPRESSION_ERROR);
+    }
+
+    auto it = streams_.find(streamId);
+    if(it != streams_.end()) {
+        // 已有的流上再来 HEADERS 只能是 trailers：带 END_STREAM，内容不用
+        Stream& stream = it->second;
+        if(stream.remoteClosed || stream.done || !endStream) {
+            ResetStream_(streamId, stream.remoteClosed ? STREAM_CLOSED : PROTOCOL_ERROR);
+            stream.done = true;
+            DropBody_(stream);
+            return true;
+        }
+        stream.remoteClosed = true;
+        if(tooLarge) {
+            Reject_(stream, 431);
+            return true;
+        }
+        Dispatch_(stream);
+        return true;
+    }
+
+    if((streamId & 1) == 0 || streamId <= lastStreamId_) return ConnError_(PROTOCOL_ERROR);
+    lastStreamId_ = streamId;
+    if(goawayReceived_) {
+        return true;
+    }
+    if(streams_.size() >= MAX_CONCURRENT_STREAMS) {
+        ResetStream_(streamId, REFUSED_STREAM);
+        return true;
+    }
+
+    Stream& stream = streams_[streamId];
+    stream.id = streamId;
+    stream.remoteClosed = endStream;
+    stream.done = false;
+    stream.resetAfter = false;
+    stream.sendWindow = peerInitialWindow_;
+    stream.recvWindow = INITIAL_WINDOW;
+    stream.headers.swap(decoded_);
+    stream.data = nullptr;
+    stream.fd = -1;
+    stream.offset = 0;
+    stream.remain = 0;
+    if(tooLarge) {
+        Reject_(stream, 431);
+    } else if(endStream) {
+        Dispatch_(stream);
+    }
+    return true;
+}
+
+bool Http2Session::OnData_(uint8_t flags, uint32_t streamId, const uint8_t* p, size_t len) {
+    if(streamId == 0) return ConnError_(PROTOCOL_ERROR);
+    // 连接级窗口按整个帧 (含填充) 算，丢掉的帧也算。对端不管我们给的窗口一直发，就是连接错误
+    if(static_cast<int64_t>(len) > recvWindow_) return ConnError_(FLOW_CONTROL_ERROR);
+    recvWindow_ -= len;
+    size_t frameLen = len;
+    if(flags & FLAG_PADDED) {
+        if(len < 1 || p[0] >= len) return ConnError_(PROTOCOL_ERROR);
+        len -= 1 + p[0];
+        p++;
+    }
+
+    auto it = streams_.find(streamId);
+    if(it == streams_.end() || it->second.remoteClosed || it->second.done) {
+        if(streamId > lastStreamId_) return ConnError_(PROTOCOL_ERROR);
+        // 已经关掉 (或者已经回了 413) 的流：对端可能还没收到，丢掉就行
+        FreeRecv_(frameLen);
+        return true;
+    }
+
+    Stream& stream = it->second;
+    // 流的窗口超了是流错误：重置这个流，已经收的 body 也不要了
+    if(static_cast<int64_t>(frameLen) > stream.recvWindow) {
+        ResetStream_(streamId, FLOW_CONTROL_ERROR);
+        stream.remoteClosed = true;
+        stream.done = true;
+        DropBody_(stream);
+        FreeRecv_(frameLen);
+        return true;
+    }
+    stream.recvWindow -= frameLen;
+    stream.body.append(reinterpret_cast<const char*>(p), len);
+    FreeRecv_(frameLen - len);
+    if(stream.body.size() > HttpRequest::maxBodyBytes) {
+        // 和 HTTP/1 一样回 413
+        Reject_(stream, 413);
+        return true;
+    }
+    if(flags & FLAG_END_STREAM) {
+        stream.remoteClosed = true;
+        Dispatch_(stream);
+        return true;
+    }
+    // 流的窗口用掉一半就还回去：攒着的 body 由连接级窗口兜住
+    if(stream.recvWindow <= INITIAL_WINDOW / 2) {
+        WindowUpdate_(streamId, static_cast<uint32_t>(INITIAL_WINDOW - stream.recvWindow));
+        stream.recvWindow = INITIAL_WINDOW;
+    }
+    return true;
+}
+
+bool Http2Session::OnSettings_(uint8_t flags, uint32_t streamId, const uint8_t* p, size_t len) {
+    if(streamId != 0) return ConnError_(PROTOCOL_ERROR);
+    if(flags & FLAG_ACK) {
+        return len == 0 ? true : ConnError_(FRAME_SIZE_ERROR);
+    }
+    if(len % 6 != 0) return ConnError_(FRAME_SIZE_ERROR);
+
+    for(size_t i = 0; i < len; i += 6) {
+        uint16_t id = static_cast<uint16_t>((p[i] << 8) | p[i + 1]);
+        uint32_t value = ReadU32(p + i + 2);
+        switch(id) {
+        case 0x1:   // HEADER_TABLE_SIZE
+            encoder_.SetPeerMaxTableSize(value);
+            break;
+        case 0x2:   // ENABLE_PUSH
+            if(value > 1) return ConnError_(PROTOCOL_ERROR);
+            break;
+        case 0x4: { // INITIAL_WINDOW_SIZE：已有流的发送窗口按差值调整，可以变成负的
+            if(value > MAX_WINDOW) return ConnError_(FLOW_CONTROL_ERROR);
+            int64_t delta = static_cast<int64_t>(value) - peerInitialWindow_;
+            for(auto& kv : streams_) {
+                kv.second.sendWindow += delta;
+                if(kv.second.sendWindow > MAX_WINDOW) return ConnError_(FLOW_CONTROL_ERROR);
+            }
+            peerInitialWindow_ = value;
+            break;
+        }
+        case 0x5:   // MAX_FRAME_SIZE
+            if(value < 16384 || value > 16777215) return ConnError_(PROTOCOL_ERROR);
+            peerMaxFrame_ = value;
+            break;
+        default:
+            break;
+        }
+    }
+    FrameHeader_(0, SETTINGS, FLAG_ACK, 0);
+    return true;
+}
+
+bool Http2Session::OnWindowUpdate_(uint32_t streamId, const uint8_t* p, size_t len) {
+    if(len != 4) return ConnError_(FRAME_SIZE_ERROR);
+    uint32_t inc = ReadU32(p) & 0x7fffffff;
+    if(streamId == 0) {
+        if(inc == 0) return ConnError_(PROTOCOL_ERROR);
+        sendWindow_ += inc;
+        if(sendWindow_ > MAX_WINDOW) return ConnError_(FLOW_CONTROL_ERROR);
+        return true;
+    }
+
+    auto it = streams_.find(streamId);
+    if(it == streams_.end() || it->second.done) {
+        // 刚发完的流，对端的窗口更新可能还在路上
+        return true;
+    }
+    Stream& stream = it->second;
+    stream.sendWindow += inc;
+    if(inc == 0 || stream.sendWindow > MAX_WINDOW) {
+        ResetStream_(streamId, inc == 0 ? PROTOCOL_ERROR : FLOW_CONTROL_ERROR);
+        stream.done = true;
+        DropBody_(stream);
+    }
+    return true;
+}
+
+// ---------------- 请求 -> 响应 ----------------
+
+// 请求不收了 (body 太大、头部太大)：回一个错误响应。对端的 body 还没发完的话，
+// 响应发完之后补一个 RST_STREAM(NO_ERROR) 让它停下
+void Http2Session::Reject_(Stream& stream, int code) {
+    stream.resetAfter = !stream.remoteClosed;
+    stream.remoteClosed = true;
+    stream.headers.clear();
+    DropBody_(stream);
+    path_.clear();
+    stream.response.Init(HttpConn::srcDir, path_, true, code);
+    Respond_(stream, false);
+}
+
+void Http2Session::Dispatch_(Stream& stream) {
+    if(!BuildRequest_(stream)) {
+        // 请求格式不对 (大写的头部名、缺伪头部、连接相关的头部……) 是流错误
+        ResetStream_(stream.id, PROTOCOL_ERROR);
+        stream.done = true;
+        DropBody_(stream);
+        return;
+    }
+    request_.Init();
+    bool ok = request_.parse(reqBuff_);
+    bool headOnly = false;
+    if(!ok || !request_.IsFinished()) {
+        path_.clear();
+        stream.response.Init(HttpConn::srcDir, path_, true, ok ? 400 : request_.ErrorCode());
+    } else {
+        headOnly = request_.method() == "HEAD";
+        const Router::Route* route = HttpConn::Dispatch(request_, true, params_, path_, stream.response);
+        if(route && route->sse) {
+            // 事件流要一直占着一个流往外推，这里的流发完就结束，先不支持
+            stream.response.InitDynamic(true);
+            stream.response.SetStatus(501);
+            stream.response.SetContentType("text/plain");
+            stream.response.Body() = "event streams are served over HTTP/1.1 only\n";
+        }
+    }
+    reqBuff_.retrieveAll();
+    stream.headers.clear();
+    DropBody_(stream);
+    Respond_(stream, headOnly);
+}
+
+static bool HasCtl(StrView s) {
+    for(char c : s) {
+        if(c == '\r' || c == '\n' || c == '\0') return true;
+    }
+    return false;
+}
+
+bool Http2Session::BuildRequest_(Stream& stream) {
+    StrView method, path, scheme, authority;
+    bool regular = false;
+    for(const HpackHeader& h : stream.headers) {
+        StrView name(h.name), value(h.value);
+        if(name.empty() || HasCtl(name) || HasCtl(value)) return false;
+        for(char c : name) {
+            if(c >= 'A' && c <= 'Z') return false;
+        }
+        if(name[0] != ':') {
+            regular = true;
+            continue;
+        }
+        // 伪头部只能在最前面，每个只能出现一次
+        StrView* slot = name == ":method" ? &method : name == ":path" ? &path :
+                        name == ":scheme" ? &scheme : name == ":authority" ? &authority : nullptr;
+        if(regular || !slot || !slot->empty()) return false;
+        *slot = value;
+    }
+    // CONNECT 不支持：它没有 :path，在这里就被拒掉
+    if(method.empty() || path.empty() || scheme.empty()) return false;
+
+    reqBuff_.retrieveAll();
+    reqBuff_.append(method.data(), method.size());
+    reqBuff_.append(" ", 1);
+    reqBuff_.append(path.data(), path.size());
+    reqBuff_.append(" HTTP/1.1\r\n", 11);
+    if(!authority.empty()) {
+        reqBuff_.append("host: ", 6);
+        reqBuff_.append(authority.data(), authority.size());
+        reqBuff_.append("\r\n", 2);
+    }
+    // HTTP/2 里 cookie 可以拆成多个头部，拼回 HTTP/1 要用 "; " 连起来
+    bool cookie = false;
+    for(const HpackHeader& h : stream.headers) {
+        StrView name(h.name);
+        if(name[0] != 'c' || name != "cookie") continue;
+        reqBuff_.append(cookie ? "; " : "cookie: ", cookie ? 2 : 8);
+        reqBuff_.append(h.value.data(), h.value.size());
+        cookie = true;
+    }
+    if(cookie) reqBuff_.append("\r\n", 2);
+
+    for(const HpackHeader& h : stream.headers) {
+        StrView name(h.name);
+        if(name[0] == ':' || name == "cookie" || name == "content-length" || (name == "host" && !authority.empty())) {
+            continue;
+        }
+        if(name == "connection" || name == "keep-alive" || name == "proxy-connection" ||
+           name == "transfer-encoding" || name == "upgrade" || (name == "te" && StrView(h.value) != "trailers")) {
+            // 连接相关的头部在 HTTP/2 里是非法的
+            return false;
+        }
+        reqBuff_.append(h.name.data(), h.name.size());
+        reqBuff_.append(": ", 2);
+        reqBuff_.append(h.value.data(), h.value.size());
+        reqBuff_.append("\r\n", 2);
+    }
+    // body 已经按 DATA 帧收全了，长度以实际收到的为准
+    if(!stream.body.empty()) {
+        std::string len = "content-length: " + std::to_string(stream.body.size()) + "\r\n";
+        reqBuff_.append(len);
+    }
+    reqBuff_.append("\r\n", 2);
+    reqBuff_.append(stream.body.data(), stream.body.size());
+    return true;
+}
+
+// 只在 HTTP/1 连接上有意义的响应头
+static bool IsHopByHop(StrView name) {
+    return name == "connection" || name == "keep-alive" || name == "transfer-encoding" ||
+           name == "upgrade" || name == "proxy-connection";
+}
+
+// 每个响应都不一样的值进动态表只会把有用的表项挤掉
+static bool ShouldIndex(StrView name) {
+    return !(name == "content-length" || name == "content-range" || name == "etag" ||
+             name == "last-modified" || name == "set-cookie");
+}
+
+void Http2Session::Respond_(Stream& stream, bool headOnly) {
+    headBuff_.retrieveAll();
+    stream.response.MakeResponse(headBuff_);
+    StrView head(headBuff_.peek(), headBuff_.readableBytes());
+
+    // "HTTP/1.1 200 OK\r\n" -> :status 200，后面每行一个头部，名字转小写
+    block_.clear();
+    encoder_.Begin(&block_);
+    encoder_.Encode(":status", head.substr(9, 3), true, &block_);
+    size_t pos = head.find(StrView("\r\n")) + 2;
+    while(pos < head.size()) {
+        size_t eol = head.find(StrView("\r\n"), pos);
+        if(eol == StrView::npos || eol == pos) break;
+        StrView line = head.substr(pos, eol - pos);
+        pos = eol + 2;
+        size_t colon = line.find(':');
+        if(colon == StrView::npos) continue;
+        lower_.assign(line.data(), colon);
+        for(char& c : lower_) {
+            if(c >= 'A' && c <= 'Z') c = static_cast<char>(c - 'A' + 'a');
+        }
+        if(IsHopByHop(lower_)) continue;
+        encoder_.Encode(lower_, line.substr(colon + 1).Trim(), ShouldIndex(lower_), &block_);
+    }
+
+    if(!headOnly) {
+        stream.remain = stream.response.FileLen();
+        if(stream.response.FileFd() >= 0) {
+            stream.fd = stream.response.FileFd();
+            stream.offset = stream.response.FileOffset();
+        } else {
+            stream.data = stream.response.File();
+            if(!stream.data) stream.remain = 0;
+        }
+    }
+    bool endStream = stream.remain == 0;
+    WriteHeaders_(stream.id, endStream);
+    if(endStream) {
+        FinishStream_(stream);
+    } else {
+        ready_.push_back(stream.id);
+    }
+}
+
+void Http2Session::WriteHeaders_(uint32_t streamId, bool endStream) {
+    // 头部块超过对端的帧大小上限时拆成 HEADERS + CONTINUATION
+    size_t pos = 0;
+    do {
+        size_t n = std::min(block_.size() - pos, static_cast<size_t>(peerMaxFrame_));
+        bool last = pos + n == block_.size();
+        uint8_t flags = last ? FLAG_END_HEADERS : 0;
+        if(pos == 0 && endStream) flags |= FLAG_END_STREAM;
+        FrameHeader_(n, pos == 0 ? HEADERS : CONTINUATION, flags, streamId);
+        Append_(block_.data() + pos, n);
+        pos += n;
+    } while(pos < block_.size());
+}
+
+void Http2Session::Schedule_(size_t limit) {
+    size_t queued = out_->Bytes();
+    bool progress = true;
+    // 每一轮给每个流发一帧，窗口用完的流跳过，等对端的 WINDOW_UPDATE
+    while(progress && !ready_.empty()) {
+        progress = false;
+        for(size_t i = 0; i < ready_.size(); ) {
+            // 帧按剩下的额度裁，整批不越过 limit：越过就是越过高水位，连接要暂停读
+            if(queued + 9 >= limit || sendWindow_ <= 0 || out_->SegmentCount() + 4 > MAX_SEGMENTS) {
+                return;
+            }
+            auto it = streams_.find(ready_[i]);
+            if(it == streams_.end() || it->second.done) {
+                ready_.erase(ready_.begin() + i);
+                continue;
+            }
+            Stream& stream = it->second;
+            if(stream.sendWindow <= 0) {
+                i++;
+                continue;
+            }
+            size_t n = std::min<int64_t>(std::min<int64_t>(stream.remain, peerMaxFrame_),
+                                         std::min(stream.sendWindow, sendWindow_));
+            n = std::min(n, limit - queued - 9);
+            if(stream.fd >= 0) {
+                // 文件不在内存里：帧头和数据放在同一个块里，数据直接 pread 到帧头后面
+                n = std::min(n, ChainBuffer::BLOCK_SIZE - 9);
+                char* frame = out_->Reserve(9 + n);
+                ssize_t r = pread(stream.fd, frame + 9, n, stream.offset);
+                if(r <= 0) {
+                    ResetStream_(stream.id, INTERNAL_ERROR);
+                    stream.done = true;
+                    continue;
+                }
+                n = static_cast<size_t>(r);
+                WriteFrameHeader(frame, n, DATA, n == stream.remain ? FLAG_END_STREAM : 0, stream.id);
+                out_->Commit(9 + n);
+                stream.offset += n;
+            } else {
+                FrameHeader_(n, DATA, n == stream.remain ? FLAG_END_STREAM : 0, stream.id);
+                if(n < COPY_THRESHOLD) {
+                    Append_(stream.data, n);
+                } else {
+                    out_->AppendRef(stream.data, n);
+                }
+                stream.data += n;
+            }
+            stream.remain -= n;
+            stream.sendWindow -= n;
+            sendWindow_ -= n;
+            queued += 9 + n;
+            progress = true;
+            if(stream.remain == 0) {
+                FinishStream_(stream);
+                ready_.erase(ready_.begin() + i);
+            } else {
+                i++;
+            }
+        }
+    }
+}
+
+void Http2Session::FinishStream_(Stream& stream) {
+    // body 可能还引用着缓存条目，等这一批发出去再删
+    stream.done = true;
+    if(stream.resetAfter) {
+        ResetStream_(stream.id, NO_ERROR);
+    }
+}
+
+// ---------------- 发帧 ----------------
+
+bool Http2Session::ConnError_(ErrorCode code) {
+    uint8_t payload[8];
+    WriteU32(payload, lastStreamId_);
+    WriteU32(payload + 4, code);
+    FrameHeader_(sizeof(payload), GOAWAY, 0, 0);
+    Append_(payload, sizeof(payload));
+    closing_ = true;
+    return false;
+}
+
+void Http2Session::ResetStream_(uint32_t streamId, ErrorCode code) {
+    uint8_t payload[4];
+    WriteU32(payload, code);
+    FrameHeader_(sizeof(payload), RST_STREAM, 0, streamId);
+    Append_(payload, sizeof(payload));
+}
+
+void Http2Session::WindowUpdate_(uint32_t streamId, uint32_t inc) {
+    uint8_t payload[4];
+    WriteU32(payload, inc);
+    FrameHeader_(sizeof(payload), WINDOW_UPDATE, 0, streamId);
+    Append_(payload, sizeof(payload));
+}
+
+void Http2Session::DropBody_(Stream& stream) {
+    FreeRecv_(stream.body.size());
+    std::string().swap(stream.body);
+}
+
+void Http2Session::FreeRecv_(size_t len) {
+    recvFreed_ += len;
+    if(recvFreed_ >= recvLimit_ / 2) {
+        WindowUpdate_(0, static_cast<uint32_t>(recvFreed_));
+        recvWindow_ += recvFreed_;
+        recvFreed_ = 0;
+    }
+}
+
+void Http2Session::FrameHeader_(size_t len, uint8_t type, uint8_t flags, uint32_t streamId) {
+    uint8_t h[9];
+    WriteFrameHeader(h, len, type, flags, streamId);
+    Append_(h, sizeof(h));
+}
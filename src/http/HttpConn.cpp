@@ -0,0 +1,435 @@
+#include "http/HttpConn.h"
+#include "http/Http2Session.h"
+#include "http/WebSocket.h"
+#include "log.h"
+#include "BufferBudget.h"
+#include <cassert>
+#include <algorithm>
+#include <chrono>
+#include <cerrno>
+#include <cstring>
+#include <sys/socket.h>
+
+std::string HttpConn::srcDir;
+std::atomic<int> HttpConn::userCount(0);
+size_t HttpConn::highWaterMark = 1024 * 1024;
+int HttpConn::idleReleaseMs = 10000;
+
+// SSE 事件流的结尾 (最后一个空 chunk) 和保活用的注释行，静态的，直接引用
+static const char STREAM_END[] = "0\r\n\r\n";
+static const char STREAM_KEEPALIVE[] = "d\r\n: keepalive\n\n\r\n";
+
+// 连接关闭后留着给下一个连接复用的缓冲区容量，比这大的 (被大请求撑大的) 关闭时还掉
+static const size_t RETAIN_BYTES = 16 * 1024;
+
+HttpConn::HttpConn()
+    : fd_(-1), isClose_(true), isKeepAlive_(false), responses_(1), batch_(0),
+      prefaceChecked_(false), isHttp2_(false), isWebSocket_(false), isEventStream_(false),
+      streamPingDue_(false), pushTarget_(nullptr), pushHead_(0), charged_(0),
+      readBlocked_(false), lastActiveMs_(0) {
+    memset(&addr_, 0, sizeof(addr_));
+}
+
+HttpConn::~HttpConn() {
+    Close();
+    BufferBudget::Instance()->Charge(charged_, 0);
+}
+
+void HttpConn::Init(int sockFd, const sockaddr_in& addr, PushTarget* pushTarget) {
+    assert(sockFd >= 0);
+    userCount++;
+    fd_ = sockFd;
+    addr_ = addr;
+    isClose_ = false;
+    isKeepAlive_ = false;
+    ReleaseBatch_();
+    readBuff_.retrieveAll();
+    request_.Init();
+    prefaceChecked_ = false;
+    isHttp2_ = false;
+    isWebSocket_ = false;
+    isEventStream_ = false;
+    streamPingDue_ = false;
+    pushTarget_ = pushTarget;
+    readBlocked_ = false;
+    lastActiveMs_ = NowMs();
+    Account();
+}
+
+void HttpConn::Close() {
+    ReleaseBatch_();
+    if(isHttp2_) {
+        http2_->Reset();
+    }
+    if(sub_) {
+        sub_->Detach();
+        sub_.reset();
+    }
+    pushed_.clear();
+    pushHead_ = 0;
+    if(isWebSocket_) {
+        ws_->Disconnect();
+    }
+    // 关掉以后读缓冲区里剩下的半个请求没用了
+    readBuff_.retrieveAll();
+    if(readBuff_.capacity() > RETAIN_BYTES) {
+        readBuff_.shrink();
+    }
+    if(writeBuff_.capacity() > RETAIN_BYTES) {
+        writeBuff_.shrink();
+    }
+    Account();
+    if(!isClose_) {
+        isClose_ = true;
+        userCount--;
+        close(fd_);
+        LOG_INFO("Client[%d] quit, userCount:%d", fd_, (int)userCount);
+    }
+}
+
+ssize_t HttpConn::read(int* saveErrno) {
+    ssize_t total = 0;
+    readBlocked_ = false;
+    while(true) {
+        // 每次读之前按预算封顶：一直读到 EAGAIN 的话，发得快的客户端能把读缓冲区撑到任意大
+        size_t room = ReadRoom();
+        if(room == 0) {
+            readBlocked_ = true;
+            *saveErrno = EAGAIN;
+            return total;
+        }
+        ssize_t len = readBuff_.readFd(fd_, saveErrno, room);
+        if(len > 0) {
+            total += len;
+            lastActiveMs_ = NowMs();
+            Account();
+            continue;
+        }
+        if(len == 0) {
+            // 对端关闭：先把已经读到的请求处理掉
+            return total;
+        }
+        return total > 0 ? total : -1;
+    }
+}
+
+void HttpConn::Receive(const char* data, size_t len) {
+    size_t room = BufferBudget::Instance()->Headroom(charged_);
+    readBuff_.ensureWritable(len, room > SIZE_MAX - readBuff_.capacity() ? SIZE_MAX : readBuff_.capacity() + room);
+    readBuff_.append(data, len);
+    lastActiveMs_ = NowMs();
+    Account();
+}
+
+ssize_t HttpConn::write(int* saveErrno) {
+    ssize_t total = 0;
+    while(ToWriteBytes() > 0) {
+        ssize_t len = out_.WriteFd(fd_, saveErrno);
+        if(len < 0) {
+            return total > 0 ? total : -1;
+        }
+        total += len;
+    }
+    // 一批响应发完，立刻放掉缓存条目的引用 (条目可能已经被淘汰，只等这一个引用)
+    ReleaseBatch_();
+    return total;
+}
+
+void HttpConn::AdvanceWrite(size_t len) {
+    out_.Advance(len);
+    if(ToWriteBytes() == 0) {
+        ReleaseBatch_();
+    }
+}
+
+void HttpConn::ReleaseBatch_() {
+    for(size_t i = 0; i < batch_; i++) {
+        responses_[i].UnmapFile();
+    }
+    if(isHttp2_) {
+        http2_->Release();
+    }
+    batch_ = 0;
+    headEnd_.clear();
+    headOnly_.clear();
+    out_.Clear();
+    writeBuff_.retrieveAll();
+}
+
+bool HttpConn::process() {
+    lastActiveMs_ = NowMs();
+    bool ready = Process_();
+    // 回复、推送也会撑大写缓冲区：这里只记账，超预算的连接在读的时候断开
+    Account();
+    return ready;
+}
+
+bool HttpConn::Process_() {
+    // 上一批发完才会进来
+    assert(ToWriteBytes() == 0);
+    ReleaseBatch_();
+
+    if(!prefaceChecked_) {
+        int preface = Http2Session::MatchPreface(readBuff_);
+        if(preface < 0) {
+            // 前言的前半截：等收全再决定是哪个协议
+            return false;
+        }
+        prefaceChecked_ = true;
+        if(preface > 0) {
+            readBuff_.retrieve(Http2Session::PREFACE_LEN);
+            if(!http2_) {
+                http2_.reset(new Http2Session());
+            }
+            http2_->Init(&out_);
+            isHttp2_ = true;
+        }
+    }
+    if(isHttp2_) {
+        return ProcessHttp2_();
+    }
+    if(isWebSocket_) {
+        return ProcessWebSocket_();
+    }
+    if(isEventStream_) {
+        return ProcessEventStream_();
+    }
+
+    size_t pending = 0;
+    while(batch_ < MAX_PIPELINE && readBuff_.readableBytes() > 0) {
+        bool ok = request_.parse(readBuff_);
+        if(ok && !request_.IsFinished()) {
+            // 剩下的半个请求留在 readBuff_ 里等下一次可读事件
+            break;
+        }
+        if(batch_ == responses_.size()) {
+            responses_.emplace_back();
+        }
+        HttpResponse& response = responses_[batch_++];
+        const Router::Route* route = nullptr;
+        bool headOnly = ok && request_.method() == "HEAD";
+        if(!ok) {
+            // 请求不能处理：回 400/413/501 并关闭连接，剩下的字节没法再解析了
+            isKeepAlive_ = false;
+            readBuff_.retrieveAll();
+            path_.clear();
+            response.Init(srcDir, path_, false, request_.ErrorCode());
+        } else {
+            isKeepAlive_ = request_.IsKeepAlive();
+            route = Dispatch(request_, isKeepAlive_, params_, path_, response);
+        }
+
+        size_t headStart = writeBuff_.readableBytes();
+        response.MakeResponse(writeBuff_);
+        if(response.Code() == 101) {
+            // 升级成功：onOpen 发的消息紧跟在 101 后面，读缓冲区里剩下的字节已经是帧了
+            if(!ws_) {
+                ws_.reset(new WebSocket());
+            }
+            sub_ = std::make_shared<Subscriber>(Subscriber::WEBSOCKET, fd_, pushTarget_);
+            ws_->Open(route->websocket, request_, params_, writeBuff_, sub_);
+            isWebSocket_ = true;
+            isKeepAlive_ = true;
+        } else if(route && route->sse) {
+            // 事件流：handler 订阅频道，它先发的事件紧跟在响应头后面
+            sub_ = std::make_shared<Subscriber>(Subscriber::SSE, fd_, pushTarget_);
+            EventStream stream(*sub_, writeBuff_);
+            (*route->sse)(request_, params_, stream);
+            isEventStream_ = true;
+            isKeepAlive_ = true;
+        }
+        request_.Init();
+        headEnd_.push_back(writeBuff_.readableBytes());
+        headOnly_.push_back(headOnly);
+        pending += writeBuff_.readableBytes() - headStart + (headOnly ? 0 : response.FileLen());
+
+        // 这几种情况后面不能再接：连接要关了；攒的数据已经到高水位，再多也是等着；
+        // 升级成 WebSocket、开始推事件之后不再是 HTTP 请求。走 sendfile 的文件只是队列里的一段，后面照样能接
+        if(!isKeepAlive_ || pending > highWaterMark || isWebSocket_ || isEventStream_) {
+            break;
+        }
+    }
+    if(batch_ == 0) {
+        return false;
+    }
+    BuildOutput_();
+    return true;
+}
+
+bool HttpConn::ProcessHttp2_() {
+    bool ready = http2_->Process(readBuff_, highWaterMark);
+    // 发了 GOAWAY：这一批发完就关
+    isKeepAlive_ = !http2_->IsClosing();
+    return ready;
+}
+
+bool HttpConn::ProcessWebSocket_() {
+    ws_->Process(readBuff_, writeBuff_, highWaterMark);
+    if(!ws_->IsClosing() && !TakePushed_()) {
+        // 订阅的消息积压太多，对端收不过来
+        ws_->Shutdown(writeBuff_, WebSocket::TRY_AGAIN_LATER);
+    }
+    // 发了关闭帧：这一批发完就关
+    isKeepAlive_ = !ws_->IsClosing();
+    out_.AppendRef(writeBuff_.peek(), writeBuff_.readableBytes());
+    if(isKeepAlive_) {
+        AppendPushed_();
+    }
+    return !out_.Empty();
+}
+
+bool HttpConn::ProcessEventStream_() {
+    // 事件流上客户端不该再发东西，收到什么都丢掉
+    readBuff_.retrieveAll();
+    if(!TakePushed_()) {
+        // 积压太多：用最后一个空 chunk 结束响应，发完关连接
+        out_.AppendRef(STREAM_END, sizeof(STREAM_END) - 1);
+        isKeepAlive_ = false;
+    } else if(streamPingDue_.exchange(false) && pushHead_ == pushed_.size()) {
+        // 空闲太久：发一行注释，中间的代理不会把连接当成死的
+        out_.AppendRef(STREAM_KEEPALIVE, sizeof(STREAM_KEEPALIVE) - 1);
+    }
+    if(isKeepAlive_) {
+        AppendPushed_();
+    }
+    return !out_.Empty();
+}
+
+// 把订阅者积压的消息取过来。对端收得太慢、积压被丢掉时返回 false
+bool HttpConn::TakePushed_() {
+    if(pushHead_ == pushed_.size()) {
+        pushed_.clear();
+        pushHead_ = 0;
+    }
+    if(sub_->Take(&pushed_)) {
+        return true;
+    }
+    pushed_.clear();
+    pushHead_ = 0;
+    return false;
+}
+
+// 推送消息接在这一批后面：直接指向共享的那一份，不拷进 writeBuff_。
+// 引用交给 out_，这一条发完就放掉，最后一个连接放掉时共享的那一份才释放
+void HttpConn::AppendPushed_() {
+    size_t end = std::min(pushed_.size(), pushHead_ + MAX_PUSH_IOV);
+    for(; pushHead_ < end; pushHead_++) {
+        SharedPayload& payload = pushed_[pushHead_];
+        const char* data = payload->data();
+        size_t len = payload->size();
+        out_.AppendShared(std::move(payload), data, len);
+    }
+}
+
+int64_t HttpConn::NowMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+bool HttpConn::Account() {
+    // h2c 的请求 body 收全之前攒在各个流里，也是这个连接占的内存
+    size_t now = readBuff_.capacity() + writeBuff_.capacity() + (isHttp2_ ? http2_->BodyBytes() : 0);
+    bool ok = BufferBudget::Instance()->Charge(charged_, now);
+    charged_ = now;
+    return ok;
+}
+
+size_t HttpConn::ReadRoom() const {
+    size_t room = BufferBudget::Instance()->Headroom(charged_);
+    size_t spare = readBuff_.writableBytes() + readBuff_.prependableBytes();
+    return room > SIZE_MAX - spare ? SIZE_MAX : room + spare;
+}
+
+size_t HttpConn::ReleaseIdle(int64_t nowMs) {
+    if(isClose_ || idleReleaseMs <= 0 || nowMs - lastActiveMs_ < idleReleaseMs || charged_ == 0 ||
+       ToWriteBytes() > 0 || readBuff_.readableBytes() > 0) {
+        return 0;
+    }
+    size_t before = charged_;
+    readBuff_.shrink();
+    writeBuff_.shrink();
+    Account();
+    BufferBudget::Instance()->CountRelease(before - charged_);
+    return before - charged_;
+}
+
+bool HttpConn::KeepAliveTick() {
+    if(isWebSocket_) {
+        return ws_->KeepAliveTick();
+    }
+    if(isEventStream_) {
+        streamPingDue_ = true;
+        return true;
+    }
+    return false;
+}
+
+// 按路由表分发：动态路由交给 handler，静态文件路由和以前一样去资源目录找
+const Router::Route* HttpConn::Dispatch(const HttpRequest& request, bool keepAlive, RouteParams& params,
+                                        std::string& path, HttpResponse& response) {
+    Router::MatchResult result;
+    std::string allow;
+    const Router::Route* route = Router::Instance()->Match(request.method(), request.path(), &params, &result, &allow);
+    if(route && route->websocket) {
+        response.InitDynamic(keepAlive);
+        if(WebSocket::IsUpgrade(request)) {
+            response.SetStatus(101);
+            response.AddHeader("Upgrade", "websocket");
+            response.AddHeader("Sec-WebSocket-Accept", WebSocket::AcceptKey(request.GetHeader(HDR_SEC_WEBSOCKET_KEY)));
+        } else {
+            response.SetStatus(426);
+            response.SetContentType("text/plain");
+            response.AddHeader("Upgrade", "websocket");
+            response.AddHeader("Sec-WebSocket-Version", "13");
+            response.Body() = "WebSocket endpoint\n";
+        }
+        return route;
+    }
+    if(route && route->sse) {
+        // 响应头先发，body 是 chunked 的事件流，一直不结束
+        response.InitDynamic(keepAlive);
+        response.SetContentType("text/event-stream");
+        response.SetChunked();
+        response.AddHeader("Cache-Control", "no-cache");
+        return route;
+    }
+    if(route && route->handler) {
+        response.InitDynamic(keepAlive);
+        route->handler(request, params, response);
+        return route;
+    }
+    // 请求里的视图只在这一次解析期间有效，要留下来的东西在这里拷走
+    StrView p = request.path();
+    path.assign(p.data(), p.size());
+    int code = route ? 200 : (result == Router::METHOD_NOT_ALLOWED ? 405 : 404);
+    response.Init(srcDir, path, keepAlive, code);
+    response.SetRequest(request);
+    if(code == 405) {
+        response.AddHeader("Allow", allow);
+    }
+    return route;
+}
+
+void HttpConn::BuildOutput_() {
+    // 头部全部写完了 writeBuff_ 才不会再搬家，这时候才能取指针。
+    // 中间的响应没有 body (304、HEAD 等) 时相邻的头部在 out_ 里合成一段
+    const char* heads = writeBuff_.peek();
+    size_t headStart = 0;
+    for(size_t i = 0; i < batch_; i++) {
+        const HttpResponse& response = responses_[i];
+        out_.AppendRef(heads + headStart, headEnd_[i] - headStart);
+        headStart = headEnd_[i];
+        if(headOnly_[i]) {
+            // HEAD：body 不管是内存、缓存还是文件都不发，不然流水线上后面的响应就错位了
+            continue;
+        }
+        if(response.FileFd() >= 0) {
+            out_.AppendFile(response.FileFd(), response.FileOffset(), response.FileLen(), response.Entry());
+        } else if(response.File() && response.Entry()) {
+            out_.AppendShared(response.Entry(), response.File(), response.FileLen());
+        } else if(response.File()) {
+            // 动态 body、多段 Range 拼好的 body 在 response 里，这一批发完之前都在
+            out_.AppendRef(response.File(), response.FileLen());
+        }
+    }
+}
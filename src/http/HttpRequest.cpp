@@ -1,139 +1,478 @@
 #include "http/HttpRequest.h"
-#include <algorithm> // for std::search
+#include "http/HttpScan.h"
+#include <algorithm>
+
+size_t HttpRequest::maxBodyBytes = 8 * 1024 * 1024;
+HttpRequest::BodyHandlerFactory HttpRequest::bodyHandlerFactory;
 
 // 初始化/重置请求对象
 void HttpRequest::Init() {
-    method_ = path_ = version_ = body_ = "";
     state_ = REQUEST_LINE; // 初始状态
-    header_.clear();
-    post_.clear();
+    errorCode_ = 400;
+    parsed_ = 0;
+    scanned_ = 0;
+    bodyStart_ = 0;
+    bodyLen_ = 0;
+    remaining_ = 0;
+    trailerStart_ = 0;
+    handler_ = nullptr;
+    methodSpan_ = pathSpan_ = versionSpan_ = Span{0, 0};
+    knownMask_ = 0;
+    otherSpans_.clear();
+    base_ = nullptr;
+    method_ = path_ = version_ = body_ = StrView();
+    others_.clear();
+    if(!post_.empty()) post_.clear();
+    files_.clear();
 }
 
 // 主状态机：解析 Buffer 中的数据
+// 请求收全之前一个字节都不取走，parsed_ 记着解析到哪；收全后整个请求一次取走
 bool HttpRequest::parse(Buffer& buff) {
-    const char CRLF[] = "\r\n";
-    if(buff.readableBytes() <= 0) return false;
-
-    // 只要还有数据且没解析完，就一直循环
-    while(buff.readableBytes() && state_ != FINISH) {
-        // --- 1. 获取当前行的数据范围 ---
-        // 起点：Buffer 的读指针 (Public API)
-        const char* lineStart = buff.peek();
-        // 终点：Buffer 的有效数据末尾
-        const char* lineEndPtr = lineStart + buff.readableBytes();
-        
-        // --- 2. 搜索行结束符 \r\n ---
-        const char* lineEnd = std::search(lineStart, lineEndPtr, CRLF, CRLF + 2);
-
-        std::string line;
-
-        // 如果没找到 \r\n
-        if(lineEnd == lineEndPtr) {
-            // 如果是在读 Body，可能不需要 CRLF (这里简化处理)
-            // 如果是在读 Header 或 RequestLine，必须凑齐一行才处理
-            if(state_ != BODY) return false; 
+    char* base = buff.peek();
+    size_t avail = buff.readableBytes();
+
+    while(state_ != FINISH) {
+        if(state_ == BODY || state_ == CHUNK_DATA) {
+            // --- 数据部分不找行尾，按长度收 ---
+            size_t n = std::min(avail - parsed_, remaining_);
+            if(n == 0) break;
+            if(bodyStart_ + bodyLen_ != parsed_) {
+                // chunked：把数据挪到上一块的后面，盖掉中间的长度行，body 保持连续
+                memmove(base + bodyStart_ + bodyLen_, base + parsed_, n);
+            }
+            parsed_ += n;
+            bodyLen_ += n;
+            remaining_ -= n;
+            if(remaining_ == 0) {
+                state_ = state_ == BODY ? FINISH : CHUNK_DATA_END;
+            }
+            continue;
         }
 
-        // --- 3. 提取这一行 ---
-        line = std::string(lineStart, lineEnd);
-        
-        // --- 4. 移动 Buffer 读指针 ---
-        // 跳过当前行数据 + 跳过 \r\n (2字节)
-        buff.retrieveUntil(lineEnd + 2);
-
-        // --- 5. 状态机流转 ---
-        switch(state_) {
-            case REQUEST_LINE:
-                if(!ParseRequestLine_(line)) return false;
-                ParsePath_(); // 解析完请求行后，处理一下路径
-                break;
-                
-            case HEADERS:
-                ParseHeader_(line);
-                if(buff.readableBytes() <= 0) {
-                     // 如果读完了还没遇到空行，可能是 POST 请求体还在后面
-                     // 这里做一个简单的边界判断，防止死循环
-                     if(method_ == "POST") state_ = BODY;
-                     else state_ = FINISH;
-                }
-                break;
-                
-            case BODY:
-                ParseBody_(line);
-                break;
-                
-            default:
-                break;
+        // --- 其余状态一次处理一行 ---
+        // 一次扫 16/32 个字节找第一个控制字符：正常情况下就是 '\r'，其他控制字符直接判非法。
+        // 上次没收全的行从 scanned_ 接着扫，不从行首重来：客户端一个字节一个字节发也是 O(n)
+        const char* stop = base + avail;
+        const char* cr = HttpScan::FindLineEnd(base + std::max(parsed_, scanned_), stop);
+        if(cr + 1 >= stop) {
+            // 这一行还没收全，记下扫到哪 (末尾单独一个 '\r' 下次还要看它后面是不是 '\n')；
+            // 行太长就不等了
+            scanned_ = cr - base;
+            if(state_ == REQUEST_LINE || state_ == HEADERS) {
+                if(avail > MAX_HEADER_BYTES) return Fail_(400);
+            } else if(state_ == TRAILERS) {
+                if(avail - trailerStart_ > MAX_HEADER_BYTES) return Fail_(400);
+            } else if(avail - parsed_ > MAX_CHUNK_LINE) {
+                return Fail_(400);
+            }
+            break;
         }
+        if(cr[0] != '\r' || cr[1] != '\n') return Fail_(400);
+
+        size_t start = parsed_;
+        size_t end = cr - base;
+        parsed_ = end + 2;
+        if(!ParseLine_(base, start, end)) return false;
+    }
+
+    if(handler_ && !StreamBody_(buff, base)) {
+        return false;
+    }
+    if(state_ == FINISH) {
+        // 取走只是移动读指针，内存还在，视图在下一次写入 buff 之前都有效
+        Finish_(base);
+        buff.retrieve(parsed_);
     }
     return true;
 }
 
+// 按当前状态处理 [start, end) 这一行 (不含 \r\n)
+bool HttpRequest::ParseLine_(const char* base, size_t start, size_t end) {
+    switch(state_) {
+        case REQUEST_LINE:
+            if(!ParseRequestLine_(base, start, end)) return Fail_(400);
+            if(parsed_ > MAX_HEADER_BYTES) return Fail_(400);
+            return true;
+        case HEADERS:
+            if(parsed_ > MAX_HEADER_BYTES) return Fail_(400);
+            return ParseHeader_(base, start, end);
+        case CHUNK_SIZE:
+            return ParseChunkSize_(StrView(base + start, end - start));
+        case CHUNK_DATA_END:
+            if(start != end) return Fail_(400);
+            state_ = CHUNK_SIZE;
+            return true;
+        case TRAILERS:
+            // 尾部头不用，只检查格式，到空行为止
+            if(start == end) {
+                state_ = FINISH;
+                return true;
+            }
+            if(parsed_ - trailerStart_ > MAX_HEADER_BYTES) return Fail_(400);
+            {
+                const char* nameEnd = HttpScan::FindNameEnd(base + start, base + end);
+                if(nameEnd == base + start || nameEnd == base + end || *nameEnd != ':') return Fail_(400);
+            }
+            return true;
+        default:
+            return Fail_(400);
+    }
+}
+
 // 解析请求行：GET /index.html HTTP/1.1
-bool HttpRequest::ParseRequestLine_(const std::string& line) {
+bool HttpRequest::ParseRequestLine_(const char* base, size_t start, size_t end) {
+    StrView line(base + start, end - start);
     // 找第一个空格：方法结束
     size_t methodEnd = line.find(' ');
-    if(methodEnd == std::string::npos) return false;
-    method_ = line.substr(0, methodEnd);
+    if(methodEnd == StrView::npos || methodEnd == 0) return false;
 
     // 找第二个空格：路径结束
     size_t pathEnd = line.find(' ', methodEnd + 1);
-    if(pathEnd == std::string::npos) return false;
-    path_ = line.substr(methodEnd + 1, pathEnd - methodEnd - 1);
+    if(pathEnd == StrView::npos || pathEnd == methodEnd + 1) return false;
 
     // 剩下的是版本号
-    version_ = line.substr(pathEnd + 1);
-    
+    if(!line.substr(pathEnd + 1).StartsWith("HTTP/")) return false;
+
+    methodSpan_ = Span{static_cast<uint32_t>(start), static_cast<uint32_t>(methodEnd)};
+    pathSpan_ = Span{static_cast<uint32_t>(start + methodEnd + 1), static_cast<uint32_t>(pathEnd - methodEnd - 1)};
+    versionSpan_ = Span{static_cast<uint32_t>(start + pathEnd + 1), static_cast<uint32_t>(end - start - pathEnd - 1)};
     state_ = HEADERS; // 状态变为解析头部
     return true;
 }
 
 // 解析头部：Host: localhost
-void HttpRequest::ParseHeader_(const std::string& line) {
-    if(line.empty()) {
+bool HttpRequest::ParseHeader_(const char* base, size_t start, size_t end) {
+    if(start == end) {
         // 遇到空行，Header 结束
-        if(method_ == "POST") {
-            state_ = BODY;
-        } else {
-            state_ = FINISH;
+        return HeadersDone_(base);
+    }
+
+    // 找冒号：名字里不允许空白和控制字符，"Host : x" 这种按 RFC 7230 直接拒绝
+    StrView line(base + start, end - start);
+    const char* nameEnd = HttpScan::FindNameEnd(line.begin(), line.end());
+    if(nameEnd == line.begin() || nameEnd == line.end() || *nameEnd != ':') return Fail_(400);
+    size_t colon = nameEnd - line.begin();
+
+    // 去掉 value 两边的空白
+    StrView value = line.substr(colon + 1).Trim();
+    Span key{static_cast<uint32_t>(start), static_cast<uint32_t>(colon)};
+    Span val{static_cast<uint32_t>(value.data() - base), static_cast<uint32_t>(value.size())};
+
+    HeaderId id = HttpHeader::Lookup(line.substr(0, colon));
+    if(id != HDR_UNKNOWN) {
+        uint32_t bit = 1u << id;
+        if(!(knownMask_ & bit)) {
+            knownSpans_[id] = val;
+            knownMask_ |= bit;
+            return true;
+        }
+        // 重复出现：决定 body 长度的两个头不允许有歧义，其余的放进 others
+        StrView first(base + knownSpans_[id].off, knownSpans_[id].len);
+        if(id == HDR_CONTENT_LENGTH && first != value) return Fail_(400);
+        if(id == HDR_TRANSFER_ENCODING) return Fail_(501);
+    }
+    otherSpans_.push_back(std::make_pair(key, val));
+    return true;
+}
+
+// 头部收全：决定 body 怎么分帧 (RFC 7230 3.3.3)
+bool HttpRequest::HeadersDone_(const char* base) {
+    bodyStart_ = parsed_;
+    base_ = base;
+    StrView contentLen = GetHeader(HDR_CONTENT_LENGTH);
+    StrView transferEncoding = GetHeader(HDR_TRANSFER_ENCODING);
+    if(HasHeader(HDR_CONTENT_LENGTH) && contentLen.empty()) return Fail_(400);
+
+    bool chunked = false;
+    size_t length = 0;
+    if(HasHeader(HDR_TRANSFER_ENCODING)) {
+        // 两个都有是请求走私的典型手法，直接拒绝；编码只支持 chunked 一种
+        if(HasHeader(HDR_CONTENT_LENGTH)) return Fail_(400);
+        if(!transferEncoding.EqualsIgnoreCase("chunked")) return Fail_(501);
+        chunked = true;
+    } else {
+        for(char c : contentLen) {
+            if(c < '0' || c > '9' || length > (static_cast<size_t>(1) << 48)) return Fail_(400);
+            length = length * 10 + (c - '0');
         }
-        return;
     }
 
-    // 找冒号
-    size_t colon = line.find(':');
-    if(colon == std::string::npos) return;
+    if(!chunked && length == 0) {
+        state_ = FINISH;
+        return true;
+    }
+    if(bodyHandlerFactory) {
+        // 回调里要看请求头，先把视图建出来 (base 在这次 parse 里不会变)
+        Materialize_(base);
+        handler_ = bodyHandlerFactory(*this);
+    }
+    if(!handler_ && length > maxBodyBytes) return Fail_(413);
+
+    remaining_ = length;
+    state_ = chunked ? CHUNK_SIZE : BODY;
+    return true;
+}
+
+// "1a2b[;name=value]"：十六进制长度，扩展忽略
+bool HttpRequest::ParseChunkSize_(StrView line) {
+    size_t size = 0, i = 0;
+    for(; i < line.size(); i++) {
+        char c = line[i];
+        int d;
+        if(c >= '0' && c <= '9') d = c - '0';
+        else if(c >= 'a' && c <= 'f') d = c - 'a' + 10;
+        else if(c >= 'A' && c <= 'F') d = c - 'A' + 10;
+        else break;
+        if(i >= 15) return Fail_(400);
+        size = size * 16 + d;
+    }
+    if(i == 0) return Fail_(400);
+    StrView rest = line.substr(i).Trim();
+    if(!rest.empty() && rest[0] != ';') return Fail_(400);
+
+    if(size == 0) {
+        trailerStart_ = parsed_;
+        state_ = TRAILERS;
+        return true;
+    }
+    if(!handler_ && bodyLen_ + size > maxBodyBytes) return Fail_(413);
+    remaining_ = size;
+    state_ = CHUNK_DATA;
+    return true;
+}
+
+// 流式 body：这次解码出来的数据交给回调，然后从 buff 里挖掉 (连同中间的长度行)，
+// 缓冲区里只剩请求头和还没解析的字节，上传多大都不会把内存撑起来
+bool HttpRequest::StreamBody_(Buffer& buff, char* base) {
+    bool last = state_ == FINISH;
+    if(bodyLen_ == 0 && !last) {
+        return true;
+    }
+    Materialize_(base);
+    if(!handler_(*this, StrView(base + bodyStart_, bodyLen_), last)) {
+        return Fail_(400);
+    }
+    size_t consumed = parsed_ - bodyStart_;
+    if(consumed > 0) {
+        buff.erase(bodyStart_, consumed);
+        scanned_ = scanned_ > parsed_ ? scanned_ - consumed : 0;
+        if(trailerStart_ > bodyStart_) trailerStart_ = bodyStart_;
+        parsed_ = bodyStart_;
+    }
+    bodyLen_ = 0;
+    return true;
+}
+
+bool HttpRequest::Fail_(int code) {
+    errorCode_ = code;
+    return false;
+}
 
-    std::string key = line.substr(0, colon);
-    std::string value = line.substr(colon + 1);
-    
-    // 去掉 value 前面的空格
-    while(!value.empty() && value[0] == ' ') value.erase(0, 1);
-    
-    header_[key] = value;
+// 偏移换成指向 buff 的视图
+void HttpRequest::Materialize_(const char* base) {
+    method_ = StrView(base + methodSpan_.off, methodSpan_.len);
+    path_ = StrView(base + pathSpan_.off, pathSpan_.len);
+    version_ = StrView(base + versionSpan_.off, versionSpan_.len);
+    base_ = base;
+    others_.clear();
+    for(const auto& h : otherSpans_) {
+        others_.push_back(Header{StrView(base + h.first.off, h.first.len),
+                                 StrView(base + h.second.off, h.second.len)});
+    }
+    ParsePath_(); // 处理一下路径
 }
 
-// 解析 Body
-void HttpRequest::ParseBody_(const std::string& line) {
-    body_ = line;
+// 请求收全
+void HttpRequest::Finish_(const char* base) {
+    Materialize_(base);
+    body_ = StrView(base + bodyStart_, bodyLen_);
     ParsePost_();
-    state_ = FINISH;
 }
 
 // 处理路径缺省值
 void HttpRequest::ParsePath_() {
     if(path_ == "/") {
-        path_ = "/index.html"; 
+        path_ = "/index.html";
+    }
+}
+
+// 头部参数："multipart/form-data; boundary=xxx"、"form-data; name=\"a\"; filename=\"b\""
+static StrView HeaderParam(StrView value, StrView name) {
+    size_t i = value.find(';');
+    while(i != StrView::npos) {
+        size_t next = value.find(';', i + 1);
+        StrView param = value.substr(i + 1, next == StrView::npos ? StrView::npos : next - i - 1).Trim();
+        i = next;
+        size_t eq = param.find('=');
+        if(eq == StrView::npos || !param.substr(0, eq).Trim().EqualsIgnoreCase(name)) continue;
+        StrView v = param.substr(eq + 1).Trim();
+        if(v.size() >= 2 && v[0] == '"' && v[v.size() - 1] == '"') {
+            v = v.substr(1, v.size() - 2);
+        }
+        return v;
+    }
+    return StrView();
+}
+
+static int HexValue(char c) {
+    if(c >= '0' && c <= '9') return c - '0';
+    if(c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if(c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// %XX 和 '+' 解码；不合法的 % 原样保留
+static void UrlDecode(StrView in, std::string* out) {
+    out->clear();
+    out->reserve(in.size());
+    for(size_t i = 0; i < in.size(); i++) {
+        char c = in[i];
+        if(c == '+') {
+            c = ' ';
+        } else if(c == '%' && i + 2 < in.size() && HexValue(in[i + 1]) >= 0 && HexValue(in[i + 2]) >= 0) {
+            c = static_cast<char>(HexValue(in[i + 1]) * 16 + HexValue(in[i + 2]));
+            i += 2;
+        }
+        out->push_back(c);
     }
 }
 
+// 表单只在缓冲的 body 上解析：字段值拷进 post_，文件只记视图
 void HttpRequest::ParsePost_() {
-    // 暂时不深入解析 Post 数据
+    if(body_.empty()) return;
+    StrView type = GetHeader(HDR_CONTENT_TYPE);
+    size_t semi = type.find(';');
+    StrView mime = type.substr(0, semi).Trim();
+    if(mime.EqualsIgnoreCase("application/x-www-form-urlencoded")) {
+        ParseUrlencoded_(body_);
+    } else if(mime.EqualsIgnoreCase("multipart/form-data")) {
+        StrView boundary = HeaderParam(type, "boundary");
+        if(!boundary.empty()) ParseMultipart_(body_, boundary);
+    }
+}
+
+// a=1&b=hello+world&c=%E4%BD%A0
+void HttpRequest::ParseUrlencoded_(StrView body) {
+    std::string key;
+    size_t i = 0;
+    while(i < body.size()) {
+        size_t end = body.find('&', i);
+        if(end == StrView::npos) end = body.size();
+        StrView pair = body.substr(i, end - i);
+        i = end + 1;
+        if(pair.empty()) continue;
+        size_t eq = pair.find('=');
+        UrlDecode(pair.substr(0, eq), &key);
+        std::string& value = post_[key];
+        if(eq != StrView::npos) UrlDecode(pair.substr(eq + 1), &value);
+    }
+}
+
+// --boundary\r\n 头部 \r\n\r\n 内容 \r\n--boundary ... --boundary--
+void HttpRequest::ParseMultipart_(StrView body, StrView boundary) {
+    std::string delim = "--";
+    delim.append(boundary.data(), boundary.size());
+    size_t pos = body.find(StrView(delim));
+    if(pos == StrView::npos) return;
+
+    std::string next = "\r\n" + delim;
+    while(true) {
+        pos += delim.size();
+        // "--boundary--" 结束；否则后面跟 \r\n
+        if(body.substr(pos, 2) == "--") return;
+        if(body.substr(pos, 2) != "\r\n") return;
+        pos += 2;
+
+        size_t headEnd = body.find(StrView("\r\n\r\n"), pos);
+        if(headEnd == StrView::npos) return;
+        size_t dataEnd = body.find(StrView(next), headEnd + 4);
+        if(dataEnd == StrView::npos) return;
+
+        StrView name, filename, contentType;
+        StrView heads = body.substr(pos, headEnd - pos);
+        size_t i = 0;
+        while(i <= heads.size()) {
+            size_t end = heads.find('\r', i);
+            if(end == StrView::npos) end = heads.size();
+            StrView line = heads.substr(i, end - i);
+            i = end + 2;
+            size_t colon = line.find(':');
+            if(colon == StrView::npos) continue;
+            StrView key = line.substr(0, colon).Trim();
+            StrView value = line.substr(colon + 1).Trim();
+            if(key.EqualsIgnoreCase("Content-Disposition")) {
+                name = HeaderParam(value, "name");
+                filename = HeaderParam(value, "filename");
+            } else if(key.EqualsIgnoreCase("Content-Type")) {
+                contentType = value;
+            }
+        }
+
+        StrView data = body.substr(headEnd + 4, dataEnd - headEnd - 4);
+        if(!filename.empty()) {
+            files_.push_back(FormFile{name, filename, contentType, data});
+        } else if(!name.empty()) {
+            post_[name.ToString()] = data.ToString();
+        }
+        pos = dataEnd + 2;
+    }
+}
+
+// HTTP/1.1 默认长连接，除非 Connection: close；HTTP/1.0 需要显式 keep-alive
+bool HttpRequest::IsKeepAlive() const {
+    StrView conn = GetHeader(HDR_CONNECTION);
+    if(version_ == "HTTP/1.1") {
+        return !conn.EqualsIgnoreCase("close");
+    }
+    return conn.EqualsIgnoreCase("keep-alive");
+}
+
+StrView HttpRequest::GetHeader(StrView key) const {
+    HeaderId id = HttpHeader::Lookup(key);
+    if(id != HDR_UNKNOWN) {
+        return GetHeader(id);
+    }
+    for(const Header& h : others_) {
+        if(h.key.EqualsIgnoreCase(key)) return h.value;
+    }
+    return StrView();
+}
+
+// 例："bytes=0-499"、"bytes=500-"、"bytes=-500"、"bytes=0-0, -1"
+bool HttpRequest::GetRanges(std::vector<ByteRange>* ranges) const {
+    ranges->clear();
+    StrView value = GetHeader(HDR_RANGE);
+    if(value.size() < 6 || !value.substr(0, 6).EqualsIgnoreCase("bytes=")) return false;
+
+    size_t i = 6;
+    while(i <= value.size()) {
+        size_t end = value.find(',', i);
+        if(end == StrView::npos) end = value.size();
+        StrView spec = value.substr(i, end - i).Trim();
+        i = end + 1;
+        if(spec.empty()) continue;  // "0-1,,2-3" 里的空项
+
+        size_t dash = spec.find('-');
+        if(dash == StrView::npos) return false;
+        StrView first = spec.substr(0, dash), last = spec.substr(dash + 1);
+        if(first.empty() && last.empty()) return false;
+
+        ByteRange r{first.empty() ? -1 : 0, last.empty() ? -1 : 0};
+        for(char c : first) {
+            if(c < '0' || c > '9' || r.first > (1LL << 56)) return false;
+            r.first = r.first * 10 + (c - '0');
+        }
+        for(char c : last) {
+            if(c < '0' || c > '9' || r.last > (1LL << 56)) return false;
+            r.last = r.last * 10 + (c - '0');
+        }
+        if(r.first >= 0 && r.last >= 0 && r.last < r.first) return false;
+        ranges->push_back(r);
+    }
+    return !ranges->empty();
 }
 
-std::string HttpRequest::path() const { return path_; }
-std::string HttpRequest::method() const { return method_; }
-std::string HttpRequest::version() const { return version_; }
 std::string HttpRequest::GetPost(const std::string& key) const {
     if(post_.count(key)) return post_.at(key);
     return "";
@@ -1,7 +1,11 @@
 #include "http/HttpResponse.h"
 #include <iostream>
 #include <cassert> // 【修复 1】必须包含这个头文件才能用 assert
-#include <cstring> // 【修复 2】必须包含这个头文件才能用 memset
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <time.h>
+#include <unistd.h>
 
 const std::unordered_map<std::string, std::string> HttpResponse::SUFFIX_TYPE = {
     { ".html", "text/html" },
@@ -25,21 +29,96 @@ const std::unordered_map<std::string, std::string> HttpResponse::SUFFIX_TYPE = {
     { ".js", "text/javascript "},
 };
 
-const std::unordered_map<int, std::string> HttpResponse::CODE_STATUS = {
-    { 200, "OK" },
-    { 400, "Bad Request" },
-    { 403, "Forbidden" },
-    { 404, "Not Found" },
+// 状态行启动时就拼好，生成响应时整行拷贝
+const std::unordered_map<int, std::string> HttpResponse::STATUS_LINE = {
+    { 101, "HTTP/1.1 101 Switching Protocols\r\n" },
+    { 200, "HTTP/1.1 200 OK\r\n" },
+    { 201, "HTTP/1.1 201 Created\r\n" },
+    { 204, "HTTP/1.1 204 No Content\r\n" },
+    { 206, "HTTP/1.1 206 Partial Content\r\n" },
+    { 304, "HTTP/1.1 304 Not Modified\r\n" },
+    { 400, "HTTP/1.1 400 Bad Request\r\n" },
+    { 403, "HTTP/1.1 403 Forbidden\r\n" },
+    { 404, "HTTP/1.1 404 Not Found\r\n" },
+    { 405, "HTTP/1.1 405 Method Not Allowed\r\n" },
+    { 413, "HTTP/1.1 413 Payload Too Large\r\n" },
+    { 416, "HTTP/1.1 416 Range Not Satisfiable\r\n" },
+    { 426, "HTTP/1.1 426 Upgrade Required\r\n" },
+    { 431, "HTTP/1.1 431 Request Header Fields Too Large\r\n" },
+    { 500, "HTTP/1.1 500 Internal Server Error\r\n" },
+    { 501, "HTTP/1.1 501 Not Implemented\r\n" },
 };
 
+// 几乎每个响应都有的头部片段
+static const char CONN_KEEP_ALIVE[] = "Connection: keep-alive\r\nkeep-alive: max=6, timeout=120\r\n";
+static const char CONN_CLOSE[] = "Connection: close\r\n";
+static const char CACHEABLE[] = "Vary: Accept-Encoding\r\nAccept-Ranges: bytes\r\n";
+static const char CRLF[] = "\r\n";
+
+static const std::string DEFAULT_TYPE = "text/plain";
+
+// 字符串字面量去掉结尾的 '\0'
+template<size_t N>
+static void AppendLiteral(Buffer& buff, const char (&str)[N]) {
+    buff.append(str, N - 1);
+}
+
+// 十进制写进 buf 的末尾，返回起始位置；不经过 std::to_string 的临时 string
+static const char* FormatUInt(char* end, unsigned long long v) {
+    char* p = end;
+    do {
+        *--p = static_cast<char>('0' + v % 10);
+        v /= 10;
+    } while(v);
+    return p;
+}
+
+static void AppendUInt(Buffer& buff, unsigned long long v) {
+    char buf[24];
+    const char* p = FormatUInt(buf + sizeof(buf), v);
+    buff.append(p, buf + sizeof(buf) - p);
+}
+
+static void AppendUInt(std::string& str, unsigned long long v) {
+    char buf[24];
+    const char* p = FormatUInt(buf + sizeof(buf), v);
+    str.append(p, buf + sizeof(buf) - p);
+}
+
+// "Date: ...\r\n" 每个线程缓存一份，秒数变了才重新格式化。
+// 每个 loop 线程 (以及线程池模式下的每个工作线程) 各有一份，不用加锁
+static void AppendDate(Buffer& buff) {
+    static thread_local time_t cachedSec = 0;
+    static thread_local char cached[64];
+    static thread_local size_t cachedLen = 0;
+
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME_COARSE, &now);
+    if(now.tv_sec != cachedSec) {
+        struct tm tm;
+        gmtime_r(&now.tv_sec, &tm);
+        cachedLen = strftime(cached, sizeof(cached), "Date: %a, %d %b %Y %H:%M:%S GMT\r\n", &tm);
+        cachedSec = now.tv_sec;
+    }
+    buff.append(cached, cachedLen);
+}
+
+size_t HttpResponse::sendfileThreshold = 256 * 1024;
+
+// 段数太多的 Range 直接忽略，回整个文件：防止 "bytes=0-0,0-0,..." 放大响应
+static const size_t MAX_RANGES = 16;
+// 大文件的多段 Range 要把每段读进内存拼 multipart，总量超过这个也忽略 Range
+static const size_t MAX_MULTIPART_BYTES = 1024 * 1024;
+
 HttpResponse::HttpResponse() {
     code_ = -1;
     path_ = srcDir_ = "";
     isKeepAlive_ = false;
-    mmFile_ = nullptr; 
-    // 【修复 3】消除 missing initializer 警告
-    // 使用 memset 显式清零，比 {0} 更受严格编译器喜欢
-    memset(&mmFileStat_, 0, sizeof(mmFileStat_));
+    dynamic_ = false;
+    chunked_ = false;
+    acceptEncoding_ = ENC_IDENTITY;
+    bodyOffset_ = 0;
+    bodyLen_ = 0;
 }
 
 HttpResponse::~HttpResponse() {
@@ -48,107 +127,411 @@ HttpResponse::~HttpResponse() {
 
 void HttpResponse::Init(const std::string& srcDir, std::string& path, bool isKeepAlive, int code) {
     assert(srcDir != ""); // 现在有了 <cassert>，这行不会报错了
-    if(mmFile_) { UnmapFile(); }
+    UnmapFile();
     code_ = code;
     isKeepAlive_ = isKeepAlive;
+    dynamic_ = false;
+    acceptEncoding_ = ENC_IDENTITY;
     path_ = path;
     srcDir_ = srcDir;
-    mmFile_ = nullptr; 
-    memset(&mmFileStat_, 0, sizeof(mmFileStat_)); // 【修复 3】
+    ranges_.clear();
+    ifRange_.clear();
+    ifNoneMatch_.clear();
+    ifModifiedSince_.clear();
+    etag_.clear();
+}
+
+void HttpResponse::SetRequest(const HttpRequest& request) {
+    acceptEncoding_ = Compress::ParseAccept(request.GetHeader(HDR_ACCEPT_ENCODING));
+    // 这几个头要留到 MakeResponse 里比较，拷一份 (成员 string 的容量会复用)
+    if(request.GetRanges(&ranges_)) {
+        StrView ifRange = request.GetHeader(HDR_IF_RANGE);
+        ifRange_.assign(ifRange.data(), ifRange.size());
+    }
+    StrView ifNoneMatch = request.GetHeader(HDR_IF_NONE_MATCH);
+    ifNoneMatch_.assign(ifNoneMatch.data(), ifNoneMatch.size());
+    StrView ifModifiedSince = request.GetHeader(HDR_IF_MODIFIED_SINCE);
+    ifModifiedSince_.assign(ifModifiedSince.data(), ifModifiedSince.size());
+}
+
+void HttpResponse::InitDynamic(bool isKeepAlive) {
+    UnmapFile();
+    code_ = 200;
+    isKeepAlive_ = isKeepAlive;
+    dynamic_ = true;
+    chunked_ = false;
+    path_.clear();
+    contentType_ = "application/json";
+    ranges_.clear();
+}
+
+void HttpResponse::AddHeader(StrView key, StrView value) {
+    extraHeaders_.append(key.data(), key.size());
+    extraHeaders_.append(": ", 2);
+    extraHeaders_.append(value.data(), value.size());
+    extraHeaders_.append(CRLF, 2);
 }
 
 void HttpResponse::MakeResponse(Buffer& buff) {
-    if(stat((srcDir_ + path_).data(), &mmFileStat_) < 0 || S_ISDIR(mmFileStat_.st_mode)) {
-        code_ = 404;
+    if(dynamic_) {
+        MakeDynamic_(buff);
+        return;
     }
-    else if(!(mmFileStat_.st_mode & S_IROTH)) {
-        code_ = 403;
+    if(code_ >= 400) {
+        // 请求本身有问题，或者路由没匹配上，不去找文件
     }
-    else if(code_ == -1) { 
-        code_ = 200; 
+    else {
+        FileCache* cache = FileCache::Instance();
+        // 条件请求先只看 stat (缓存里有就连 stat 都不用)：304 的话文件根本不用打开
+        bool conditional = !ifNoneMatch_.empty() || !ifModifiedSince_.empty();
+        file_ = conditional ? cache->Peek(path_) : cache->Get(path_);
+        code_ = StatusOf_(*file_);
+        if(code_ == 200 && conditional && NotModified_()) {
+            code_ = 304;
+        }
+        else if(file_->statOnly) {
+            file_ = cache->Get(path_);
+            code_ = StatusOf_(*file_);
+        }
+    }
+    // Range 按原始字节算，带 Range 的请求不换压缩版本
+    bool ranged = code_ == 200 && !ranges_.empty() && IfRangeMatches_();
+    if(code_ == 200 && !ranged) {
+        // 客户端接受的话换成压缩版本，br 比 gzip 小，优先
+        for(Encoding enc : {ENC_BR, ENC_GZIP}) {
+            if(!(acceptEncoding_ & enc)) continue;
+            FileCache::EntryPtr encoded = FileCache::Instance()->Get(path_, enc);
+            if(encoded->exists) {
+                file_ = encoded;
+                break;
+            }
+        }
     }
 
     ErrorHtml_();
+    if(code_ == 200) {
+        etag_ = file_->etag;
+    }
+    bodyOffset_ = 0;
+    bodyLen_ = code_ != 304 && file_ && file_->HasContent() ? file_->Size() : 0;
+    if(ranged) {
+        ApplyRanges_();
+    }
     AddStateLine_(buff);
     AddHeader_(buff);
+    // 405 的 Allow 这类由分发时加的头
+    buff.append(extraHeaders_);
     AddContent_(buff);
 }
 
-char* HttpResponse::File() {
-    return mmFile_;
+// 动态响应：头部都是现拼的，没有缓存条目可用
+void HttpResponse::MakeDynamic_(Buffer& buff) {
+    if(code_ == 101) {
+        // 协议升级：没有 body，Upgrade 和 Sec-WebSocket-Accept 由 AddHeader 给
+        AddStateLine_(buff);
+        AppendDate(buff);
+        AppendLiteral(buff, "Connection: Upgrade\r\n");
+        buff.append(extraHeaders_);
+        AppendLiteral(buff, CRLF);
+        bodyOffset_ = 0;
+        bodyLen_ = 0;
+        return;
+    }
+    AddStateLine_(buff);
+    AddHeader_(buff);
+    AppendLiteral(buff, "Content-type: ");
+    buff.append(contentType_);
+    AppendLiteral(buff, CRLF);
+    buff.append(extraHeaders_);
+    bodyOffset_ = 0;
+    if(chunked_) {
+        bodyLen_ = 0;
+        AppendLiteral(buff, "Transfer-Encoding: chunked\r\n\r\n");
+        return;
+    }
+    bodyLen_ = code_ == 204 || code_ == 304 ? 0 : dynBody_.size();
+    if(code_ != 204 && code_ != 304) {
+        AppendLiteral(buff, "Content-length: ");
+        AppendUInt(buff, bodyLen_);
+        AppendLiteral(buff, CRLF);
+    }
+    AppendLiteral(buff, CRLF);
 }
 
-size_t HttpResponse::FileLen() const {
-    return mmFileStat_.st_size;
+const char* HttpResponse::File() const {
+    if(dynamic_) {
+        return bodyLen_ > 0 ? dynBody_.data() : nullptr;
+    }
+    if(!multipart_.empty()) {
+        return multipart_.data();
+    }
+    return file_ && !file_->body.empty() && bodyLen_ > 0 ? file_->body.data() + bodyOffset_ : nullptr;
+}
+
+int HttpResponse::StatusOf_(const FileEntry& file) {
+    if(!file.exists || file.IsDir()) {
+        return 404;
+    }
+    if(!file.IsReadable()) {
+        return 403;
+    }
+    return 200;
+}
+
+// If-None-Match 优先；没有它才看 If-Modified-Since (RFC 7232 3.3)
+bool HttpResponse::NotModified_() {
+    if(!ifNoneMatch_.empty()) {
+        if(ifNoneMatch_ == "*") {
+            etag_ = file_->etag;
+            return true;
+        }
+        // 弱比较：去掉 W/ 前缀；客户端手里可能是某个压缩版本的 ETag，只要它还接受这个编码就算命中
+        size_t i = 0;
+        while(i < ifNoneMatch_.size()) {
+            size_t end = ifNoneMatch_.find(',', i);
+            if(end == std::string::npos) end = ifNoneMatch_.size();
+            std::string tag = ifNoneMatch_.substr(i, end - i);
+            i = end + 1;
+            size_t b = tag.find_first_not_of(" \t");
+            if(b == std::string::npos) continue;
+            tag = tag.substr(b, tag.find_last_not_of(" \t") - b + 1);
+            if(tag.compare(0, 2, "W/") == 0) tag.erase(0, 2);
+
+            if(tag == file_->etag) {
+                etag_ = tag;
+                return true;
+            }
+            for(Encoding enc : {ENC_BR, ENC_GZIP}) {
+                if((acceptEncoding_ & enc) && tag == FileCache::ETagOf(file_->etag, enc)) {
+                    etag_ = tag;
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    struct tm tm;
+    memset(&tm, 0, sizeof(tm));
+    if(!strptime(ifModifiedSince_.c_str(), "%a, %d %b %Y %H:%M:%S GMT", &tm)) {
+        return false;
+    }
+    if(file_->st.st_mtime > timegm(&tm)) {
+        return false;
+    }
+    etag_ = file_->etag;
+    return true;
+}
+
+// If-Range 的值和当前文件对不上 (文件已经改过)，就忽略 Range 回整个文件。
+// 这里要求强匹配：弱 ETag 一律不算
+bool HttpResponse::IfRangeMatches_() const {
+    if(ifRange_.empty()) {
+        return true;
+    }
+    if(ifRange_[0] == '"') {
+        return ifRange_ == file_->etag;
+    }
+    return ifRange_ == file_->lastModified;
+}
+
+// 把 Range 落到文件大小上：越界的截断、不可满足的丢掉。
+// 一段 -> 206 + Content-Range；多段 -> 206 + multipart/byteranges；一段都不剩 -> 416
+void HttpResponse::ApplyRanges_() {
+    multipart_.clear();
+    parts_.clear();
+    if(ranges_.size() > MAX_RANGES || !file_->HasContent()) {
+        return;
+    }
+    long long size = static_cast<long long>(file_->Size());
+    for(const ByteRange& r : ranges_) {
+        long long first = r.first, last = r.last;
+        if(first < 0) {
+            // "-N"：最后 N 个字节
+            if(last <= 0) continue;
+            first = last >= size ? 0 : size - last;
+            last = size - 1;
+        } else {
+            if(first >= size) continue;
+            if(last < 0 || last >= size) last = size - 1;
+        }
+        parts_.push_back(std::make_pair(static_cast<size_t>(first), static_cast<size_t>(last)));
+    }
+
+    if(parts_.empty()) {
+        code_ = 416;
+        bodyLen_ = 0;
+        return;
+    }
+    if(parts_.size() == 1) {
+        code_ = 206;
+        bodyOffset_ = parts_[0].first;
+        bodyLen_ = parts_[0].second - parts_[0].first + 1;
+        return;
+    }
+
+    size_t total = 0;
+    for(const auto& part : parts_) {
+        total += part.second - part.first + 1;
+    }
+    if(file_->fd >= 0 && total > MAX_MULTIPART_BYTES) {
+        parts_.clear();
+        return;
+    }
+
+    static std::atomic<unsigned> counter(0);
+    char boundary[32];
+    snprintf(boundary, sizeof(boundary), "%016x%08x", static_cast<unsigned>(time(nullptr)), counter++);
+    boundary_ = boundary;
+    const std::string& type = FileType(path_);
+    for(const auto& part : parts_) {
+        size_t len = part.second - part.first + 1;
+        multipart_ += multipart_.empty() ? "--" : "\r\n--";
+        multipart_ += boundary_;
+        multipart_ += "\r\nContent-type: ";
+        multipart_ += type;
+        multipart_ += "\r\nContent-Range: bytes ";
+        AppendUInt(multipart_, part.first);
+        multipart_ += '-';
+        AppendUInt(multipart_, part.second);
+        multipart_ += '/';
+        AppendUInt(multipart_, size);
+        multipart_ += "\r\n\r\n";
+        if(!file_->body.empty()) {
+            multipart_.append(file_->body, part.first, len);
+            continue;
+        }
+        size_t base = multipart_.size();
+        multipart_.resize(base + len);
+        size_t got = 0;
+        while(got < len) {
+            ssize_t n = pread(file_->fd, &multipart_[base + got], len - got, part.first + got);
+            if(n <= 0) break;
+            got += n;
+        }
+        if(got < len) {
+            // 文件读不全 (被截断了)：放弃 Range，按整个文件回
+            multipart_.clear();
+            parts_.clear();
+            return;
+        }
+    }
+    multipart_ += "\r\n--";
+    multipart_ += boundary_;
+    multipart_ += "--\r\n";
+    code_ = 206;
+    bodyOffset_ = 0;
+    bodyLen_ = multipart_.size();
 }
 
 void HttpResponse::ErrorHtml_() {
     if(code_ == 404) {
         path_ = "/404.html";
-        stat((srcDir_ + path_).data(), &mmFileStat_);
+        file_ = FileCache::Instance()->Get(path_);
     }
     if(code_ == 403) {
         path_ = "/403.html";
-        stat((srcDir_ + path_).data(), &mmFileStat_);
+        file_ = FileCache::Instance()->Get(path_);
     }
 }
 
 void HttpResponse::AddStateLine_(Buffer& buff) {
-    std::string status;
-    if(CODE_STATUS.count(code_) == 1) {
-        status = CODE_STATUS.find(code_)->second;
-    } else {
+    auto it = STATUS_LINE.find(code_);
+    if(it == STATUS_LINE.end()) {
         code_ = 400;
-        status = CODE_STATUS.find(400)->second;
+        it = STATUS_LINE.find(400);
     }
-    buff.append("HTTP/1.1 " + std::to_string(code_) + " " + status + "\r\n");
+    buff.append(it->second);
 }
 
 void HttpResponse::AddHeader_(Buffer& buff) {
-    buff.append("Connection: ");
+    AppendDate(buff);
     if(isKeepAlive_) {
-        buff.append("keep-alive\r\n");
-        buff.append("keep-alive: max=6, timeout=120\r\n");
+        AppendLiteral(buff, CONN_KEEP_ALIVE);
     } else {
-        buff.append("close\r\n");
+        AppendLiteral(buff, CONN_CLOSE);
+    }
+    if(file_ && (code_ == 200 || code_ == 206 || code_ == 304)) {
+        // 同一个 URL 按 Accept-Encoding 可能给出不同的内容，告诉中间缓存分开存
+        AppendLiteral(buff, CACHEABLE);
+        AppendLiteral(buff, "ETag: ");
+        buff.append(etag_);
+        AppendLiteral(buff, "\r\nLast-Modified: ");
+        buff.append(file_->lastModified);
+        AppendLiteral(buff, CRLF);
+    }
+    if(file_ && file_->encoding != ENC_IDENTITY) {
+        AppendLiteral(buff, "Content-Encoding: ");
+        const char* name = Compress::Name(file_->encoding);
+        buff.append(name, strlen(name));
+        AppendLiteral(buff, CRLF);
     }
-    buff.append("Content-type: " + GetFileType_() + "\r\n");
 }
 
 void HttpResponse::AddContent_(Buffer& buff) {
-    int srcFd = open((srcDir_ + path_).data(), O_RDONLY);
-    if(srcFd < 0) { 
-        buff.append("Content-length: 0\r\n\r\n");
-        return; 
+    if(code_ == 304) {
+        // 304 没有 body，也不带 Content-length：头部写完就结束
+        AppendLiteral(buff, CRLF);
+        return;
+    }
+    if(file_ && code_ != 206 && code_ != 416) {
+        // Content-type / Content-length 在加载进缓存时就拼好了 (404 / 403 页面也一样)
+        buff.append(file_->header);
+        return;
     }
 
-    // MAP_PRIVATE 建立私有映射
-    int* mmRet = (int*)mmap(0, mmFileStat_.st_size, PROT_READ, MAP_PRIVATE, srcFd, 0);
-    
-    if(*mmRet == -1) {
-        buff.append("Content-length: 0\r\n\r\n"); 
+    AppendLiteral(buff, "Content-type: ");
+    if(code_ == 206 && !multipart_.empty()) {
+        AppendLiteral(buff, "multipart/byteranges; boundary=");
+        buff.append(boundary_);
     } else {
-        mmFile_ = (char*)mmRet;
-        close(srcFd);
-        buff.append("Content-length: " + std::to_string(mmFileStat_.st_size) + "\r\n\r\n");
+        buff.append(FileType(path_));
+    }
+    AppendLiteral(buff, CRLF);
+
+    if(code_ == 416) {
+        AppendLiteral(buff, "Content-Range: bytes */");
+        AppendUInt(buff, file_->Size());
+        AppendLiteral(buff, CRLF);
+    } else if(code_ == 206 && multipart_.empty()) {
+        AppendLiteral(buff, "Content-Range: bytes ");
+        AppendUInt(buff, bodyOffset_);
+        AppendLiteral(buff, "-");
+        AppendUInt(buff, bodyOffset_ + bodyLen_ - 1);
+        AppendLiteral(buff, "/");
+        AppendUInt(buff, file_->Size());
+        AppendLiteral(buff, CRLF);
     }
+    AppendLiteral(buff, "Content-length: ");
+    AppendUInt(buff, bodyLen_);
+    AppendLiteral(buff, "\r\n\r\n");
 }
 
 void HttpResponse::UnmapFile() {
-    if(mmFile_) {
-        munmap(mmFile_, mmFileStat_.st_size);
-        mmFile_ = nullptr;
-    }
+    file_.reset();
+    multipart_.clear();
+    extraHeaders_.clear();
+    dynBody_.clear();
+    bodyOffset_ = 0;
+    bodyLen_ = 0;
+}
+
+std::string HttpResponse::HttpDate(time_t t) {
+    struct tm tm;
+    gmtime_r(&t, &tm);
+    char buf[64];
+    size_t n = strftime(buf, sizeof(buf), "%a, %d %b %Y %H:%M:%S GMT", &tm);
+    return std::string(buf, n);
 }
 
-std::string HttpResponse::GetFileType_() {
-    std::string::size_type idx = path_.find_last_of('.');
+const std::string& HttpResponse::FileType(const std::string& path) {
+    std::string::size_type idx = path.find_last_of('.');
     if(idx == std::string::npos) {
-        return "text/plain";
+        return DEFAULT_TYPE;
     }
-    std::string suffix = path_.substr(idx);
-    if(SUFFIX_TYPE.count(suffix) == 1) {
-        return SUFFIX_TYPE.find(suffix)->second;
+    auto it = SUFFIX_TYPE.find(path.substr(idx));
+    if(it != SUFFIX_TYPE.end()) {
+        return it->second;
     }
-    return "text/plain";
-}
\ No newline at end of file
+    return DEFAULT_TYPE;
+}
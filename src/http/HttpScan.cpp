@@ -0,0 +1,148 @@
+#include "http/HttpScan.h"
+#include <immintrin.h>
+
+// ---------------- 逐字节 ----------------
+
+static inline bool IsLineEnd(unsigned char c) {
+    return (c < 0x20 && c != '\t') || c == 0x7f;
+}
+
+static inline bool IsNameEnd(unsigned char c) {
+    return c <= 0x20 || c == ':' || c >= 0x7f;
+}
+
+static const char* LineEndScalar(const char* p, const char* end) {
+    for(; p < end; p++) {
+        if(IsLineEnd(static_cast<unsigned char>(*p))) return p;
+    }
+    return end;
+}
+
+static const char* NameEndScalar(const char* p, const char* end) {
+    for(; p < end; p++) {
+        if(IsNameEnd(static_cast<unsigned char>(*p))) return p;
+    }
+    return end;
+}
+
+// ---------------- SSE4.2 ----------------
+// pcmpestri 的 RANGES 模式：一条指令判断 16 个字节是否落在若干个 [lo, hi] 区间里
+
+__attribute__((target("sse4.2")))
+static const char* LineEndSse42(const char* p, const char* end) {
+    // [0x00, 0x08] [0x0a, 0x1f] [0x7f, 0x7f]：跳过 '\t'
+    alignas(16) static const char ranges[16] = "\x00\x08\x0a\x1f\x7f\x7f";
+    const __m128i r = _mm_load_si128(reinterpret_cast<const __m128i*>(ranges));
+    while(end - p >= 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        int idx = _mm_cmpestri(r, 6, v, 16, _SIDD_UBYTE_OPS | _SIDD_CMP_RANGES | _SIDD_LEAST_SIGNIFICANT);
+        if(idx != 16) return p + idx;
+        p += 16;
+    }
+    return LineEndScalar(p, end);
+}
+
+__attribute__((target("sse4.2")))
+static const char* NameEndSse42(const char* p, const char* end) {
+    // [0x00, 0x20] [':', ':'] [0x7f, 0xff]
+    alignas(16) static const char ranges[16] = "\x00\x20::\x7f\xff";
+    const __m128i r = _mm_load_si128(reinterpret_cast<const __m128i*>(ranges));
+    while(end - p >= 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        int idx = _mm_cmpestri(r, 6, v, 16, _SIDD_UBYTE_OPS | _SIDD_CMP_RANGES | _SIDD_LEAST_SIGNIFICANT);
+        if(idx != 16) return p + idx;
+        p += 16;
+    }
+    return NameEndScalar(p, end);
+}
+
+// ---------------- AVX2 ----------------
+// 没有无符号比较指令，用 min_epu8(x, k) == x 表示 x <= k
+
+__attribute__((target("avx2")))
+static const char* LineEndAvx2(const char* p, const char* end) {
+    const __m256i ctlMax = _mm256_set1_epi8(0x1f);
+    const __m256i tab = _mm256_set1_epi8('\t');
+    const __m256i del = _mm256_set1_epi8(0x7f);
+    while(end - p >= 32) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        __m256i ctl = _mm256_cmpeq_epi8(_mm256_min_epu8(v, ctlMax), v);
+        ctl = _mm256_andnot_si256(_mm256_cmpeq_epi8(v, tab), ctl);
+        ctl = _mm256_or_si256(ctl, _mm256_cmpeq_epi8(v, del));
+        unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(ctl));
+        if(mask) return p + __builtin_ctz(mask);
+        p += 32;
+    }
+    return LineEndScalar(p, end);
+}
+
+__attribute__((target("avx2")))
+static const char* NameEndAvx2(const char* p, const char* end) {
+    const __m256i spaceMax = _mm256_set1_epi8(0x20);
+    const __m256i delMin = _mm256_set1_epi8(0x7f);
+    const __m256i colon = _mm256_set1_epi8(':');
+    while(end - p >= 32) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        __m256i low = _mm256_cmpeq_epi8(_mm256_min_epu8(v, spaceMax), v);
+        __m256i high = _mm256_cmpeq_epi8(_mm256_max_epu8(v, delMin), v);
+        __m256i hit = _mm256_or_si256(_mm256_or_si256(low, high), _mm256_cmpeq_epi8(v, colon));
+        unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(hit));
+        if(mask) return p + __builtin_ctz(mask);
+        p += 32;
+    }
+    return NameEndScalar(p, end);
+}
+
+// ---------------- 运行时选择 ----------------
+
+static HttpScan::Impl Detect() {
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2")) return HttpScan::AVX2;
+    if(__builtin_cpu_supports("sse4.2")) return HttpScan::SSE42;
+    return HttpScan::SCALAR;
+}
+
+HttpScan::ScanFn HttpScan::lineEnd_ = LineEndScalar;
+HttpScan::ScanFn HttpScan::nameEnd_ = NameEndScalar;
+HttpScan::Impl HttpScan::current_ = HttpScan::SCALAR;
+
+// 静态初始化时选好实现，之后每次调用只是一次间接跳转
+static const bool detected = HttpScan::Use(Detect());
+
+bool HttpScan::Supported(Impl impl) {
+    __builtin_cpu_init();
+    switch(impl) {
+        case AVX2:  return __builtin_cpu_supports("avx2");
+        case SSE42: return __builtin_cpu_supports("sse4.2");
+        default:    return true;
+    }
+}
+
+bool HttpScan::Use(Impl impl) {
+    (void)detected;
+    if(!Supported(impl)) return false;
+    switch(impl) {
+        case AVX2:
+            lineEnd_ = LineEndAvx2;
+            nameEnd_ = NameEndAvx2;
+            break;
+        case SSE42:
+            lineEnd_ = LineEndSse42;
+            nameEnd_ = NameEndSse42;
+            break;
+        default:
+            lineEnd_ = LineEndScalar;
+            nameEnd_ = NameEndScalar;
+            break;
+    }
+    current_ = impl;
+    return true;
+}
+
+const char* HttpScan::Name(Impl impl) {
+    switch(impl) {
+        case AVX2:  return "avx2";
+        case SSE42: return "sse4.2";
+        default:    return "scalar";
+    }
+}
@@ -0,0 +1,214 @@
+#include "http/Router.h"
+#include "http/WebSocket.h"
+#include <algorithm>
+
+Router* Router::Instance() {
+    static Router router;
+    return &router;
+}
+
+Router::Router() : root_(new Node) {}
+
+Router::~Router() = default;
+
+void Router::Clear() {
+    root_.reset(new Node);
+    routes_.clear();
+}
+
+static size_t CommonPrefix(StrView a, StrView b) {
+    size_t n = std::min(a.size(), b.size()), i = 0;
+    while(i < n && a[i] == b[i]) i++;
+    return i;
+}
+
+// 把一段静态文本插到 node 下面，返回文本结束处的节点。
+// 和已有子节点只有部分公共前缀时，把子节点从分叉处劈成两段
+Router::Node* Router::InsertStatic_(Node* node, StrView text) {
+    while(!text.empty()) {
+        size_t idx = node->indices.find(text[0]);
+        if(idx == std::string::npos) {
+            std::unique_ptr<Node> child(new Node);
+            child->prefix = text.ToString();
+            node->indices.push_back(text[0]);
+            node->children.push_back(std::move(child));
+            return node->children.back().get();
+        }
+
+        Node* child = node->children[idx].get();
+        size_t common = CommonPrefix(child->prefix, text);
+        if(common < child->prefix.size()) {
+            // "/api/users" 遇到 "/api/posts"：劈成 "/api/" -> {"users", "posts"}
+            std::unique_ptr<Node> mid(new Node);
+            mid->prefix = child->prefix.substr(0, common);
+            child->prefix.erase(0, common);
+            mid->indices.push_back(child->prefix[0]);
+            mid->children.push_back(std::move(node->children[idx]));
+            node->children[idx] = std::move(mid);
+            child = node->children[idx].get();
+        }
+        node = child;
+        text = text.substr(common);
+    }
+    return node;
+}
+
+bool Router::Add(const std::string& method, const std::string& pattern, Handler handler) {
+    if(pattern.empty() || pattern[0] != '/') return false;
+
+    Node* node = root_.get();
+    StrView rest(pattern);
+    while(!rest.empty()) {
+        // 静态段一直到下一个 ':' 或 '*'
+        size_t i = 0;
+        while(i < rest.size() && rest[i] != ':' && rest[i] != '*') i++;
+        node = InsertStatic_(node, rest.substr(0, i));
+        rest = rest.substr(i);
+        if(rest.empty()) break;
+
+        bool isCatchAll = rest[0] == '*';
+        size_t end = isCatchAll ? rest.size() : rest.find('/');
+        if(end == StrView::npos) end = rest.size();
+        StrView name = rest.substr(1, end - 1);
+        if(name.empty()) return false;
+        if(isCatchAll && name.find('/') != StrView::npos) return false;
+
+        std::unique_ptr<Node>& slot = isCatchAll ? node->catchAll : node->param;
+        if(!slot) {
+            slot.reset(new Node);
+            slot->name = name.ToString();
+        } else if(slot->name != name) {
+            // 同一个位置只能有一个参数名，否则匹配出来的 key 是哪个说不清
+            return false;
+        }
+        node = slot.get();
+        rest = rest.substr(end);
+    }
+
+    for(size_t idx : node->routes) {
+        if(routes_[idx].method == method) return false;
+    }
+    node->routes.push_back(routes_.size());
+    routes_.push_back(Route{method, pattern, std::move(handler), nullptr, nullptr});
+    return true;
+}
+
+bool Router::WebSocket(const std::string& pattern, WebSocketHandler handler) {
+    if(!Add("GET", pattern, nullptr)) return false;
+    routes_.back().websocket = std::make_shared<const WebSocketHandler>(std::move(handler));
+    return true;
+}
+
+bool Router::Sse(const std::string& pattern, SseHandler handler) {
+    if(!Add("GET", pattern, nullptr)) return false;
+    routes_.back().sse = std::make_shared<const SseHandler>(std::move(handler));
+    return true;
+}
+
+bool Router::Static(const std::string& prefix) {
+    std::string pattern = prefix;
+    if(pattern.empty() || pattern.back() != '/') pattern.push_back('/');
+    pattern += "*path";
+    return Add("*", pattern, nullptr);
+}
+
+static void AppendAllow(std::string* allow, StrView method) {
+    // 几个节点都对上路径时 (静态段、":id" 各有一条) 方法不重复写
+    size_t pos = 0;
+    while(pos < allow->size()) {
+        size_t end = allow->find(',', pos);
+        if(end == std::string::npos) end = allow->size();
+        if(StrView(allow->data() + pos, end - pos) == method) return;
+        pos = end + 2;
+    }
+    if(!allow->empty()) allow->append(", ");
+    allow->append(method.data(), method.size());
+}
+
+const Router::Route* Router::FindMethod_(const Node* node, StrView method, bool anyMethod,
+                                         std::string* allow) const {
+    const Route* any = nullptr;
+    const Route* get = nullptr;
+    for(size_t idx : node->routes) {
+        const Route& r = routes_[idx];
+        if(StrView(r.method) == method) return &r;
+        if(r.method == "*") {
+            any = &r;
+            continue;
+        }
+        AppendAllow(allow, r.method);
+        if(r.method == "GET") {
+            get = &r;
+            AppendAllow(allow, "HEAD");
+        }
+    }
+    if(get && method == "HEAD") return get;
+    return anyMethod ? any : nullptr;
+}
+
+// path 是 node 自己的 prefix 之后剩下的部分
+bool Router::MatchNode_(const Node* node, StrView method, StrView path, RouteParams* params,
+                        const Route** route, bool anyMethod, std::string* allow) const {
+    if(path.empty() && !node->routes.empty() &&
+       (*route = FindMethod_(node, method, anyMethod, allow)) != nullptr) {
+        return true;
+    }
+
+    // 1. 静态子节点：首字母最多对上一个
+    if(!path.empty()) {
+        size_t idx = node->indices.find(path[0]);
+        if(idx != std::string::npos) {
+            const Node* child = node->children[idx].get();
+            if(path.StartsWith(child->prefix) &&
+               MatchNode_(child, method, path.substr(child->prefix.size()), params, route, anyMethod, allow)) {
+                return true;
+            }
+        }
+    }
+
+    // 2. ":name"：吃掉一段，不能为空
+    if(node->param && !path.empty() && path[0] != '/') {
+        size_t end = path.find('/');
+        if(end == StrView::npos) end = path.size();
+        params->Push(node->param->name, path.substr(0, end));
+        if(MatchNode_(node->param.get(), method, path.substr(end), params, route, anyMethod, allow)) {
+            return true;
+        }
+        params->Pop();
+    }
+
+    // 3. "*name"：剩下的全部 (可以为空)
+    if(node->catchAll && !node->catchAll->routes.empty() &&
+       (*route = FindMethod_(node->catchAll.get(), method, anyMethod, allow)) != nullptr) {
+        params->Push(node->catchAll->name, path);
+        return true;
+    }
+    return false;
+}
+
+const Router::Route* Router::Match(StrView method, StrView path, RouteParams* params, MatchResult* result,
+                                   std::string* allow) const {
+    std::string local;
+    if(!allow) allow = &local;
+    allow->clear();
+    params->Clear();
+    const Route* route = nullptr;
+    // 第一遍只认具体方法的路由，顺便记下路径对上的节点有哪些方法
+    if(MatchNode_(root_.get(), method, path, params, &route, false, allow)) {
+        *result = MATCHED;
+        return route;
+    }
+    params->Clear();
+    if(!allow->empty()) {
+        *result = METHOD_NOT_ALLOWED;
+        return nullptr;
+    }
+    // 没有哪条具体路由认这个路径，再让 "*" (静态文件) 接
+    if(MatchNode_(root_.get(), method, path, params, &route, true, allow)) {
+        *result = MATCHED;
+        return route;
+    }
+    params->Clear();
+    *result = NOT_FOUND;
+    return nullptr;
+}
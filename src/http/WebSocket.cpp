@@ -0,0 +1,454 @@
+#include "http/WebSocket.h"
+#include "http/HttpRequest.h"
+#include "http/Router.h"
+#include "http/EventHub.h"
+#include <immintrin.h>
+#include <algorithm>
+#include <cstring>
+
+size_t WebSocket::maxMessageBytes = 1024 * 1024;
+
+static const char GUID[] = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+
+// ---------------- 握手 ----------------
+
+// 逗号分隔的列表里有没有 token (不区分大小写)，例 "keep-alive, Upgrade"
+static bool HasToken(StrView list, StrView token) {
+    size_t pos = 0;
+    while(pos <= list.size()) {
+        size_t comma = list.find(',', pos);
+        if(comma == StrView::npos) comma = list.size();
+        if(list.substr(pos, comma - pos).Trim().EqualsIgnoreCase(token)) return true;
+        pos = comma + 1;
+    }
+    return false;
+}
+
+bool WebSocket::IsUpgrade(const HttpRequest& request) {
+    // key 是 16 字节随机数的 base64，固定 24 个字符
+    return request.method() == "GET" && request.version() == "HTTP/1.1" &&
+           HasToken(request.GetHeader(HDR_UPGRADE), "websocket") &&
+           HasToken(request.GetHeader(HDR_CONNECTION), "upgrade") &&
+           request.GetHeader(HDR_SEC_WEBSOCKET_VERSION).Trim() == "13" &&
+           request.GetHeader(HDR_SEC_WEBSOCKET_KEY).Trim().size() == 24;
+}
+
+static inline uint32_t Rol(uint32_t x, int n) {
+    return (x << n) | (x >> (32 - n));
+}
+
+// 只在握手时算一次，不追求速度
+static void Sha1(const std::string& msg, uint8_t digest[20]) {
+    uint32_t h[5] = {0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0};
+    std::string data = msg;
+    data.push_back(static_cast<char>(0x80));
+    while(data.size() % 64 != 56) data.push_back(0);
+    uint64_t bits = static_cast<uint64_t>(msg.size()) * 8;
+    for(int i = 7; i >= 0; i--) data.push_back(static_cast<char>(bits >> (i * 8)));
+
+    for(size_t off = 0; off < data.size(); off += 64) {
+        const uint8_t* p = reinterpret_cast<const uint8_t*>(data.data()) + off;
+        uint32_t w[80];
+        for(int i = 0; i < 16; i++) {
+            w[i] = static_cast<uint32_t>(p[i * 4]) << 24 | p[i * 4 + 1] << 16 | p[i * 4 + 2] << 8 | p[i * 4 + 3];
+        }
+        for(int i = 16; i < 80; i++) w[i] = Rol(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+
+        uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+        for(int i = 0; i < 80; i++) {
+            uint32_t f, k;
+            if(i < 20)      { f = (b & c) | (~b & d);          k = 0x5A827999; }
+            else if(i < 40) { f = b ^ c ^ d;                   k = 0x6ED9EBA1; }
+            else if(i < 60) { f = (b & c) | (b & d) | (c & d); k = 0x8F1BBCDC; }
+            else            { f = b ^ c ^ d;                   k = 0xCA62C1D6; }
+            uint32_t t = Rol(a, 5) + f + e + k + w[i];
+            e = d; d = c; c = Rol(b, 30); b = a; a = t;
+        }
+        h[0] += a; h[1] += b; h[2] += c; h[3] += d; h[4] += e;
+    }
+    for(int i = 0; i < 20; i++) digest[i] = static_cast<uint8_t>(h[i / 4] >> (24 - (i % 4) * 8));
+}
+
+static std::string Base64(const uint8_t* p, size_t len) {
+    static const char TABLE[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string out;
+    for(size_t i = 0; i < len; i += 3) {
+        uint32_t v = p[i] << 16;
+        if(i + 1 < len) v |= p[i + 1] << 8;
+        if(i + 2 < len) v |= p[i + 2];
+        out.push_back(TABLE[(v >> 18) & 63]);
+        out.push_back(TABLE[(v >> 12) & 63]);
+        out.push_back(i + 1 < len ? TABLE[(v >> 6) & 63] : '=');
+        out.push_back(i + 2 < len ? TABLE[v & 63] : '=');
+    }
+    return out;
+}
+
+std::string WebSocket::AcceptKey(StrView key) {
+    uint8_t digest[20];
+    Sha1(key.Trim().ToString() + GUID, digest);
+    return Base64(digest, sizeof(digest));
+}
+
+// ---------------- 掩码 ----------------
+// 掩码按 4 字节循环，铺成 8 / 16 / 32 字节的整块之后每次异或一整块，
+// 因为块长是 4 的倍数，块与块之间掩码的相位不变
+
+static void UnmaskScalar(char* p, size_t len, const uint8_t* mask) {
+    uint32_t m32;
+    memcpy(&m32, mask, 4);
+    uint64_t m64 = static_cast<uint64_t>(m32) << 32 | m32;
+    size_t i = 0;
+    for(; i + 8 <= len; i += 8) {
+        uint64_t v;
+        memcpy(&v, p + i, 8);
+        v ^= m64;
+        memcpy(p + i, &v, 8);
+    }
+    for(; i < len; i++) p[i] ^= mask[i & 3];
+}
+
+__attribute__((target("sse2")))
+static void UnmaskSse2(char* p, size_t len, const uint8_t* mask) {
+    int32_t m32;
+    memcpy(&m32, mask, 4);
+    const __m128i m = _mm_set1_epi32(m32);
+    size_t i = 0;
+    for(; i + 16 <= len; i += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(p + i), _mm_xor_si128(v, m));
+    }
+    UnmaskScalar(p + i, len - i, mask);
+}
+
+__attribute__((target("avx2")))
+static void UnmaskAvx2(char* p, size_t len, const uint8_t* mask) {
+    int32_t m32;
+    memcpy(&m32, mask, 4);
+    const __m256i m = _mm256_set1_epi32(m32);
+    size_t i = 0;
+    // 一次两个寄存器，大消息上把 load / store 的流水线喂满
+    for(; i + 64 <= len; i += 64) {
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i));
+        __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i + 32));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(p + i), _mm256_xor_si256(a, m));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(p + i + 32), _mm256_xor_si256(b, m));
+    }
+    for(; i + 32 <= len; i += 32) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(p + i), _mm256_xor_si256(v, m));
+    }
+    UnmaskScalar(p + i, len - i, mask);
+}
+
+static bool UnmaskSupported(WebSocket::UnmaskImpl impl) {
+    __builtin_cpu_init();
+    switch(impl) {
+        case WebSocket::UNMASK_AVX2: return __builtin_cpu_supports("avx2");
+        case WebSocket::UNMASK_SSE2: return __builtin_cpu_supports("sse2");
+        default:                     return true;
+    }
+}
+
+WebSocket::UnmaskFn WebSocket::unmask_ = UnmaskScalar;
+WebSocket::UnmaskImpl WebSocket::unmaskImpl_ = WebSocket::UNMASK_SCALAR;
+
+static const bool detected = WebSocket::UseUnmask(UnmaskSupported(WebSocket::UNMASK_AVX2) ?
+                                                  WebSocket::UNMASK_AVX2 : WebSocket::UNMASK_SSE2);
+
+bool WebSocket::UseUnmask(UnmaskImpl impl) {
+    (void)detected;
+    if(!UnmaskSupported(impl)) return false;
+    switch(impl) {
+        case UNMASK_AVX2: unmask_ = UnmaskAvx2; break;
+        case UNMASK_SSE2: unmask_ = UnmaskSse2; break;
+        default:          unmask_ = UnmaskScalar; break;
+    }
+    unmaskImpl_ = impl;
+    return true;
+}
+
+// ---------------- 帧 ----------------
+
+void WebSocket::WriteFrame(Buffer& out, Opcode op, StrView payload, bool fin) {
+    uint8_t head[10];
+    size_t n = 2;
+    size_t len = payload.size();
+    head[0] = static_cast<uint8_t>((fin ? 0x80 : 0) | op);
+    if(len < 126) {
+        head[1] = static_cast<uint8_t>(len);
+    } else if(len <= 0xffff) {
+        head[1] = 126;
+        head[2] = static_cast<uint8_t>(len >> 8);
+        head[3] = static_cast<uint8_t>(len);
+        n = 4;
+    } else {
+        head[1] = 127;
+        for(int i = 0; i < 8; i++) head[2 + i] = static_cast<uint8_t>(static_cast<uint64_t>(len) >> (56 - i * 8));
+        n = 10;
+    }
+    out.append(head, n);
+    if(len > 0) out.append(payload.data(), len);
+}
+
+bool WebSocket::IsUtf8(StrView s) {
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(s.data());
+    const uint8_t* end = p + s.size();
+    while(p < end) {
+        // 大多是 ASCII：8 个字节一起看最高位
+        if(end - p >= 8) {
+            uint64_t v;
+            memcpy(&v, p, 8);
+            if((v & 0x8080808080808080ULL) == 0) {
+                p += 8;
+                continue;
+            }
+        }
+        uint8_t c = *p;
+        if(c < 0x80) {
+            p++;
+            continue;
+        }
+        size_t n;
+        uint8_t lo = 0x80, hi = 0xbf;   // 第二个字节的范围，排除过长编码、代理区和 > U+10FFFF
+        if(c >= 0xc2 && c <= 0xdf) {
+            n = 2;
+        } else if(c >= 0xe0 && c <= 0xef) {
+            n = 3;
+            if(c == 0xe0) lo = 0xa0;
+            if(c == 0xed) hi = 0x9f;
+        } else if(c >= 0xf0 && c <= 0xf4) {
+            n = 4;
+            if(c == 0xf0) lo = 0x90;
+            if(c == 0xf4) hi = 0x8f;
+        } else {
+            return false;
+        }
+        if(static_cast<size_t>(end - p) < n || p[1] < lo || p[1] > hi) return false;
+        for(size_t i = 2; i < n; i++) {
+            if((p[i] & 0xc0) != 0x80) return false;
+        }
+        p += n;
+    }
+    return true;
+}
+
+static bool ValidCloseCode(uint16_t code) {
+    // 1004 / 1005 / 1006 / 1015 是保留的，不能出现在帧里；3000 以上给应用和库用
+    return (code >= 1000 && code <= 1003) || (code >= 1007 && code <= 1014) ||
+           (code >= 3000 && code <= 4999);
+}
+
+// ---------------- 连接 ----------------
+
+WebSocket::WebSocket()
+    : out_(nullptr), closeSent_(false), closeNotified_(false), fragOp_(0),
+      pingDue_(false), pingSent_(false) {}
+
+void WebSocket::Open(std::shared_ptr<const WebSocketHandler> handler, const HttpRequest& request,
+                     const RouteParams& params, Buffer& out, std::shared_ptr<Subscriber> sub) {
+    handler_ = std::move(handler);
+    sub_ = std::move(sub);
+    closeSent_ = false;
+    closeNotified_ = false;
+    fragOp_ = 0;
+    message_.clear();
+    pingDue_ = false;
+    pingSent_ = false;
+    if(handler_->onOpen) {
+        out_ = &out;
+        handler_->onOpen(*this, request, params);
+        out_ = nullptr;
+    }
+}
+
+void WebSocket::Process(Buffer& in, Buffer& out, size_t limit) {
+    out_ = &out;
+    if(pingDue_.exchange(false) && !closeSent_) {
+        WriteFrame(out, PING, StrView());
+        pingSent_ = true;
+    }
+    while(!closeSent_ && out.readableBytes() < limit) {
+        size_t avail = in.readableBytes();
+        if(avail < 2) break;
+        uint8_t* p = reinterpret_cast<uint8_t*>(in.peek());
+        bool fin = p[0] & 0x80;
+        uint8_t op = p[0] & 0x0f;
+        // 没有协商扩展，RSV 必须是 0；客户端发来的帧必须带掩码
+        if((p[0] & 0x70) || !(p[1] & 0x80)) {
+            Fail_(PROTOCOL_ERROR);
+            break;
+        }
+        uint64_t len = p[1] & 0x7f;
+        size_t head = 2;
+        if(len == 126) {
+            if(avail < 4) break;
+            len = static_cast<uint64_t>(p[2]) << 8 | p[3];
+            head = 4;
+        } else if(len == 127) {
+            if(avail < 10) break;
+            len = 0;
+            for(int i = 0; i < 8; i++) len = len << 8 | p[2 + i];
+            head = 10;
+        }
+        if(op >= CLOSE && (len > 125 || !fin)) {
+            // 控制帧不能分片，最长 125
+            Fail_(PROTOCOL_ERROR);
+            break;
+        }
+        // 长度一看就超限的话不等它收完，免得读缓冲区被撑大
+        if(len > maxMessageBytes || (op == CONTINUATION && message_.size() + len > maxMessageBytes)) {
+            Fail_(TOO_BIG);
+            break;
+        }
+        size_t frameLen = head + 4 + static_cast<size_t>(len);
+        if(avail < frameLen) break;
+
+        // 原地去掉掩码，整帧的消息直接把读缓冲区里的这一段交给回调
+        char* payload = reinterpret_cast<char*>(p) + head + 4;
+        Unmask(payload, static_cast<size_t>(len), p + head);
+        pingSent_ = false;
+        bool more = OnFrame_(op, fin, payload, static_cast<size_t>(len));
+        in.retrieve(frameLen);
+        if(!more) break;
+    }
+    if(closeSent_) {
+        // 关闭帧之后的数据没有意义
+        in.retrieveAll();
+    }
+    out_ = nullptr;
+}
+
+bool WebSocket::OnFrame_(uint8_t op, bool fin, char* payload, size_t len) {
+    switch(op) {
+        case CONTINUATION:
+            if(fragOp_ == 0) {
+                Fail_(PROTOCOL_ERROR);
+                return false;
+            }
+            message_.append(payload, len);
+            if(fin) {
+                bool binary = fragOp_ == BINARY;
+                fragOp_ = 0;
+                Deliver_(StrView(message_), binary);
+                message_.clear();
+            }
+            break;
+        case TEXT:
+        case BINARY:
+            if(fragOp_ != 0) {
+                // 上一条分片消息还没结束
+                Fail_(PROTOCOL_ERROR);
+                return false;
+            }
+            if(!fin) {
+                fragOp_ = op;
+                message_.assign(payload, len);
+                break;
+            }
+            Deliver_(StrView(payload, len), op == BINARY);
+            break;
+        case PING:
+            WriteFrame(*out_, PONG, StrView(payload, len));
+            break;
+        case PONG:
+            break;
+        case CLOSE: {
+            uint16_t code = NO_STATUS;
+            if(len == 1) {
+                Fail_(PROTOCOL_ERROR);
+                return false;
+            }
+            if(len >= 2) {
+                code = static_cast<uint16_t>(static_cast<uint8_t>(payload[0]) << 8 | static_cast<uint8_t>(payload[1]));
+                if(!ValidCloseCode(code)) {
+                    Fail_(PROTOCOL_ERROR);
+                    return false;
+                }
+                if(!IsUtf8(StrView(payload + 2, len - 2))) {
+                    Fail_(INVALID_DATA);
+                    return false;
+                }
+            }
+            // 回一个关闭帧 (带上对方的状态码)，发完就关 TCP
+            WriteFrame(*out_, CLOSE, StrView(payload, len >= 2 ? 2 : 0));
+            closeSent_ = true;
+            Notify_(code);
+            return false;
+        }
+        default:
+            Fail_(PROTOCOL_ERROR);
+            return false;
+    }
+    return !closeSent_;
+}
+
+void WebSocket::Deliver_(StrView data, bool binary) {
+    if(!binary && !IsUtf8(data)) {
+        Fail_(INVALID_DATA);
+        return;
+    }
+    if(handler_->onMessage) {
+        handler_->onMessage(*this, data, binary);
+    }
+}
+
+void WebSocket::Send(StrView data, bool binary) {
+    if(!out_ || closeSent_) return;
+    WriteFrame(*out_, binary ? BINARY : TEXT, data);
+}
+
+void WebSocket::Close(uint16_t code, StrView reason) {
+    if(!out_ || closeSent_) return;
+    std::string payload;
+    payload.push_back(static_cast<char>(code >> 8));
+    payload.push_back(static_cast<char>(code));
+    // 控制帧最长 125 字节
+    payload.append(reason.data(), std::min<size_t>(reason.size(), 123));
+    WriteFrame(*out_, CLOSE, payload);
+    closeSent_ = true;
+    Notify_(code);
+}
+
+void WebSocket::Subscribe(StrView channel) {
+    if(sub_) sub_->Subscribe(channel);
+}
+
+void WebSocket::Unsubscribe(StrView channel) {
+    if(sub_) sub_->Unsubscribe(channel);
+}
+
+void WebSocket::Shutdown(Buffer& out, uint16_t code) {
+    out_ = &out;
+    Close(code);
+    out_ = nullptr;
+}
+
+void WebSocket::Fail_(uint16_t code) {
+    Close(code);
+}
+
+void WebSocket::Notify_(uint16_t code) {
+    if(closeNotified_) return;
+    closeNotified_ = true;
+    if(handler_ && handler_->onClose) {
+        handler_->onClose(*this, code);
+    }
+}
+
+void WebSocket::Disconnect() {
+    if(handler_) {
+        Notify_(ABNORMAL);
+        handler_.reset();
+    }
+    sub_.reset();
+}
+
+bool WebSocket::KeepAliveTick() {
+    if(pingSent_) {
+        // 整整一个超时周期对端什么都没发，连 pong 都没有
+        return false;
+    }
+    pingDue_ = true;
+    return true;
+}
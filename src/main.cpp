@@ -1,196 +1,184 @@
-#include "Socket.h"
-#include "Epoller.h"
-#include "Buffer.h"
-#include "http/HttpRequest.h"
+#include "EventLoop.h"
+#include "http/HttpConn.h"
 #include "http/HttpResponse.h"
+#include "http/FileCache.h"
+#include "http/Router.h"
+#include "http/WebSocket.h"
+#include "http/EventHub.h"
+#include "BufferBudget.h"
+#include <string.h>
 #include "ThreadPool.h"
 #include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
 #include <unistd.h>
-#include <fcntl.h>
-#include <sys/uio.h>
-#include <arpa/inet.h>
+#include <stdlib.h>
+#include <signal.h>
 #include "../include/log.h"
-#include "../include/heaptimer.h"
-#include <functional>
 
-// --- 全局变量 ---
-HeapTimer timer_manager;
-int epollfd = 0; // 全局 epollfd，供 CloseConn 使用
-
-// --- 回调函数：超时关闭连接 ---
-void CloseConn(int fd)
+// 用法: ./server [-p 端口] [-t 线程池大小] [-l 子 Reactor 数量] [-r] [-b epoll|uring] [-w 高水位字节数] [-s sendfile 阈值] [-c 缓存字节数] [-z] [-m body 字节数] [-i 空闲毫秒数]
+//            [-k 毫秒数] [-M 字节数] [-C 字节数] [-q 任务数]
+//   -l 0 (默认)：单 Reactor + 线程池
+//   -l N       ：1 个主 Reactor 负责 accept，N 个子 Reactor 各自处理自己的连接
+//   -l N -r    ：N 个 Reactor 各自持有 SO_REUSEPORT 监听 socket，没有主 Reactor
+//   -b uring   ：I/O 后端换成 io_uring (内核不支持时自动回退 epoll)
+//   -w bytes   ：单个连接待发送数据超过该值时暂停读取新请求 (默认 1MB)
+//   -s bytes   ：不小于该大小的文件走 sendfile 零拷贝，小文件仍然 mmap (默认 256KB)
+//   -c bytes   ：静态文件缓存的容量，0 表示不缓存 (默认 64MB)
+//   -z         ：没有预压缩的 .gz/.br 文件时，把文本文件现场压缩一次并缓存
+//   -m bytes   ：请求 body 的上限，超过回 413 (默认 8MB)
+//   -i ms      ：连接空闲超时 (默认 60s)。WebSocket 连接到时先发 ping，再过一个周期还没动静才关
+//   -k ms      ：连接空闲这么久就把读写缓冲区还掉，0 表示不还 (默认 10s)
+//   -M bytes   ：所有连接缓冲区加起来的预算，超了以后继续涨的连接被断开 (默认不限)
+//   -C bytes   ：单个连接缓冲区的上限 (默认不限)
+//   -q tasks   ：线程池最多排多少个任务，排满了 loop 线程自己处理事件 (默认 4096)
+int main(int argc, char* argv[])
 {
-    // 1. 从 epoll 中删除
-    epoll_ctl(epollfd, EPOLL_CTL_DEL, fd, 0);
-    // 2. 关闭 socket
-    close(fd);
-    LOG_INFO("Client[%d] timeout, closed!", fd);
-}
-
-// 设置非阻塞
-void setNonBlocking(int fd)
-{
-    int opts = fcntl(fd, F_GETFL);
-    fcntl(fd, F_SETFL, opts | O_NONBLOCK);
-}
-
-// --- 业务逻辑 (子线程运行) ---
-void process(int fd, std::string srcDir, Epoller *epoller)
-{
-    Buffer buff;
-    int saveErrno = 0;
-
-    // 1. 读取数据 (ET模式一次性读完)
-    ssize_t len = buff.readFd(fd, &saveErrno);
-
-    if (len > 0)
-    {
-        // 2. 解析 HTTP 请求
-        HttpRequest request;
-        if (request.parse(buff))
-        {
-            HttpResponse response;
-            std::string path = request.path();
-            response.Init(srcDir, path, false, 200);
-
-            Buffer writeBuff;
-            response.MakeResponse(writeBuff);
-
-            struct iovec iov[2];
-            iov[0].iov_base = const_cast<char *>(writeBuff.peek());
-            iov[0].iov_len = writeBuff.readableBytes();
-
-            if (response.File() && response.FileLen() > 0)
-            {
-                iov[1].iov_base = response.File();
-                iov[1].iov_len = response.FileLen();
-            }
-            else
-            {
-                iov[1].iov_base = nullptr;
-                iov[1].iov_len = 0;
-            }
-            // 发送响应
-            writev(fd, iov, 2);
-        }
-    }
-    else if (len == 0)
-    {
-        CloseConn(fd); // 对端关闭
-        return;
-    }
-    else
-    {
-        if (saveErrno != EAGAIN && saveErrno != EWOULDBLOCK)
-        {
-            CloseConn(fd); // 出错关闭
-            return;
+    int port = 8080;
+    int threadNum = 6;
+    int loopNum = 0;
+    bool reusePort = false;
+    EventLoop::Backend backend = EventLoop::EPOLL;
+    size_t cacheBytes = 64 * 1024 * 1024;
+    int idleMs = 60000;
+    size_t budgetBytes = 0;
+    size_t connBytes = 0;
+    size_t queueTasks = 4096;
+
+    int opt;
+    while((opt = getopt(argc, argv, "p:t:l:rb:w:s:c:zm:i:k:M:C:q:")) != -1) {
+        switch(opt) {
+            case 'p': port = atoi(optarg); break;
+            case 't': threadNum = atoi(optarg); break;
+            case 'l':
+                loopNum = atoi(optarg);
+                if(loopNum < 0) loopNum = std::thread::hardware_concurrency();
+                break;
+            case 'r': reusePort = true; break;
+            case 'b': backend = strcmp(optarg, "uring") == 0 ? EventLoop::URING : EventLoop::EPOLL; break;
+            case 'w': HttpConn::highWaterMark = strtoul(optarg, nullptr, 10); break;
+            case 's': HttpResponse::sendfileThreshold = strtoul(optarg, nullptr, 10); break;
+            case 'c': cacheBytes = strtoul(optarg, nullptr, 10); break;
+            case 'z': FileCache::compressText = true; break;
+            case 'm': HttpRequest::maxBodyBytes = strtoul(optarg, nullptr, 10); break;
+            case 'i': idleMs = atoi(optarg); break;
+            case 'k': HttpConn::idleReleaseMs = atoi(optarg); break;
+            case 'M': budgetBytes = strtoul(optarg, nullptr, 10); break;
+            case 'C': connBytes = strtoul(optarg, nullptr, 10); break;
+            case 'q': queueTasks = strtoul(optarg, nullptr, 10); break;
+            default:
+                std::cerr << "Usage: " << argv[0] << " [-p port] [-t threads] [-l loops] [-r] [-b epoll|uring] [-w bytes] [-s bytes] [-c bytes] [-z] [-m bytes] [-i ms] [-k ms] [-M bytes] [-C bytes] [-q tasks]" << std::endl;
+                return 1;
         }
     }
 
-    // 重置 ONESHOT，让主线程能再次检测到该 fd
-    epoller->ModFd(fd, EPOLLIN | EPOLLET | EPOLLONESHOT);
-}
+    BufferBudget::Instance()->SetLimit(budgetBytes, connBytes);
+
+    // 对端关闭后继续写会触发 SIGPIPE，默认动作是杀掉进程
+    signal(SIGPIPE, SIG_IGN);
 
-int main()
-{
     // 1. 初始化日志
     // 异步日志，队列容量1024
     Log::get_instance()->init("ServerLog", 0, 2000, 800000, 1024);
-    
-    int port = 8080;
+
     char cwd[256];
     getcwd(cwd, 256);
-    std::string srcDir = std::string(cwd) + "/resources";
-
-    // 2. 初始化线程池
-    ThreadPool threadpool(6);
-
-    // 3. 初始化 Socket
-    Socket servSock;
-    servSock.SetReuseAddr();
-    servSock.Bind(port);
-    servSock.Listen();
-    servSock.SetNonBlocking();
-
-    // 4. 初始化 Epoll
-    Epoller epoller;
-    epollfd = epoller.GetFd(); // 【注意】确保你的 Epoller 类有 GetFd() 方法，如果没有，请看下面注释
-    // 如果 Epoller 没有 GetFd()，你需要去 Epoller.h 加一行: int GetFd() { return epollFd_; }
-
-    epoller.AddFd(servSock.Fd(), EPOLLIN | EPOLLET);
+    HttpConn::srcDir = std::string(cwd) + "/resources";
+    FileCache::Instance()->Init(HttpConn::srcDir, cacheBytes);
+
+    // 单 Reactor 模式才有线程池，/api/status 要看它，所以先声明
+    std::unique_ptr<ThreadPool> threadpool;
+
+    // 路由在事件循环启动前注册好，之后只读。没有匹配上 API 的请求都当静态文件
+    Router* router = Router::Instance();
+    router->Get("/api/status", [&threadpool](const HttpRequest&, const RouteParams&, HttpResponse& response) {
+        std::string& body = response.Body();
+        body = "{\"connections\":";
+        body += std::to_string(HttpConn::userCount.load());
+        body += ",\"cacheBytes\":";
+        body += std::to_string(FileCache::Instance()->Bytes());
+        BufferBudget* budget = BufferBudget::Instance();
+        body += ",\"bufferBytes\":";
+        body += std::to_string(budget->Used());
+        body += ",\"bufferPeak\":";
+        body += std::to_string(budget->Peak());
+        body += ",\"bufferRejected\":";
+        body += std::to_string(budget->Rejected());
+        body += ",\"idleReleases\":";
+        body += std::to_string(budget->Releases());
+        body += ",\"poolQueued\":";
+        body += std::to_string(threadpool ? threadpool->Queued() : 0);
+        body += ",\"poolRejected\":";
+        body += std::to_string(threadpool ? threadpool->Rejected() : 0);
+        body += "}";
+    });
+    // WebSocket 回显：文本原样回文本，二进制原样回二进制
+    router->WebSocket("/ws/echo", WebSocketHandler{
+        nullptr,
+        [](WebSocket& ws, StrView data, bool binary) { ws.Send(data, binary); },
+        nullptr,
+    });
+    // 广播：GET /events/news 订阅 (SSE)，POST /api/publish/news 把 body 推给所有订阅者
+    router->Sse("/events/:channel", [](const HttpRequest&, const RouteParams& params, EventStream& stream) {
+        stream.Subscribe(params.Get("channel"));
+    });
+    router->Post("/api/publish/:channel", [](const HttpRequest& request, const RouteParams& params,
+                                             HttpResponse& response) {
+        size_t n = EventHub::Instance()->Publish(params.Get("channel"), request.body());
+        response.Body() = "{\"subscribers\":" + std::to_string(n) + "}";
+    });
+    // 聊天室：WebSocket 连接订阅 "chat"，收到的文本消息广播给所有人 (包括 SSE 的 /events/chat)
+    router->WebSocket("/ws/chat", WebSocketHandler{
+        [](WebSocket& ws, const HttpRequest&, const RouteParams&) { ws.Subscribe("chat"); },
+        [](WebSocket&, StrView data, bool binary) {
+            if(!binary) EventHub::Instance()->Publish("chat", data);
+        },
+        nullptr,
+    });
+    router->Static("/");
 
     LOG_INFO(">> Server running on http://localhost:%d", port);
     std::cout << ">> Server running on http://localhost:" << port << std::endl;
 
-    // 定义 epoll_wait 需要的数组
-    const int MAX_EVENT_NUMBER = 10000;
-    struct epoll_event events[MAX_EVENT_NUMBER];
-
-    while (true)
-    {
-        // 5. 获取最近的超时时间
-        int time_ms = timer_manager.getNextTick();
-        
-        // 阻塞等待事件
-        int number = epoll_wait(epollfd, events, MAX_EVENT_NUMBER, time_ms);
+    if(loopNum == 0) {
+        // 2. 单 Reactor：主线程 epoll，业务交给线程池 (io_uring 后端不使用线程池)
+        if(backend == EventLoop::EPOLL) {
+            threadpool.reset(new ThreadPool(threadNum, queueTasks));
+        }
+        std::unique_ptr<EventLoop> loop = EventLoop::Create(backend, threadpool.get(), idleMs);
+        loop->Listen(port);
+        loop->Loop();
+        return 0;
+    }
 
-        if (number < 0 && errno != EINTR) {
-            LOG_ERROR("Epoll wait failure");
-            break;
+    // 3. 多 Reactor：one loop per thread
+    std::vector<std::unique_ptr<EventLoop>> subLoops;
+    std::vector<EventLoop*> loopPtrs;
+    for(int i = 0; i < loopNum; i++) {
+        subLoops.push_back(EventLoop::Create(backend, nullptr, idleMs));
+        if(reusePort) {
+            subLoops.back()->Listen(port, true);
         }
+        loopPtrs.push_back(subLoops.back().get());
+    }
+    LOG_INFO("Multi-reactor mode: %d loops, reuseport=%d", loopNum, reusePort);
 
-        for (int i = 0; i < number; i++)
-        {
-            int sockfd = events[i].data.fd;
+    std::vector<std::thread> threads;
+    for(EventLoop* loop : loopPtrs) {
+        threads.emplace_back(&EventLoop::Loop, loop);
+    }
 
-            // A. 处理新连接
-            if (sockfd == servSock.Fd())
-            {
-                struct sockaddr_in client_address;
-                socklen_t client_addrlength = sizeof(client_address);
-                int connfd = accept(servSock.Fd(), (struct sockaddr *)&client_address, &client_addrlength);
-                
-                if (connfd < 0) continue;
+    if(!reusePort) {
+        // 主 Reactor 只负责 accept，然后轮询分发给子 Reactor
+        std::unique_ptr<EventLoop> mainLoop = EventLoop::Create(backend, nullptr, idleMs);
+        mainLoop->Listen(port);
+        mainLoop->SetSubLoops(loopPtrs);
+        mainLoop->Loop();
+    }
 
-                setNonBlocking(connfd);
-                
-                // 添加到 epoll 监控
-                epoller.AddFd(connfd, EPOLLIN | EPOLLET | EPOLLONESHOT);
-                
-                // 【新增】添加定时器 (60秒)
-                timer_manager.add(connfd, 60000, std::bind(CloseConn, connfd));
-                LOG_INFO("New client[%d] connected", connfd);
-            }
-            
-            // B. 处理异常断开
-            else if (events[i].events & (EPOLLRDHUP | EPOLLHUP | EPOLLERR))
-            {
-                timer_manager.doWork(sockfd); // 移除定时器并关闭
-            }
-            
-            // C. 处理读事件
-            else if (events[i].events & EPOLLIN)
-            {
-                // 【重要】主线程只负责“续命”和“分发”
-                // 1. 只要有活动，就更新定时器 (往后延60秒)
-                timer_manager.add(sockfd, 60000, std::bind(CloseConn, sockfd));
-                
-                // 2. 交给线程池去处理具体的读写业务
-                threadpool.AddTask(std::bind(process, sockfd, srcDir, &epoller));
-            }
-            
-            // D. 处理写事件
-            else if (events[i].events & EPOLLOUT)
-            {
-                 // 也是续命 + 分发（这里简单起见，写逻辑通常也在 process 里或者单独函数）
-                 timer_manager.add(sockfd, 60000, std::bind(CloseConn, sockfd));
-                 // 这里暂不处理写事件的分发，通常 WebServer 是读完直接写的
-            }
-        }
-        
-        // 6. 处理超时连接
-        timer_manager.tick();
+    for(std::thread& t : threads) {
+        t.join();
     }
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,14 @@
+#ifndef TESTS_CHECK_H
+#define TESTS_CHECK_H
+
+#include <cstdio>
+
+// 各个测试程序共用：条件不成立时打印位置和表达式、记一次失败，接着往下跑。
+// main 最后按 failures 打印 "OK (0 failures)" 并决定退出码
+static int failures = 0;
+
+#define CHECK(cond) do { \
+    if(!(cond)) { printf("[FAIL] %s:%d  %s\n", __FILE__, __LINE__, #cond); failures++; } \
+} while(0)
+
+#endif // TESTS_CHECK_H
@@ -0,0 +1,208 @@
+// tests/test_budget.cpp
+// 1. Buffer::shrink 之后容量刚好放下可读数据，收缩到 0 以后还能照常读写
+// 2. BufferBudget 记账：总预算 / 单连接上限、峰值、失败计数，收缩总是成功
+// 3. 多线程同时报账，最后账目归零
+// 4. 读之前按预算封顶：Headroom、ensureWritable / readFd 扩容不超过上限 (栈上 64KB 的 extrabuf 也不能撑大缓冲区)，
+//    流水线请求的总量超过单连接上限时读满就停、处理掉再读，全部读完也不超预算
+#include "../include/Buffer.h"
+#include "../include/BufferBudget.h"
+#include "check.h"
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+static void TestShrink() {
+    Buffer buff;
+    std::string big(100000, 'x');
+    buff.append(big);
+    CHECK(buff.capacity() >= big.size());
+    buff.retrieve(big.size() - 10);
+
+    // 只留可读的 10 字节 + 预留
+    buff.shrink(6);
+    CHECK(buff.capacity() == 16 && buff.readableBytes() == 10);
+    CHECK(buff.retrieveAllToStr() == std::string(10, 'x'));
+
+    // 收缩到 0：不能解引用空 vector，下次追加按需分配
+    buff.shrink();
+    CHECK(buff.capacity() == 0 && buff.readableBytes() == 0);
+    buff.append("hello", 5);
+    CHECK(buff.capacity() >= 5 && buff.retrieveAllToStr() == "hello");
+}
+
+static void TestCharge() {
+    BufferBudget budget;
+    budget.SetLimit(1000, 600);
+
+    CHECK(budget.Charge(0, 500));
+    CHECK(budget.Used() == 500 && budget.Peak() == 500);
+    // 单连接超过上限：账照样记上
+    CHECK(!budget.Charge(500, 700));
+    CHECK(budget.Used() == 700 && budget.Rejected() == 1);
+    CHECK(budget.Charge(700, 100));
+    CHECK(budget.Used() == 100 && budget.Peak() == 700);
+
+    // 总量超预算
+    CHECK(budget.Charge(0, 500));
+    CHECK(budget.Charge(0, 400));
+    CHECK(!budget.Charge(0, 200));
+    CHECK(budget.Used() == 1200 && budget.Rejected() == 2);
+    // 变小总是成功，哪怕还在预算外
+    CHECK(budget.Charge(500, 450));
+    CHECK(budget.Charge(450, 0) && budget.Charge(400, 0) && budget.Charge(200, 0) && budget.Charge(100, 0));
+    CHECK(budget.Used() == 0 && budget.Peak() == 1200);
+
+    budget.CountRelease(4096);
+    budget.CountRelease(1024);
+    CHECK(budget.Releases() == 2 && budget.ReleasedBytes() == 5120);
+
+    // 0 表示不限
+    BufferBudget unlimited;
+    CHECK(unlimited.Charge(0, size_t(1) << 40) && unlimited.Rejected() == 0);
+}
+
+static void TestThreads() {
+    BufferBudget budget;
+    const int kThreads = 8, kRounds = 100000;
+    std::vector<std::thread> threads;
+    for(int t = 0; t < kThreads; t++) {
+        threads.emplace_back([&budget, t]() {
+            size_t charged = 0;
+            for(int i = 0; i < kRounds; i++) {
+                size_t next = static_cast<size_t>((i * 7919 + t) % 65536);
+                budget.Charge(charged, next);
+                charged = next;
+            }
+            budget.Charge(charged, 0);
+        });
+    }
+    for(std::thread& th : threads) th.join();
+    CHECK(budget.Used() == 0);
+    CHECK(budget.Peak() <= size_t(kThreads) * 65536);
+}
+
+static void TestHeadroom() {
+    BufferBudget budget;
+    budget.SetLimit(1000, 600);
+    CHECK(budget.Headroom(0) == 600);
+    CHECK(budget.Charge(0, 500));
+    CHECK(budget.Headroom(500) == 100);
+    // 另一个连接把总预算占得差不多了：剩下的按总预算算
+    CHECK(budget.Charge(0, 450));
+    CHECK(budget.Headroom(0) == 50 && budget.Headroom(500) == 50);
+    CHECK(!budget.Charge(450, 700));
+    CHECK(budget.Headroom(500) == 0);
+    budget.Charge(700, 0);
+    budget.Charge(500, 0);
+
+    BufferBudget unlimited;
+    CHECK(unlimited.Headroom(size_t(1) << 40) == SIZE_MAX);
+
+    // 扩容不超过 maxCapacity，但至少放得下要写的
+    Buffer buff(100);
+    buff.append(std::string(100, 'x'));
+    buff.ensureWritable(50, 160);
+    CHECK(buff.capacity() == 160 && buff.readableBytes() == 100);
+    buff.ensureWritable(500, 160);
+    CHECK(buff.capacity() == 600);
+    // 前面读走的空间够用：挪一下，不扩
+    buff.retrieve(100);
+    buff.append(std::string(500, 'y'));
+    buff.retrieve(400);
+    buff.ensureWritable(450, 600);
+    CHECK(buff.capacity() == 600 && buff.readableBytes() == 100);
+}
+
+static void TestCappedRead() {
+    int fds[2];
+    CHECK(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+    fcntl(fds[0], F_SETFL, O_NONBLOCK);
+    int size = 256 * 1024;
+    setsockopt(fds[0], SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+    setsockopt(fds[1], SOL_SOCKET, SO_SNDBUF, &size, sizeof(size));
+
+    // 不封顶：1KB 的缓冲区一次读进 1KB + 64KB，容量跟着涨
+    std::string burst(100 * 1024, 'a');
+    CHECK(write(fds[1], burst.data(), burst.size()) == static_cast<ssize_t>(burst.size()));
+    int err = 0;
+    Buffer loose(1024);
+    CHECK(loose.readFd(fds[0], &err) == 1024 + 65536);
+    CHECK(loose.capacity() >= 1024 + 65536);
+
+    // 封顶 8KB：读 8KB，容量正好 8KB
+    Buffer capped(1024);
+    CHECK(capped.readFd(fds[0], &err, 8192) == 8192);
+    CHECK(capped.capacity() == 8192);
+    // 读走一部分以后再读：只用腾出来的空间，不扩
+    capped.retrieve(3000);
+    CHECK(capped.readFd(fds[0], &err, 3000) == 3000);
+    CHECK(capped.capacity() == 8192 && capped.readableBytes() == 8192);
+    // 排空
+    char sink[65536];
+    while(read(fds[0], sink, sizeof(sink)) > 0) {}
+
+    // 流水线：200 个 500 字节的请求 (100KB) 一口气到达，单连接上限 8KB。
+    // 和 HttpConn::read 一样每次读之前问还能放多少，放满了先 "处理" 掉完整的请求再读
+    const size_t kReq = 500, kCount = 200;
+    std::string requests;
+    for(size_t i = 0; i < kCount; i++) {
+        std::string one = "GET /" + std::to_string(i) + " HTTP/1.1\r\n";
+        one.append(kReq - one.size() - 2, 'h');
+        requests += one + "\r\n";
+    }
+    CHECK(write(fds[1], requests.data(), requests.size()) == static_cast<ssize_t>(requests.size()));
+    close(fds[1]);
+
+    BufferBudget budget;
+    budget.SetLimit(0, 8192);
+    Buffer in(1024);
+    size_t charged = in.capacity();
+    budget.Charge(0, charged);
+    size_t parsed = 0, pauses = 0;
+    bool tooBig = false;
+    while(true) {
+        size_t room = in.writableBytes() + in.prependableBytes() + budget.Headroom(charged);
+        if(room > 0) {
+            ssize_t n = in.readFd(fds[0], &err, room);
+            CHECK(budget.Charge(charged, in.capacity()));
+            charged = in.capacity();
+            if(n <= 0) {
+                break;
+            }
+            continue;
+        }
+        pauses++;
+        size_t before = parsed;
+        while(in.readableBytes() >= kReq) {
+            CHECK(memcmp(in.peek(), "GET /", 5) == 0);
+            in.retrieve(kReq);
+            parsed++;
+        }
+        if(parsed == before) {
+            tooBig = true;
+            break;
+        }
+    }
+    parsed += in.readableBytes() / kReq;
+    CHECK(!tooBig && parsed == kCount && pauses > 0);
+    CHECK(in.capacity() <= 8192 && budget.Peak() <= 8192 && budget.Rejected() == 0);
+    close(fds[0]);
+}
+
+int main() {
+    TestShrink();
+    TestCharge();
+    TestThreads();
+    TestHeadroom();
+    TestCappedRead();
+
+    printf("%s (%d failures)\n", failures ? "FAILED" : "OK", failures);
+    return failures ? 1 : 0;
+}
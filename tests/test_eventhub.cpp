@@ -0,0 +1,210 @@
+// tests/test_eventhub.cpp
+// 1. SSE 事件的编码：多行 data、event / id 里的换行、chunk 长度
+// 2. 扇出：同一条消息所有订阅者共用一份，唤醒按事件循环合并，没来取之前不重复唤醒
+// 3. 退订 / Detach 之后的下标维护，积压超限，多线程同时发布和订阅
+// 4. 一万个订阅者的扇出耗时
+#include "../include/http/EventHub.h"
+#include "check.h"
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+// 代替事件循环：只记下被唤醒的次数和订阅者
+class FakeTarget : public PushTarget {
+public:
+    void Push(std::vector<std::shared_ptr<Subscriber>> subs) override {
+        pushes++;
+        woken.insert(woken.end(), subs.begin(), subs.end());
+    }
+    int pushes = 0;
+    std::vector<std::shared_ptr<Subscriber>> woken;
+};
+
+static std::string Sse(StrView data, StrView event = StrView(), StrView id = StrView()) {
+    Buffer buff;
+    EventHub::AppendSse(buff, data, event, id);
+    return buff.retrieveAllToStr();
+}
+
+static void TestFormat() {
+    CHECK(Sse("hi") == "a\r\ndata: hi\n\n\r\n");
+    CHECK(Sse("a\nb", "msg", "7") == "22\r\nid: 7\nevent: msg\ndata: a\ndata: b\n\n\r\n");
+    // \r\n 结尾的行去掉 \r；结尾的换行是一个空的 data 行
+    CHECK(Sse("x\r\ny\n") == "18\r\ndata: x\ndata: y\ndata: \n\n\r\n");
+    CHECK(Sse("", "a\r\nb") == "12\r\nevent: ab\ndata: \n\n\r\n");
+}
+
+static void TestFanout() {
+    EventHub* hub = EventHub::Instance();
+    FakeTarget t1, t2;
+    std::vector<std::shared_ptr<Subscriber>> subs;
+    for(int i = 0; i < 6; i++) {
+        subs.push_back(std::make_shared<Subscriber>(i < 4 ? Subscriber::SSE : Subscriber::WEBSOCKET, i,
+                                                    i % 2 ? &t2 : &t1));
+        subs.back()->Subscribe("news");
+    }
+    subs[0]->Subscribe("news");     // 重复订阅不算
+    CHECK(hub->Subscribers("news") == 6);
+
+    CHECK(hub->Publish("news", "hello") == 6);
+    CHECK(hub->Publish("nobody", "hello") == 0);
+    // 两个循环各唤醒一次，每次带上它那边的三个连接
+    CHECK(t1.pushes == 1 && t2.pushes == 1);
+    CHECK(t1.woken.size() == 3 && t2.woken.size() == 3);
+
+    // 没来取之前再发布不会再唤醒
+    hub->Publish("news", "world");
+    CHECK(t1.pushes == 1 && t2.pushes == 1);
+
+    std::vector<std::vector<SharedPayload>> got(subs.size());
+    for(size_t i = 0; i < subs.size(); i++) {
+        CHECK(subs[i]->Take(&got[i]));
+        CHECK(got[i].size() == 2);
+    }
+    // 同一种格式的订阅者拿到的是同一个指针
+    CHECK(got[0][0] == got[3][0] && got[0][1] == got[1][1]);
+    CHECK(got[4][0] == got[5][0] && got[0][0] != got[4][0]);
+    CHECK(got[0][0].use_count() == 4);   // 4 个 SSE 订阅者各拿一个引用
+    CHECK(*got[0][0] == Sse("hello") && *got[0][1] == Sse("world"));
+    CHECK(*got[4][1] == std::string("\x81\x05world", 7));
+
+    // 取过之后又能唤醒
+    hub->Publish("news", "again");
+    CHECK(t1.pushes == 2 && t2.pushes == 2);
+
+    for(auto& sub : subs) sub->Detach();
+    CHECK(hub->Subscribers("news") == 0);
+}
+
+static void TestUnsubscribe() {
+    EventHub* hub = EventHub::Instance();
+    FakeTarget t;
+    std::vector<std::shared_ptr<Subscriber>> subs;
+    for(int i = 0; i < 5; i++) {
+        subs.push_back(std::make_shared<Subscriber>(Subscriber::SSE, i, &t));
+        subs.back()->Subscribe("a");
+        subs.back()->Subscribe("b");
+    }
+    // 删中间的：最后一个挪过来补位，它记下的下标也要跟着改
+    subs[1]->Unsubscribe("a");
+    subs[0]->Detach();
+    subs[3]->Unsubscribe("b");
+    subs[4]->Unsubscribe("a");
+    CHECK(hub->Subscribers("a") == 2);
+    CHECK(hub->Subscribers("b") == 3);
+
+    hub->Publish("a", "1");
+    hub->Publish("b", "2");
+    size_t expect[5] = { 0, 1, 2, 1, 1 };
+    for(int i = 0; i < 5; i++) {
+        std::vector<SharedPayload> got;
+        subs[i]->Take(&got);
+        CHECK(got.size() == expect[i]);
+    }
+    // Detach 之后再订阅也不会加回去
+    subs[0]->Subscribe("a");
+    CHECK(hub->Subscribers("a") == 2);
+
+    for(auto& sub : subs) sub->Detach();
+    CHECK(hub->Subscribers("a") == 0 && hub->Subscribers("b") == 0);
+}
+
+static void TestOverflow() {
+    EventHub* hub = EventHub::Instance();
+    size_t saved = EventHub::maxPendingBytes;
+    EventHub::maxPendingBytes = 1000;
+    FakeTarget t;
+    auto slow = std::make_shared<Subscriber>(Subscriber::SSE, 1, &t);
+    auto fast = std::make_shared<Subscriber>(Subscriber::SSE, 2, &t);
+    slow->Subscribe("big");
+    fast->Subscribe("big");
+    std::string data(300, 'x');
+    std::vector<SharedPayload> got;
+    for(int i = 0; i < 10; i++) {
+        hub->Publish("big", data);
+        CHECK(fast->Take(&got));
+        got.clear();
+    }
+    // 慢连接积压超过上限：已经排着的丢掉，Take 告诉连接该断了
+    CHECK(!slow->Take(&got));
+    CHECK(got.empty());
+    slow->Detach();
+    fast->Detach();
+    EventHub::maxPendingBytes = saved;
+}
+
+static void TestConcurrent() {
+    EventHub* hub = EventHub::Instance();
+    const int kPublishers = 4, kMessages = 2000, kChurn = 200;
+    auto stable = std::make_shared<Subscriber>(Subscriber::SSE, 0, nullptr);
+    stable->Subscribe("mt");
+
+    std::vector<std::thread> threads;
+    for(int p = 0; p < kPublishers; p++) {
+        threads.emplace_back([hub]() {
+            for(int i = 0; i < kMessages; i++) hub->Publish("mt", "m");
+        });
+    }
+    // 同时有连接不停地进出
+    threads.emplace_back([]() {
+        for(int i = 0; i < kChurn; i++) {
+            auto sub = std::make_shared<Subscriber>(Subscriber::WEBSOCKET, i + 1, nullptr);
+            sub->Subscribe("mt");
+            std::vector<SharedPayload> got;
+            sub->Take(&got);
+            sub->Detach();
+        }
+    });
+    size_t total = 0;
+    std::vector<SharedPayload> got;
+    while(total < static_cast<size_t>(kPublishers * kMessages)) {
+        got.clear();
+        CHECK(stable->Take(&got));
+        total += got.size();
+        if(got.empty()) std::this_thread::yield();
+    }
+    for(auto& th : threads) th.join();
+    CHECK(total == static_cast<size_t>(kPublishers * kMessages));
+    stable->Detach();
+    CHECK(hub->Subscribers("mt") == 0);
+}
+
+static void Benchmark() {
+    EventHub* hub = EventHub::Instance();
+    const int kSubs = 10000, kRounds = 20;
+    FakeTarget targets[4];
+    std::vector<std::shared_ptr<Subscriber>> subs;
+    for(int i = 0; i < kSubs; i++) {
+        subs.push_back(std::make_shared<Subscriber>(Subscriber::SSE, i, &targets[i % 4]));
+        subs.back()->Subscribe("bench");
+    }
+    std::string data(4096, 'x');
+    std::vector<SharedPayload> got;
+    auto start = std::chrono::steady_clock::now();
+    for(int r = 0; r < kRounds; r++) {
+        hub->Publish("bench", data);
+        for(auto& sub : subs) {
+            sub->Take(&got);
+            got.clear();
+        }
+        for(auto& t : targets) t.woken.clear();
+    }
+    double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+    printf("fanout %d subscribers x %zu bytes: %.1f us/publish (%.0f ns/subscriber)\n",
+           kSubs, data.size(), us / kRounds, us * 1000 / kRounds / kSubs);
+    for(auto& sub : subs) sub->Detach();
+}
+
+int main() {
+    TestFormat();
+    TestFanout();
+    TestUnsubscribe();
+    TestOverflow();
+    TestConcurrent();
+    Benchmark();
+
+    printf("%s (%d failures)\n", failures ? "FAILED" : "OK", failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,195 @@
+// tests/test_hpack.cpp
+// 1. RFC 7541 附录 C 的例子 (带 / 不带 Huffman，动态表淘汰)
+// 2. 编码器 -> 解码器往返，Huffman 随机串往返，各种非法输入
+// 3. 头部列表大小上限：一个 4000 字节的表项加上一串 1 字节的索引 (解压炸弹)，不拷出来，动态表照样同步
+// 4. 一串典型响应头编码之后和 HTTP/1 文本的字节数对比
+#include "../include/http/Hpack.h"
+#include "check.h"
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+static std::string Hex(const char* hex) {
+    std::string out;
+    for(const char* p = hex; p[0] && p[1]; p += 2) {
+        out.push_back(static_cast<char>(std::stoi(std::string(p, 2), nullptr, 16)));
+    }
+    return out;
+}
+
+static bool Decode(HpackDecoder& d, const std::string& block, std::vector<HpackHeader>* headers) {
+    bool tooLarge = false;
+    return d.Decode(reinterpret_cast<const uint8_t*>(block.data()), block.size(), headers, &tooLarge) && !tooLarge;
+}
+
+static bool Has(const std::vector<HpackHeader>& headers, size_t i, const char* name, const char* value) {
+    return i < headers.size() && headers[i].name == name && headers[i].value == value;
+}
+
+// C.4：同一个连接上的三个请求，Huffman 编码
+static void TestRequests() {
+    HpackDecoder d;
+    std::vector<HpackHeader> h;
+    CHECK(Decode(d, Hex("828684418cf1e3c2e5f23a6ba0ab90f4ff"), &h));
+    CHECK(h.size() == 4 && Has(h, 3, ":authority", "www.example.com"));
+    CHECK(Decode(d, Hex("828684be5886a8eb10649cbf"), &h));
+    CHECK(h.size() == 5 && Has(h, 3, ":authority", "www.example.com") && Has(h, 4, "cache-control", "no-cache"));
+    CHECK(Decode(d, Hex("828785bf408825a849e95ba97d7f8925a849e95bb8e8b4bf"), &h));
+    CHECK(h.size() == 5 && Has(h, 1, ":scheme", "https") && Has(h, 2, ":path", "/index.html"));
+    CHECK(Has(h, 4, "custom-key", "custom-value"));
+}
+
+// C.6：动态表只有 256 字节，第二、三个响应会把前面的表项挤掉
+static void TestResponses() {
+    HpackDecoder d(256);
+    std::vector<HpackHeader> h;
+    CHECK(Decode(d, Hex("488264025885aec3771a4b6196d07abe941054d444a8200595040b8166e082a62d1bff"
+                        "6e919d29ad171863c78f0b97c8e9ae82ae43d3"), &h));
+    CHECK(h.size() == 4 && Has(h, 0, ":status", "302") && Has(h, 2, "date", "Mon, 21 Oct 2013 20:13:21 GMT"));
+    CHECK(Decode(d, Hex("4883640effc1c0bf"), &h));
+    CHECK(h.size() == 4 && Has(h, 0, ":status", "307") && Has(h, 3, "location", "https://www.example.com"));
+    CHECK(Decode(d, Hex("88c16196d07abe941054d444a8200595040b8166e084a62d1bffc05a839bd9ab77ad94e7821dd7f2e6c7b335dfdf"
+                        "cd5b3960d5af27087f3672c1ab270fb5291f9587316065c003ed4ee5b1063d5007"), &h));
+    CHECK(h.size() == 6 && Has(h, 4, "content-encoding", "gzip"));
+    CHECK(Has(h, 5, "set-cookie", "foo=ASDJKHQKBZXOQWEOPIUAXQWEOIU; max-age=3600; version=1"));
+}
+
+static void TestHuffman() {
+    std::mt19937 rng(7);
+    for(int round = 0; round < 20000; round++) {
+        std::string s;
+        size_t len = rng() % 64;
+        for(size_t i = 0; i < len; i++) {
+            // 一半是可打印字符，一半是任意字节 (长码字)
+            s.push_back(static_cast<char>(round % 2 ? 32 + rng() % 95 : rng() % 256));
+        }
+        std::string enc, dec;
+        Hpack::HuffmanEncode(s, &enc);
+        CHECK(enc.size() == Hpack::HuffmanLength(s));
+        bool ok = Hpack::HuffmanDecode(reinterpret_cast<const uint8_t*>(enc.data()), enc.size(), &dec);
+        CHECK(ok && dec == s);
+        if(!ok || dec != s) break;
+    }
+
+    std::string out;
+    // 填充不是全 1
+    CHECK(!Hpack::HuffmanDecode(reinterpret_cast<const uint8_t*>("\x00"), 1, &out));
+    // 填充超过 7 位
+    out.clear();
+    CHECK(!Hpack::HuffmanDecode(reinterpret_cast<const uint8_t*>("\xff"), 1, &out));
+    // EOS
+    out.clear();
+    CHECK(!Hpack::HuffmanDecode(reinterpret_cast<const uint8_t*>("\xff\xff\xff\xff"), 4, &out));
+}
+
+static void TestRoundTrip() {
+    HpackEncoder enc;
+    HpackDecoder dec;
+    std::vector<HpackHeader> h;
+    // 表很小，逼着两边一起淘汰
+    enc.SetPeerMaxTableSize(200);
+    for(int i = 0; i < 200; i++) {
+        std::string block;
+        enc.Begin(&block);
+        enc.Encode(":status", i % 3 ? "200" : "404", true, &block);
+        enc.Encode("content-type", i % 2 ? "text/html" : "application/json", true, &block);
+        enc.Encode("x-request", std::to_string(i % 7), true, &block);
+        enc.Encode("content-length", std::to_string(i * 37), false, &block);
+        CHECK(Decode(dec, block, &h));
+        CHECK(h.size() == 4);
+        CHECK(Has(h, 0, ":status", i % 3 ? "200" : "404"));
+        CHECK(Has(h, 1, "content-type", i % 2 ? "text/html" : "application/json"));
+        CHECK(Has(h, 2, "x-request", std::to_string(i % 7).c_str()));
+        CHECK(Has(h, 3, "content-length", std::to_string(i * 37).c_str()));
+    }
+}
+
+static void TestErrors() {
+    HpackDecoder d;
+    std::vector<HpackHeader> h;
+    CHECK(!Decode(d, Hex("80"), &h));               // 下标 0
+    CHECK(!Decode(d, Hex("be"), &h));               // 动态表里没有第 62 项
+    CHECK(!Decode(d, Hex("3fe21f"), &h));           // 表大小更新超过 4096
+    CHECK(!Decode(d, Hex("823f01"), &h));           // 表大小更新不在开头
+    CHECK(!Decode(d, Hex("4005"), &h));             // 字符串长度超出块
+    CHECK(!Decode(d, Hex("ffffffffffff0f"), &h));   // 整数溢出
+    CHECK(Decode(d, Hex("3fe11f82"), &h));          // 更新到 4096 本身是合法的
+}
+
+static void TestListLimit() {
+    const size_t kLimit = 64 * 1024;
+    HpackDecoder d(4096, kLimit);
+    // 带索引的字面量，新名字：x-big: 4000 个 'v'，进动态表成为第 62 项
+    std::string entry = "\x40\x05x-big";
+    Hpack::EncodeInt(4000, 7, 0x00, &entry);
+    entry.append(4000, 'v');
+    const size_t entrySize = Hpack::EntrySize(5, 4000);
+
+    // 剩下的 64KB 全是 0xbe：解出来 6 万多个头部、两亿多字节
+    std::string bomb = entry;
+    bomb.append(kLimit - bomb.size(), '\xbe');
+    std::vector<HpackHeader> h;
+    bool tooLarge = false;
+    CHECK(d.Decode(reinterpret_cast<const uint8_t*>(bomb.data()), bomb.size(), &h, &tooLarge));
+    CHECK(tooLarge && h.empty());
+
+    // 表项照样进了动态表：下一个块引用它，和对端是同步的
+    CHECK(Decode(d, "\xbe", &h));
+    CHECK(h.size() == 1 && h[0].name == "x-big" && h[0].value == std::string(4000, 'v'));
+
+    // 正好不超过上限的放行，多一个就不放
+    size_t fit = kLimit / entrySize;
+    CHECK(Decode(d, std::string(fit, '\xbe'), &h) && h.size() == fit);
+    CHECK(d.Decode(reinterpret_cast<const uint8_t*>(std::string(fit + 1, '\xbe').data()), fit + 1, &h, &tooLarge));
+    CHECK(tooLarge && h.empty());
+
+    // 超过上限之后的带索引字面量也要进表
+    std::string late(fit + 1, '\xbe');
+    late += "\x40\x05x-new\x03" "abc";
+    CHECK(d.Decode(reinterpret_cast<const uint8_t*>(late.data()), late.size(), &h, &tooLarge));
+    CHECK(tooLarge && h.empty());
+    CHECK(Decode(d, "\xbe\xbf", &h));
+    CHECK(Has(h, 0, "x-new", "abc") && Has(h, 1, "x-big", std::string(4000, 'v').c_str()));
+}
+
+// 典型的静态文件响应，每个响应 date / etag 不同，别的都一样
+static void Compare() {
+    HpackEncoder enc;
+    size_t http1 = 0, hpack = 0;
+    for(int i = 0; i < 100; i++) {
+        std::string date = "Sun, 18 Oct 2026 00:00:0" + std::to_string(i / 50) + " GMT";
+        std::string etag = "\"ce80" + std::to_string(i) + "-65-18df7523b9a45d26\"";
+        const char* pairs[][2] = {
+            {"date", date.c_str()}, {"vary", "Accept-Encoding"}, {"accept-ranges", "bytes"},
+            {"etag", etag.c_str()}, {"last-modified", "Sat, 17 Oct 2026 23:32:53 GMT"},
+            {"content-type", "text/html"}, {"content-length", "101"},
+        };
+        std::string block;
+        enc.Begin(&block);
+        enc.Encode(":status", "200", true, &block);
+        http1 += 17;  // "HTTP/1.1 200 OK\r\n"
+        for(auto& p : pairs) {
+            bool index = StrView(p[0]) != "etag" && StrView(p[0]) != "content-length" && StrView(p[0]) != "last-modified";
+            enc.Encode(p[0], p[1], index, &block);
+            http1 += strlen(p[0]) + strlen(p[1]) + 4;
+        }
+        hpack += block.size();
+    }
+    printf("100 responses: HTTP/1 headers %zu bytes, HPACK %zu bytes (%.1f%%)\n",
+           http1, hpack, 100.0 * hpack / http1);
+}
+
+int main() {
+    TestRequests();
+    TestResponses();
+    TestHuffman();
+    TestRoundTrip();
+    TestErrors();
+    TestListLimit();
+    Compare();
+
+    printf("%s (%d failures)\n", failures ? "FAILED" : "OK", failures);
+    return failures ? 1 : 0;
+}
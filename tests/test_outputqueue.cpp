@@ -0,0 +1,207 @@
+// tests/test_outputqueue.cpp
+// 1. 四种片段按顺序拼起来，相邻的拷贝段 / 引用段合并，共享段发完立刻放掉引用
+// 2. 文件段夹在内存段中间，经过一对 socketpair 发出去 (writev / sendmsg + sendfile 交替)
+// 3. 内存段超过 IOV_MAX 时分几次 writev，和一个 std::string 做随机操作对拍
+#include "../include/OutputQueue.h"
+#include "check.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+#include <sys/socket.h>
+#include <fcntl.h>
+#include <errno.h>
+
+// 把开头的内存段拼起来 (不消费)
+static std::string PeekMem(const OutputQueue& out) {
+    std::vector<struct iovec> iov;
+    out.PeekIov(&iov);
+    std::string s;
+    for(const struct iovec& v : iov) s.append(static_cast<const char*>(v.iov_base), v.iov_len);
+    return s;
+}
+
+// 一直发到队列空，对端收到的拼起来返回
+static std::string Drain(OutputQueue& out, int wfd, int rfd) {
+    std::string received;
+    char buf[65536];
+    int err = 0;
+    while(!out.Empty()) {
+        ssize_t n = out.WriteFd(wfd, &err);
+        CHECK(n > 0 || err == EAGAIN);
+        if(n < 0 && err != EAGAIN) break;
+        ssize_t r;
+        while((r = read(rfd, buf, sizeof(buf))) > 0) received.append(buf, r);
+    }
+    ssize_t r;
+    while((r = read(rfd, buf, sizeof(buf))) > 0) received.append(buf, r);
+    return received;
+}
+
+static void TestSegments() {
+    OutputQueue out;
+    CHECK(out.Empty() && out.SegmentCount() == 0 && out.FirstFile() == nullptr);
+
+    // 拷贝段在同一个块里接着写：合成一段
+    out.Append("HTTP/1.1 200 OK\r\n", 17);
+    out.Append("\r\n", 2);
+    CHECK(out.SegmentCount() == 1 && out.Bytes() == 19);
+
+    // 同一块内存里相邻的引用也合并，不相邻的不合并
+    static const char heads[] = "AAAABBBB";
+    out.AppendRef(heads, 4);
+    out.AppendRef(heads + 4, 4);
+    CHECK(out.SegmentCount() == 2);
+
+    auto body = std::make_shared<std::string>("shared body");
+    std::weak_ptr<std::string> watch = body;
+    out.AppendShared(body, body->data(), body->size());
+    body.reset();
+    CHECK(!watch.expired());
+    out.Append("tail", 4);
+    CHECK(out.SegmentCount() == 4);
+    CHECK(out.MemBytes() == out.Bytes());
+    CHECK(PeekMem(out) == "HTTP/1.1 200 OK\r\n\r\nAAAABBBBshared bodytail");
+
+    // 共享段发了一半还拿着，发完马上放掉
+    out.Advance(19 + 8 + 7);
+    CHECK(!watch.expired());
+    CHECK(PeekMem(out) == "bodytail");
+    out.Advance(4);
+    CHECK(watch.expired());
+    CHECK(PeekMem(out) == "tail");
+    out.Advance(4);
+    CHECK(out.Empty() && out.SegmentCount() == 0 && out.MemBytes() == 0);
+
+    // 空段不占位置；Clear 放掉所有引用
+    out.AppendRef(heads, 0);
+    CHECK(out.SegmentCount() == 0);
+    auto held = std::make_shared<std::string>("x");
+    watch = held;
+    out.AppendShared(held, held->data(), 1);
+    held.reset();
+    out.Clear();
+    CHECK(watch.expired() && out.Empty());
+
+    // 大块拷贝跨块：按块拆成几段
+    std::string big(ChainBuffer::BLOCK_SIZE * 2 + 10, 'z');
+    out.Append(big.data(), big.size());
+    CHECK(out.SegmentCount() == 3 && PeekMem(out) == big);
+    out.Clear();
+}
+
+static void TestFile() {
+    char path[] = "/tmp/test_outputqueue_XXXXXX";
+    int fileFd = mkstemp(path);
+    CHECK(fileFd >= 0);
+    unlink(path);
+    std::string content(300000, 0);
+    for(size_t i = 0; i < content.size(); i++) content[i] = static_cast<char>('a' + i % 23);
+    CHECK(write(fileFd, content.data(), content.size()) == static_cast<ssize_t>(content.size()));
+
+    int fds[2];
+    CHECK(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+    fcntl(fds[0], F_SETFL, O_NONBLOCK);
+    fcntl(fds[1], F_SETFL, O_NONBLOCK);
+
+    // 头 + 文件 + 头 + 文件的一段 + 尾巴，像一批流水线响应
+    OutputQueue out;
+    std::string expect;
+    out.Append("head1\r\n", 7);
+    expect += "head1\r\n";
+    auto holder = std::make_shared<int>(1);
+    std::weak_ptr<int> watch = holder;
+    out.AppendFile(fileFd, 0, content.size(), holder);
+    holder.reset();
+    expect += content;
+    out.AppendRef("head2\r\n", 7);
+    expect += "head2\r\n";
+    out.AppendFile(fileFd, 1000, 5000);
+    expect += content.substr(1000, 5000);
+    out.Append("end", 3);
+    expect += "end";
+
+    CHECK(out.MemBytes() == 7);
+    CHECK(out.FirstFile() && out.FirstFile()->offset == 0 && out.FirstFile()->len == content.size());
+    CHECK(out.Bytes() == expect.size());
+
+    // 文件段发完才放掉它的 holder
+    out.Advance(7 + 100);
+    CHECK(out.MemBytes() == 0 && out.FirstFile()->offset == 100 && !watch.expired());
+    out.Advance(content.size() - 100);
+    CHECK(watch.expired());
+    CHECK(out.MemBytes() == 7 && out.FirstFile()->offset == 1000);
+    out.Clear();
+
+    // 重新排一遍，真的发出去
+    out.Append("head1\r\n", 7);
+    out.AppendFile(fileFd, 0, content.size());
+    out.AppendRef("head2\r\n", 7);
+    out.AppendFile(fileFd, 1000, 5000);
+    out.Append("end", 3);
+    CHECK(Drain(out, fds[0], fds[1]) == expect);
+    CHECK(out.Empty());
+
+    close(fds[0]);
+    close(fds[1]);
+    close(fileFd);
+}
+
+static void TestRandom() {
+    int fds[2];
+    CHECK(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+    fcntl(fds[0], F_SETFL, O_NONBLOCK);
+    fcntl(fds[1], F_SETFL, O_NONBLOCK);
+
+    std::mt19937 rng(2025);
+    std::string src(100000, 0);
+    for(char& c : src) c = static_cast<char>(rng());
+    std::vector<std::shared_ptr<std::string>> payloads;
+    for(int round = 0; round < 20; round++) {
+        OutputQueue out;
+        std::string expect;
+        // 很多小的不相邻引用：内存段数远超 IOV_MAX，要分几次 writev
+        int pieces = 500 + rng() % 3000;
+        for(int i = 0; i < pieces; i++) {
+            size_t len = 1 + rng() % 64;
+            size_t off = rng() % (src.size() - len);
+            switch(rng() % 3) {
+            case 0:
+                out.Append(src.data() + off, len);
+                break;
+            case 1:
+                out.AppendRef(src.data() + off, len);
+                // 紧挨着再引用一段就会合并；插一段拷贝隔开
+                out.Append("|", 1);
+                expect.append(src, off, len);
+                expect += "|";
+                continue;
+            default: {
+                payloads.push_back(std::make_shared<std::string>(src, off, len));
+                const std::string& p = *payloads.back();
+                out.AppendShared(payloads.back(), p.data(), p.size());
+                break;
+            }
+            }
+            expect.append(src, off, len);
+        }
+        CHECK(out.Bytes() == expect.size());
+        std::vector<struct iovec> iov;
+        out.PeekIov(&iov);
+        CHECK(iov.size() <= IOV_MAX);
+        CHECK(Drain(out, fds[0], fds[1]) == expect);
+    }
+    close(fds[0]);
+    close(fds[1]);
+}
+
+int main() {
+    TestSegments();
+    TestFile();
+    TestRandom();
+
+    printf("%s (%d failures)\n", failures ? "FAILED" : "OK", failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,198 @@
+// tests/test_request.cpp
+// 请求头查找，请求 body 的几种分帧方式：Content-Length、chunked、流式回调，以及表单解析。
+// 每个用例都会按"一次性到达"和"每次一个字节"两种方式各喂一遍
+#include "../include/http/HttpRequest.h"
+#include "check.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+// 把 raw 按 step 字节一段喂给解析器，直到请求收全；返回最后一次 parse 的结果，
+// fed 带回实际喂了多少字节
+static bool Feed(HttpRequest& req, Buffer& buff, const std::string& raw, size_t step, size_t* fed = nullptr) {
+    bool ok = true;
+    size_t i = 0;
+    for(; i < raw.size() && ok && !req.IsFinished(); i += step) {
+        buff.append(raw.data() + i, std::min(step, raw.size() - i));
+        ok = req.parse(buff);
+    }
+    if(fed) *fed = std::min(i, raw.size());
+    return ok;
+}
+
+static void TestContentLength(size_t step) {
+    HttpRequest req;
+    Buffer buff;
+    std::string raw = "POST /form HTTP/1.1\r\nContent-Length: 11\r\n\r\nhello worldGET / HTTP/1.1\r\n\r\n";
+    CHECK(Feed(req, buff, raw, step));
+    CHECK(req.IsFinished());
+    CHECK(req.body() == "hello world");
+}
+
+static void TestChunked(size_t step) {
+    HttpRequest req;
+    Buffer buff;
+    std::string raw =
+        "POST /up HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n"
+        "5\r\nhello\r\n"
+        "1;ext=1\r\n \r\n"
+        "A\r\n0123456789\r\n"
+        "0\r\nX-Trailer: yes\r\n\r\n"
+        "GET /next HTTP/1.1\r\n\r\n";
+    size_t fed = 0;
+    CHECK(Feed(req, buff, raw, step, &fed));
+    CHECK(req.IsFinished());
+    CHECK(req.body() == "hello 0123456789");
+
+    // 后面流水线的请求还在缓冲区里，能接着解析
+    buff.append(raw.data() + fed, raw.size() - fed);
+    req.Init();
+    CHECK(req.parse(buff));
+    CHECK(req.IsFinished());
+    CHECK(req.path() == "/next");
+}
+
+static void TestHeaders() {
+    HttpRequest req;
+    Buffer buff;
+    std::string raw = "GET / HTTP/1.1\r\nhost: example.com\r\nACCEPT-ENCODING: gzip\r\n"
+                      "X-Custom: 1\r\nCookie: a=1\r\ncookie: b=2\r\n\r\n";
+    CHECK(Feed(req, buff, raw, raw.size()));
+    CHECK(req.GetHeader(HDR_HOST) == "example.com");
+    CHECK(req.GetHeader("Host") == "example.com");
+    CHECK(req.GetHeader(HDR_ACCEPT_ENCODING) == "gzip");
+    CHECK(req.GetHeader("x-custom") == "1");
+    CHECK(req.GetHeader(HDR_COOKIE) == "a=1");
+    CHECK(!req.HasHeader(HDR_RANGE));
+    CHECK(req.GetHeader("X-Missing").empty());
+    // 不认识的头和常用头的重复出现都在 OtherHeaders() 里
+    CHECK(req.OtherHeaders().size() == 2);
+    for(int id = 0; id < HDR_COUNT; id++) {
+        CHECK(HttpHeader::Lookup(HttpHeader::Name(static_cast<HeaderId>(id))) == id);
+    }
+}
+
+static void TestErrors() {
+    struct Case { const char* raw; int code; };
+    const Case cases[] = {
+        { "POST / HTTP/1.1\r\nContent-Length: 3\r\nTransfer-Encoding: chunked\r\n\r\n", 400 },
+        { "POST / HTTP/1.1\r\nTransfer-Encoding: gzip\r\n\r\n", 501 },
+        { "POST / HTTP/1.1\r\nContent-Length: 1\r\nContent-Length: 2\r\n\r\n", 400 },
+        { "POST / HTTP/1.1\r\nContent-Length: 1x\r\n\r\n", 400 },
+        { "POST / HTTP/1.1\r\nContent-Length: 99999999999\r\n\r\n", 413 },
+        { "POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\nzz\r\n", 400 },
+        { "POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n1\r\nab\r\n", 400 },
+        { "POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n1000000\r\n", 413 },
+    };
+    for(const Case& c : cases) {
+        HttpRequest req;
+        Buffer buff;
+        buff.append(c.raw, strlen(c.raw));
+        bool ok = req.parse(buff);
+        CHECK(!ok);
+        if(!ok) CHECK(req.ErrorCode() == c.code);
+    }
+}
+
+static void TestUrlencoded() {
+    HttpRequest req;
+    Buffer buff;
+    std::string body = "user=tom&msg=hello+world%21&empty=&flag";
+    std::string raw = "POST /login HTTP/1.1\r\nContent-Type: application/x-www-form-urlencoded\r\n"
+                      "Content-Length: " + std::to_string(body.size()) + "\r\n\r\n" + body;
+    CHECK(Feed(req, buff, raw, raw.size()));
+    CHECK(req.GetPost("user") == "tom");
+    CHECK(req.GetPost("msg") == "hello world!");
+    CHECK(req.GetPost("empty") == "");
+    CHECK(req.GetPost("missing") == "");
+}
+
+static void TestMultipart() {
+    HttpRequest req;
+    Buffer buff;
+    std::string body =
+        "--XyZ\r\n"
+        "Content-Disposition: form-data; name=\"title\"\r\n\r\n"
+        "my file\r\n"
+        "--XyZ\r\n"
+        "Content-Disposition: form-data; name=\"file\"; filename=\"a.txt\"\r\n"
+        "Content-Type: text/plain\r\n\r\n"
+        "line1\r\nline2\r\n"
+        "--XyZ--\r\n";
+    std::string raw = "POST /upload HTTP/1.1\r\nContent-Type: multipart/form-data; boundary=\"XyZ\"\r\n"
+                      "Content-Length: " + std::to_string(body.size()) + "\r\n\r\n" + body;
+    CHECK(Feed(req, buff, raw, 7));
+    CHECK(req.GetPost("title") == "my file");
+    CHECK(req.Files().size() == 1);
+    if(req.Files().size() == 1) {
+        const HttpRequest::FormFile& f = req.Files()[0];
+        CHECK(f.name == "file");
+        CHECK(f.filename == "a.txt");
+        CHECK(f.contentType == "text/plain");
+        CHECK(f.data == "line1\r\nline2");
+    }
+}
+
+// 流式上传：body 不进缓冲区，缓冲区大小和上传大小无关
+static void TestStreaming(bool chunked, size_t step) {
+    std::string received;
+    bool sawLast = false;
+    HttpRequest::bodyHandlerFactory = [&](const HttpRequest& r) -> HttpRequest::BodyHandler {
+        if(r.path() != "/stream") return nullptr;
+        return [&](const HttpRequest&, StrView data, bool last) {
+            received.append(data.data(), data.size());
+            sawLast = last;
+            return true;
+        };
+    };
+
+    std::string payload;
+    for(int i = 0; i < 100000; i++) payload.push_back(static_cast<char>('a' + i % 26));
+    std::string raw = "PUT /stream HTTP/1.1\r\n";
+    if(chunked) {
+        raw += "Transfer-Encoding: chunked\r\n\r\n";
+        for(size_t i = 0; i < payload.size(); i += 3000) {
+            size_t n = std::min<size_t>(3000, payload.size() - i);
+            char line[32];
+            snprintf(line, sizeof(line), "%zx\r\n", n);
+            raw += line + payload.substr(i, n) + "\r\n";
+        }
+        raw += "0\r\n\r\n";
+    } else {
+        raw += "Content-Length: " + std::to_string(payload.size()) + "\r\n\r\n" + payload;
+    }
+
+    HttpRequest req;
+    Buffer buff;
+    size_t maxBuffered = 0;
+    bool ok = true;
+    for(size_t i = 0; i < raw.size() && ok; i += step) {
+        buff.append(raw.data() + i, std::min(step, raw.size() - i));
+        ok = req.parse(buff);
+        maxBuffered = std::max(maxBuffered, buff.readableBytes());
+    }
+    CHECK(ok);
+    CHECK(req.IsFinished());
+    CHECK(sawLast);
+    CHECK(received == payload);
+    CHECK(req.body().empty());
+    CHECK(maxBuffered < 4096 + step);
+    HttpRequest::bodyHandlerFactory = nullptr;
+}
+
+int main() {
+    for(size_t step : {static_cast<size_t>(1), static_cast<size_t>(1 << 20)}) {
+        TestContentLength(step);
+        TestChunked(step);
+        TestStreaming(false, step == 1 ? 1 : 1500);
+        TestStreaming(true, step == 1 ? 1 : 1500);
+    }
+    TestHeaders();
+    TestErrors();
+    TestUrlencoded();
+    TestMultipart();
+
+    printf("%s (%d failures)\n", failures ? "FAILED" : "OK", failures);
+    return failures ? 1 : 0;
+}
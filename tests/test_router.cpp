@@ -0,0 +1,171 @@
+// tests/test_router.cpp
+// 1. 路由匹配：静态段 / ":name" / "*name" 的优先级和回退、参数提取、405、注册冲突
+// 2. 路由条数变多时匹配耗时基本不变 (和逐条比较的写法比较)
+#include "../include/http/Router.h"
+#include "check.h"
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// 用 handler 的地址区分命中的是哪条路由，测试里不需要真的调用
+static Router::Handler Tag() {
+    return [](const HttpRequest&, const RouteParams&, HttpResponse&) {};
+}
+
+static const Router::Route* Match(const Router& r, const char* method, const char* path,
+                                  RouteParams* params, Router::MatchResult* result) {
+    return r.Match(StrView(method), StrView(path), params, result);
+}
+
+static void TestMatch() {
+    Router r;
+    CHECK(r.Get("/api/users", Tag()));
+    CHECK(r.Post("/api/users", Tag()));
+    CHECK(r.Get("/api/users/me", Tag()));
+    CHECK(r.Get("/api/users/:id", Tag()));
+    CHECK(r.Get("/api/users/:id/posts/:post", Tag()));
+    CHECK(r.Get("/api/posts", Tag()));
+    CHECK(r.Static("/"));
+
+    RouteParams params;
+    Router::MatchResult result;
+    const Router::Route* route;
+
+    route = Match(r, "GET", "/api/users", &params, &result);
+    CHECK(route && route->pattern == "/api/users" && route->method == "GET");
+    route = Match(r, "POST", "/api/users", &params, &result);
+    CHECK(route && route->method == "POST");
+
+    // 静态段优先于参数
+    route = Match(r, "GET", "/api/users/me", &params, &result);
+    CHECK(route && route->pattern == "/api/users/me" && params.Size() == 0);
+
+    route = Match(r, "GET", "/api/users/42", &params, &result);
+    CHECK(route && route->pattern == "/api/users/:id");
+    CHECK(params.Get("id") == "42");
+
+    route = Match(r, "GET", "/api/users/7/posts/hello", &params, &result);
+    CHECK(route && route->pattern == "/api/users/:id/posts/:post");
+    CHECK(params.Get("id") == "7" && params.Get("post") == "hello");
+
+    // "/api/users/me/posts/1"：静态的 "me" 走不通，回退到 ":id"
+    route = Match(r, "GET", "/api/users/me/posts/1", &params, &result);
+    CHECK(route && route->pattern == "/api/users/:id/posts/:post");
+    CHECK(params.Get("id") == "me" && params.Size() == 2);
+
+    // 动态路由都对不上的落到静态文件
+    route = Match(r, "GET", "/index.html", &params, &result);
+    CHECK(route && !route->handler && params.Get("path") == "index.html");
+    route = Match(r, "GET", "/api/users/1/comments", &params, &result);
+    CHECK(route && !route->handler && params.Get("path") == "api/users/1/comments");
+    CHECK(params.Size() == 1);
+    route = Match(r, "GET", "/", &params, &result);
+    CHECK(route && !route->handler && params.Get("path").empty());
+
+    // 路径有具体方法的路由、方法对不上：405，不落到静态文件
+    std::string allow;
+    route = r.Match("DELETE", "/api/users", &params, &result, &allow);
+    CHECK(!route && result == Router::METHOD_NOT_ALLOWED);
+    CHECK(allow == "GET, HEAD, POST");
+    // 静态段和 ":id" 都对上了路径，方法合在一起，不重复
+    CHECK(r.Post("/api/users/:id", Tag()));
+    route = r.Match("PUT", "/api/users/me", &params, &result, &allow);
+    CHECK(!route && result == Router::METHOD_NOT_ALLOWED);
+    CHECK(allow == "GET, HEAD, POST");
+    // 没有 HEAD 路由时 HEAD 用 GET 的
+    route = Match(r, "HEAD", "/api/users/42", &params, &result);
+    CHECK(route && route->pattern == "/api/users/:id" && route->method == "GET");
+    // 没有具体路由的路径，静态文件照样接受任意方法
+    route = Match(r, "POST", "/upload.html", &params, &result);
+    CHECK(route && !route->handler && params.Get("path") == "upload.html");
+}
+
+static void TestMethodNotAllowed() {
+    Router r;
+    CHECK(r.Get("/api/items/:id", Tag()));
+    RouteParams params;
+    Router::MatchResult result;
+    std::string allow;
+    CHECK(r.Match("PUT", "/api/items/3", &params, &result, &allow) == nullptr);
+    CHECK(result == Router::METHOD_NOT_ALLOWED && allow == "GET, HEAD");
+    CHECK(params.Size() == 0);
+    CHECK(Match(r, "GET", "/api/other", &params, &result) == nullptr);
+    CHECK(result == Router::NOT_FOUND);
+    // 参数不能为空
+    CHECK(Match(r, "GET", "/api/items/", &params, &result) == nullptr);
+    CHECK(result == Router::NOT_FOUND);
+}
+
+static void TestConflicts() {
+    Router r;
+    CHECK(r.Get("/a/:id", Tag()));
+    CHECK(!r.Get("/a/:id", Tag()));        // 重复注册
+    CHECK(r.Post("/a/:id", Tag()));        // 换个方法可以
+    CHECK(!r.Get("/a/:name/x", Tag()));    // 同一位置参数名不一样
+    CHECK(!r.Get("/a/*rest/x", Tag()));    // '*' 不在最后
+    CHECK(!r.Get("/a/:", Tag()));          // 没有参数名
+    CHECK(!r.Get("a", Tag()));             // 不以 '/' 开头
+    CHECK(r.Size() == 2);
+}
+
+// 逐条比较的写法：每条路由都按段比一遍
+static bool LinearMatch(const std::vector<std::string>& patterns, const std::string& path) {
+    for(const std::string& p : patterns) {
+        size_t i = 0, j = 0;
+        bool ok = true;
+        while(ok && i < p.size() && j <= path.size()) {
+            if(p[i] == ':') {
+                while(i < p.size() && p[i] != '/') i++;
+                size_t start = j;
+                while(j < path.size() && path[j] != '/') j++;
+                ok = j > start;
+            } else {
+                ok = j < path.size() && p[i++] == path[j++];
+            }
+        }
+        if(ok && i == p.size() && j == path.size()) return true;
+    }
+    return false;
+}
+
+static void Bench() {
+    for(int n : {10, 100, 1000}) {
+        Router r;
+        std::vector<std::string> patterns;
+        for(int i = 0; i < n; i++) {
+            std::string p = "/api/v1/resource" + std::to_string(i) + "/:id";
+            r.Get(p, Tag());
+            patterns.push_back(p);
+        }
+        // 找最后注册的那条，逐条比较的最坏情况
+        std::string path = "/api/v1/resource" + std::to_string(n - 1) + "/12345";
+
+        const int REPEAT = 200000;
+        RouteParams params;
+        Router::MatchResult result;
+        size_t hit = 0;
+        auto t0 = std::chrono::steady_clock::now();
+        for(int k = 0; k < REPEAT; k++) {
+            hit += r.Match("GET", StrView(path), &params, &result) != nullptr;
+        }
+        auto t1 = std::chrono::steady_clock::now();
+        for(int k = 0; k < REPEAT / 10; k++) hit += LinearMatch(patterns, path);
+        auto t2 = std::chrono::steady_clock::now();
+
+        double radix = std::chrono::duration<double, std::nano>(t1 - t0).count() / REPEAT;
+        double linear = std::chrono::duration<double, std::nano>(t2 - t1).count() / (REPEAT / 10);
+        CHECK(hit == REPEAT + REPEAT / 10);
+        printf("%5d routes: radix %7.1f ns   linear %9.1f ns\n", n, radix, linear);
+    }
+}
+
+int main() {
+    TestMatch();
+    TestMethodNotAllowed();
+    TestConflicts();
+    Bench();
+
+    printf("%s (%d failures)\n", failures ? "FAILED" : "OK", failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,651 @@
+// tests/test_server.cpp
+// 在本进程里起真正的事件循环 (epoll / io_uring 各一遍)，用阻塞 socket 当客户端：
+// 1. 一批流水线响应一次就超过高水位：暂停读 (io_uring 是取消 recv) 和发送完成抢先后，连接不能断
+// 2. h2c 下载 30MB 的文件 (窗口设置和 curl 一样)，内容逐字节核对
+// 3. 大文件 (sendfile / splice) 的 HTTP/1 下载；h2c 隔着 1KB 的流窗口下载；一个连接上 300 个流
+// 4. 流水线里夹着 HEAD：只有头部 (Content-Length 照写)，后面的响应不错位
+// 5. 有 Static("/") 兜底时，API 路由用错方法回 405 + Allow，不是 404
+// 6. 单连接缓冲区上限 32KB：100KB 的流水线请求读满就停、处理完接着读，全部有回应；一个请求本身超过上限才断开
+// 7. h2c 的 HPACK 炸弹 (一个 4KB 的动态表条目被引用上万次)：回 431，动态表照常更新，连接接着能用
+// 8. h2c 上传：收完的 body 把连接级窗口还回来 (一个连接传 20MB 不卡)；没收完的 body 占满 16MB 窗口后
+//    再发是 FLOW_CONTROL_ERROR；攒着的 body 算进单连接缓冲区上限
+#include "../include/EventLoop.h"
+#include "../include/UringLoop.h"
+#include "../include/log.h"
+#include "../include/http/HttpConn.h"
+#include "../include/BufferBudget.h"
+#include "../include/http/FileCache.h"
+#include "../include/http/Hpack.h"
+#include "../include/http/HttpResponse.h"
+#include "../include/http/Router.h"
+#include "check.h"
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <functional>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+static std::string root;
+
+static std::string Pattern(size_t len, int seed) {
+    std::string s(len, 0);
+    for(size_t i = 0; i < len; i++) s[i] = static_cast<char>('a' + (i * 7 + seed) % 26);
+    return s;
+}
+
+static void WriteFile(const std::string& name, const std::string& content) {
+    int fd = open((root + "/" + name).c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if(fd < 0 || write(fd, content.data(), content.size()) != static_cast<ssize_t>(content.size())) {
+        throw std::runtime_error("write " + name);
+    }
+    close(fd);
+}
+
+// 一个 loop 跑在自己的线程里，析构时停掉
+class Server {
+public:
+    explicit Server(EventLoop::Backend backend) : port_(0) {
+        loop_ = EventLoop::Create(backend, nullptr, 60000);
+        isUring_ = dynamic_cast<UringLoop*>(loop_.get()) != nullptr;
+        for(int port = 19300; port < 19400 && !port_; port++) {
+            try {
+                loop_->Listen(port);
+                port_ = port;
+            } catch(const std::runtime_error&) {}
+        }
+        thread_ = std::thread(&EventLoop::Loop, loop_.get());
+    }
+    ~Server() {
+        loop_->Quit();
+        thread_.join();
+    }
+    int Port() const { return port_; }
+    bool IsUring() const { return isUring_; }
+
+private:
+    std::unique_ptr<EventLoop> loop_;
+    std::thread thread_;
+    int port_;
+    bool isUring_;
+};
+
+// 阻塞的客户端连接，自带读缓冲
+class Client {
+public:
+    explicit Client(int port) : fd_(socket(AF_INET, SOCK_STREAM, 0)) {
+        struct sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        ok_ = connect(fd_, (struct sockaddr*)&addr, sizeof(addr)) == 0;
+        // 卡住的话别让测试一直挂着
+        struct timeval tv = {10, 0};
+        setsockopt(fd_, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    }
+    ~Client() { close(fd_); }
+
+    bool Ok() const { return ok_; }
+    int Fd() const { return fd_; }
+
+    bool Send(const std::string& data) {
+        size_t off = 0;
+        while(off < data.size()) {
+            ssize_t n = write(fd_, data.data() + off, data.size() - off);
+            if(n < 0 && errno == EINTR) continue;
+            if(n <= 0) return false;
+            off += n;
+        }
+        return true;
+    }
+
+    // 读到 len 字节为止；连接断了或超时返回 false
+    bool ReadExactly(size_t len, std::string* out) {
+        while(buf_.size() < len) {
+            if(!Fill_()) return false;
+        }
+        out->assign(buf_, 0, len);
+        buf_.erase(0, len);
+        return true;
+    }
+
+    // 读一个 HTTP/1 响应：head 包括空行；hasBody 为 false 时 (HEAD) 不按 Content-Length 读 body
+    bool ReadResponse(std::string* head, std::string* body, bool hasBody = true) {
+        size_t end;
+        while((end = buf_.find("\r\n\r\n")) == std::string::npos) {
+            if(!Fill_()) return false;
+        }
+        head->assign(buf_, 0, end + 4);
+        buf_.erase(0, end + 4);
+        body->clear();
+        const char* len = strcasestr(head->c_str(), "\r\nContent-Length:");
+        if(!hasBody || !len) return true;
+        return ReadExactly(strtoul(len + 17, nullptr, 10), body);
+    }
+
+    // 对端关闭前都没有多余的字节
+    bool DrainToEof(std::string* rest) {
+        while(Fill_()) {}
+        rest->swap(buf_);
+        buf_.clear();
+        return true;
+    }
+
+private:
+    bool Fill_() {
+        char tmp[65536];
+        ssize_t n;
+        // 同一个进程里的 io_uring 会打断阻塞的系统调用
+        do {
+            n = read(fd_, tmp, sizeof(tmp));
+        } while(n < 0 && errno == EINTR);
+        if(n <= 0) return false;
+        buf_.append(tmp, n);
+        return true;
+    }
+
+    int fd_;
+    bool ok_;
+    std::string buf_;
+};
+
+// 最小的 h2c 客户端：发 GET 或者现成的头部块 / DATA，收 DATA 时按收到的量还窗口
+class H2Client {
+public:
+    enum { DATA = 0, HEADERS = 1, RST_STREAM = 3, SETTINGS = 4, GOAWAY = 7, WINDOW_UPDATE = 8, CONTINUATION = 9 };
+
+    // streamWindow：SETTINGS_INITIAL_WINDOW_SIZE；连接窗口一开始就放到 1GB
+    H2Client(int port, uint32_t streamWindow) : conn_(port), streamWindow_(streamWindow) {
+        std::string out = "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n";
+        std::string settings;
+        AppendU16_(&settings, 0x4);
+        AppendU32_(&settings, streamWindow);
+        out += Frame_(SETTINGS, 0, 0, settings);
+        out += WindowUpdate_(0, (1u << 30) - 65535);
+        conn_.Send(out);
+    }
+
+    bool Ok() const { return conn_.Ok(); }
+
+    // 只用静态表：:method GET / :scheme http / :path 字面量 / :authority 字面量
+    void Get(uint32_t streamId, const std::string& path) {
+        std::string block = "\x82\x86";
+        block += '\x04';
+        block += static_cast<char>(path.size());
+        block += path;
+        block += "\x01\x01t";
+        conn_.Send(Frame_(HEADERS, 0x5, streamId, block));   // END_STREAM | END_HEADERS
+    }
+
+    // 任意头部块：超过 16KB 的拆成 HEADERS + CONTINUATION
+    void Headers(uint32_t streamId, const std::string& block, bool endStream) {
+        std::string out;
+        for(size_t off = 0; off == 0 || off < block.size(); off += 16384) {
+            uint8_t flags = off + 16384 >= block.size() ? 0x4 : 0;   // END_HEADERS
+            if(off == 0 && endStream) flags |= 0x1;
+            out += Frame_(off == 0 ? HEADERS : CONTINUATION, flags, streamId, block.substr(off, 16384));
+        }
+        conn_.Send(out);
+    }
+
+    // 请求 body，按 16KB 一帧发，不管窗口
+    void Data(uint32_t streamId, size_t len, bool endStream) {
+        std::string out, chunk(16384, 'd');
+        for(size_t off = 0; off < len; off += chunk.size()) {
+            size_t n = std::min(chunk.size(), len - off);
+            out += Frame_(DATA, endStream && off + n == len ? 0x1 : 0, streamId, chunk.substr(0, n));
+        }
+        conn_.Send(out);
+    }
+
+    struct Stream {
+        bool ok = false;      // :status 200
+        int status = 0;
+        int resetCode = -1;   // 被 RST_STREAM 的话是错误码
+        bool ended = false;
+        std::string body;
+    };
+
+    // 对端发的 GOAWAY 里的错误码，没有是 -1
+    int GoawayCode() const { return goawayCode_; }
+
+    // 收到这些流都结束 (或者被重置) 为止；连接出错、收到 GOAWAY 返回 false。
+    // 每结束一个流调一次 onEnd，里面可以接着 Get 并往 streams 里加新的流
+    bool Wait(std::map<uint32_t, Stream>* streams,
+              const std::function<void(uint32_t)>& onEnd = std::function<void(uint32_t)>()) {
+        size_t open = streams->size();
+        while(open > 0) {
+            std::string head, payload;
+            if(!conn_.ReadExactly(9, &head)) return false;
+            const uint8_t* h = reinterpret_cast<const uint8_t*>(head.data());
+            size_t len = (h[0] << 16) | (h[1] << 8) | h[2];
+            uint8_t type = h[3], flags = h[4];
+            uint32_t id = ((h[5] & 0x7f) << 24) | (h[6] << 16) | (h[7] << 8) | h[8];
+            if(!conn_.ReadExactly(len, &payload)) return false;
+            if(type == SETTINGS && !(flags & 0x1)) {
+                conn_.Send(Frame_(SETTINGS, 0x1, 0, ""));
+            } else if(type == GOAWAY) {
+                goawayCode_ = len >= 8 ? static_cast<int>(ReadU32_(payload.data() + 4)) : 0;
+                return false;
+            } else if(type == RST_STREAM) {
+                auto it = streams->find(id);
+                if(it == streams->end() || len != 4) return false;
+                // 响应发完之后补的 RST_STREAM(NO_ERROR) 不算
+                if(!it->second.ended) {
+                    it->second.resetCode = static_cast<int>(ReadU32_(payload.data()));
+                    it->second.ended = true;
+                    open--;
+                }
+            } else if(type == HEADERS || type == DATA) {
+                auto it = streams->find(id);
+                if(it == streams->end()) return false;
+                Stream& s = it->second;
+                if(type == HEADERS) {
+                    // 服务端的编码器用动态表，每个头部块都得解
+                    std::vector<HpackHeader> headers;
+                    bool tooLarge = false;
+                    if(!decoder_.Decode(reinterpret_cast<const uint8_t*>(payload.data()), len, &headers, &tooLarge)) {
+                        return false;
+                    }
+                    for(const HpackHeader& hd : headers) {
+                        if(hd.name == ":status") s.status = atoi(hd.value.c_str());
+                    }
+                    s.ok = s.status == 200;
+                } else {
+                    s.body += payload;
+                    // 收多少还多少：流和连接各一个
+                    if(len > 0) {
+                        conn_.Send(WindowUpdate_(id, len) + WindowUpdate_(0, len));
+                    }
+                }
+                if(flags & 0x1) {
+                    s.ended = true;
+                    open--;
+                    if(onEnd) {
+                        size_t before = streams->size();
+                        onEnd(id);
+                        open += streams->size() - before;
+                    }
+                }
+            }
+        }
+        return true;
+    }
+
+private:
+    static uint32_t ReadU32_(const char* p) {
+        const uint8_t* u = reinterpret_cast<const uint8_t*>(p);
+        return (static_cast<uint32_t>(u[0] & 0x7f) << 24) | (u[1] << 16) | (u[2] << 8) | u[3];
+    }
+    static void AppendU16_(std::string* s, uint16_t v) {
+        s->push_back(static_cast<char>(v >> 8));
+        s->push_back(static_cast<char>(v));
+    }
+    static void AppendU32_(std::string* s, uint32_t v) {
+        AppendU16_(s, v >> 16);
+        AppendU16_(s, v & 0xffff);
+    }
+    static std::string Frame_(uint8_t type, uint8_t flags, uint32_t streamId, const std::string& payload) {
+        std::string f;
+        f.push_back(static_cast<char>(payload.size() >> 16));
+        AppendU16_(&f, payload.size() & 0xffff);
+        f.push_back(static_cast<char>(type));
+        f.push_back(static_cast<char>(flags));
+        AppendU32_(&f, streamId);
+        return f + payload;
+    }
+    static std::string WindowUpdate_(uint32_t streamId, uint32_t inc) {
+        std::string payload;
+        AppendU32_(&payload, inc);
+        return Frame_(WINDOW_UPDATE, 0, streamId, payload);
+    }
+
+    Client conn_;
+    uint32_t streamWindow_;
+    HpackDecoder decoder_;
+    int goawayCode_ = -1;
+};
+
+static std::string Get(const std::string& path, bool close = false) {
+    return "GET " + path + " HTTP/1.1\r\nHost: t\r\n" + (close ? "Connection: close\r\n" : "") + "\r\n";
+}
+
+static void TestHighWaterBatch(EventLoop::Backend backend, const char* name) {
+    // 3 个 6KB 的响应在一批里，超过 16KB 的高水位：读暂停 (io_uring 取消 recv)，
+    // 而这一批放得进 socket 发送缓冲区，一次 sendmsg 就发完了，完成通知比取消先回来。
+    // 读缓冲区里没有后续请求，发完以后不会再有新的一批把读重新暂停
+    size_t savedMark = HttpConn::highWaterMark;
+    HttpConn::highWaterMark = 16 * 1024;
+    std::string content = Pattern(6 * 1024, 1);
+    {
+        Server server(backend);
+        for(int round = 0; round < 20; round++) {
+            Client client(server.Port());
+            CHECK(client.Ok());
+            std::string batch;
+            for(int i = 0; i < 3; i++) batch += Get("/mid.bin");
+            CHECK(client.Send(batch));
+            int good = 0;
+            for(int i = 0; i < 3; i++) {
+                std::string head, body;
+                if(!client.ReadResponse(&head, &body)) break;
+                good += head.compare(0, 15, "HTTP/1.1 200 OK") == 0 && body == content;
+            }
+            // 恢复读以后同一个连接还能接着用
+            std::string head, body;
+            bool again = client.Send(Get("/mid.bin")) && client.ReadResponse(&head, &body) && body == content;
+            if(good != 3 || !again) {
+                printf("[%s] round %d: %d of 3 responses, follow-up %s\n", name, round, good, again ? "ok" : "failed");
+                CHECK(false);
+                break;
+            }
+        }
+    }
+    HttpConn::highWaterMark = savedMark;
+}
+
+static void TestH2Download(EventLoop::Backend backend, const char* name, const std::string& big) {
+    // 默认高水位 1MB：一批 DATA 不越过它，不会触发暂停读
+    Server server(backend);
+    // curl 的设置：流窗口 32MB，连接窗口 1GB
+    H2Client client(server.Port(), 32 * 1024 * 1024);
+    CHECK(client.Ok());
+    client.Get(1, "/big.bin");
+    std::map<uint32_t, H2Client::Stream> streams;
+    streams[1];
+    bool done = client.Wait(&streams);
+    const H2Client::Stream& s = streams[1];
+    if(!done || !s.ok || s.body != big) {
+        printf("[%s] h2c download: %s, status ok %d, %zu of %zu bytes, content %s\n", name,
+               done ? "finished" : "connection failed", s.ok, s.body.size(), big.size(),
+               s.body == big ? "matches" : "differs");
+        CHECK(false);
+    }
+}
+
+static void TestBigDownload(EventLoop::Backend backend, const char* name, const std::string& big) {
+    Server server(backend);
+    Client client(server.Port());
+    CHECK(client.Ok());
+    // 大于 sendfile 阈值：epoll 走 sendfile，io_uring 走 splice
+    std::string head, body;
+    bool ok = client.Send(Get("/big.bin")) && client.ReadResponse(&head, &body);
+    if(!ok || body != big) {
+        printf("[%s] HTTP/1 download: %zu of %zu bytes\n", name, body.size(), big.size());
+        CHECK(false);
+    }
+}
+
+static void TestH2SmallWindow(EventLoop::Backend backend, const char* name, const std::string& big) {
+    // 流窗口只有 1KB：每帧都要等一次 WINDOW_UPDATE
+    Server server(backend);
+    H2Client client(server.Port(), 1024);
+    CHECK(client.Ok());
+    client.Get(1, "/big.bin");
+    std::map<uint32_t, H2Client::Stream> streams;
+    streams[1];
+    bool done = client.Wait(&streams);
+    if(!done || !streams[1].ok || streams[1].body != big) {
+        printf("[%s] h2c 1KB window: %zu of %zu bytes\n", name, streams[1].body.size(), big.size());
+        CHECK(false);
+    }
+}
+
+static void TestH2Streams(EventLoop::Backend backend, const char* name, const std::string& mid) {
+    // 300 个请求走一个连接；服务端同时最多 256 个流，多的按 SETTINGS 的约定等前面的结束再开
+    const uint32_t kStreams = 300, kConcurrent = 256;
+    Server server(backend);
+    H2Client client(server.Port(), 65535);
+    CHECK(client.Ok());
+    std::map<uint32_t, H2Client::Stream> streams;
+    uint32_t next = 1;
+    for(; next < 2 * kConcurrent; next += 2) {
+        client.Get(next, "/mid.bin");
+        streams[next];
+    }
+    bool done = client.Wait(&streams, [&](uint32_t) {
+        if(next < 2 * kStreams) {
+            client.Get(next, "/mid.bin");
+            streams[next];
+            next += 2;
+        }
+    });
+    size_t good = 0;
+    for(auto& kv : streams) good += kv.second.ok && kv.second.body == mid;
+    if(!done || good != kStreams) {
+        printf("[%s] h2c streams: %zu of %u\n", name, good, kStreams);
+        CHECK(false);
+    }
+}
+
+static void TestPipelinedHead(EventLoop::Backend backend, const char* name,
+                              const std::string& mid, const std::string& big) {
+    Server server(backend);
+    Client client(server.Port());
+    CHECK(client.Ok());
+    // 缓存里的小文件、走 sendfile / splice 的大文件各 HEAD 一次，最后一个请求带 close
+    std::string batch = "HEAD /mid.bin HTTP/1.1\r\nHost: t\r\n\r\n" + Get("/mid.bin") +
+                        "HEAD /big.bin HTTP/1.1\r\nHost: t\r\n\r\n" + Get("/mid.bin", true);
+    CHECK(client.Send(batch));
+    const struct {
+        bool head;
+        size_t len;
+    } expect[] = {{true, mid.size()}, {false, mid.size()}, {true, big.size()}, {false, mid.size()}};
+    for(size_t i = 0; i < 4; i++) {
+        std::string head, body;
+        bool ok = client.ReadResponse(&head, &body, !expect[i].head);
+        const char* len = strcasestr(head.c_str(), "\r\nContent-Length:");
+        ok = ok && head.compare(0, 15, "HTTP/1.1 200 OK") == 0 && len &&
+             strtoul(len + 17, nullptr, 10) == expect[i].len && (expect[i].head || body == mid);
+        if(!ok) {
+            printf("[%s] pipelined HEAD: response %zu wrong: %.60s\n", name, i, head.c_str());
+            CHECK(false);
+            return;
+        }
+    }
+    // 连接关掉之前不该再有别的字节
+    std::string rest;
+    client.DrainToEof(&rest);
+    CHECK(rest.empty());
+}
+
+static void TestMethodNotAllowed(EventLoop::Backend backend, const char* name) {
+    Server server(backend);
+    Client client(server.Port());
+    CHECK(client.Ok());
+    CHECK(client.Send("POST /api/status HTTP/1.1\r\nHost: t\r\nContent-Length: 0\r\n\r\n" + Get("/api/status", true)));
+    std::string head, body;
+    CHECK(client.ReadResponse(&head, &body, true));
+    if(head.compare(0, 12, "HTTP/1.1 405") != 0 || head.find("\r\nAllow: GET, HEAD\r\n") == std::string::npos) {
+        printf("[%s] 405: %.80s\n", name, head.c_str());
+        CHECK(false);
+    }
+    CHECK(client.ReadResponse(&head, &body, true));
+    CHECK(head.compare(0, 15, "HTTP/1.1 200 OK") == 0 && body == "up\n");
+}
+
+static void TestReadBudget(EventLoop::Backend backend, const char* name) {
+    BufferBudget* budget = BufferBudget::Instance();
+    size_t savedLimit = budget->Limit(), savedPerConn = budget->PerConnLimit();
+    budget->SetLimit(0, 32 * 1024);
+    {
+        Server server(backend);
+        Client client(server.Port());
+        CHECK(client.Ok());
+        const int kRequests = 200;
+        std::string pad(450, 'p');
+        std::string batch;
+        for(int i = 0; i < kRequests; i++) {
+            batch += "GET /api/status HTTP/1.1\r\nHost: t\r\nX-Pad: " + pad + "\r\n" +
+                     (i == kRequests - 1 ? "Connection: close\r\n" : "") + "\r\n";
+        }
+        CHECK(client.Send(batch));
+        int good = 0;
+        std::string head, body;
+        while(good < kRequests && client.ReadResponse(&head, &body, true) &&
+              head.compare(0, 15, "HTTP/1.1 200 OK") == 0 && body == "up\n") {
+            good++;
+        }
+        if(good != kRequests) {
+            printf("[%s] pipelined burst over the buffer cap: %d of %d answered\n", name, good, kRequests);
+            CHECK(false);
+        }
+    }
+    {
+        // body 100KB 要整个放在读缓冲区里，放不下：不回响应，直接断开
+        Server server(backend);
+        Client client(server.Port());
+        CHECK(client.Ok());
+        std::string post = "POST /api/status HTTP/1.1\r\nHost: t\r\nContent-Length: 100000\r\n\r\n";
+        post.append(100000, 'b');
+        client.Send(post);
+        std::string rest;
+        client.DrainToEof(&rest);
+        CHECK(rest.empty());
+    }
+    budget->SetLimit(savedLimit, savedPerConn);
+}
+
+static void TestHeaderBomb(EventLoop::Backend backend, const char* name) {
+    Server server(backend);
+    H2Client client(server.Port(), 65535);
+    CHECK(client.Ok());
+    // :method GET / :scheme http / :path /api/status，加一个 4000 字节的 x-big 进动态表 (索引 62)，
+    // 剩下的都是 0xBE：压缩后不到 64KB，解出来两百多 MB
+    std::string prefix = "\x82\x86\x04\x0b/api/status";
+    std::string block = prefix + "\x40\x05x-big\x7f";
+    for(size_t v = 4000 - 127; ; v >>= 7) {
+        if(v < 128) { block += static_cast<char>(v); break; }
+        block += static_cast<char>((v & 0x7f) | 0x80);
+    }
+    block += std::string(4000, 'v');
+    block += std::string(60000 - block.size(), '\xbe');
+    client.Headers(1, block, true);
+    std::map<uint32_t, H2Client::Stream> streams;
+    streams[1];
+    bool done = client.Wait(&streams);
+    if(!done || streams[1].status != 431) {
+        printf("[%s] HPACK bomb: status %d, goaway %d\n", name, streams[1].status, client.GoawayCode());
+        CHECK(false);
+        return;
+    }
+    // x-big 还在服务端的动态表里，再引用一次就是正常请求
+    streams.clear();
+    streams[3];
+    client.Headers(3, prefix + "\xbe", true);
+    done = client.Wait(&streams);
+    CHECK(done && streams[3].ok && streams[3].body == "up\n");
+}
+
+static void TestH2Upload(EventLoop::Backend backend, const char* name) {
+    const std::string post = "\x83\x86\x04\x0b/api/status";   // :method POST，路由只有 GET，收完回 405
+    {
+        Server server(backend);
+        H2Client client(server.Port(), 65535);
+        CHECK(client.Ok());
+        int good = 0;
+        for(uint32_t id = 1; id < 40; id += 2) {
+            client.Headers(id, post, false);
+            client.Data(id, 1 << 20, true);
+            std::map<uint32_t, H2Client::Stream> streams;
+            streams[id];
+            if(!client.Wait(&streams) || streams[id].status != 405) break;
+            good++;
+        }
+        if(good != 20) {
+            printf("[%s] sequential 1MB uploads: %d of 20 answered, goaway %d\n", name, good, client.GoawayCode());
+            CHECK(false);
+        }
+    }
+    {
+        // 16 个流各攒 1MB 不结束，正好用完连接窗口；再多一帧就越界了
+        Server server(backend);
+        H2Client client(server.Port(), 65535);
+        CHECK(client.Ok());
+        for(uint32_t id = 1; id <= 31; id += 2) {
+            client.Headers(id, post, false);
+            client.Data(id, 1 << 20, false);
+        }
+        client.Headers(33, post, false);
+        client.Data(33, 1, false);
+        std::map<uint32_t, H2Client::Stream> streams;
+        streams[1];
+        CHECK(!client.Wait(&streams));
+        if(client.GoawayCode() != 3) {   // FLOW_CONTROL_ERROR
+            printf("[%s] DATA past the connection window: goaway %d\n", name, client.GoawayCode());
+            CHECK(false);
+        }
+    }
+    BufferBudget* budget = BufferBudget::Instance();
+    size_t savedLimit = budget->Limit(), savedPerConn = budget->PerConnLimit();
+    budget->SetLimit(0, 256 * 1024);
+    {
+        // 单连接上限 256KB，一个流攒 1MB 的 body：记账超限，和 HTTP/1 的大请求一样断开
+        uint64_t rejected = budget->Rejected();
+        Server server(backend);
+        H2Client client(server.Port(), 65535);
+        CHECK(client.Ok());
+        client.Headers(1, post, false);
+        client.Data(1, 1 << 20, false);
+        std::map<uint32_t, H2Client::Stream> streams;
+        streams[1];
+        CHECK(!client.Wait(&streams) && client.GoawayCode() == -1);
+        if(budget->Rejected() == rejected) {
+            printf("[%s] buffered h2 body not charged to the connection budget\n", name);
+            CHECK(false);
+        }
+    }
+    budget->SetLimit(savedLimit, savedPerConn);
+}
+
+int main() {
+    Log::get_instance()->init("ServerTestLog", 0, 2000, 800000, 0);
+
+    char dir[] = "/tmp/test_server_XXXXXX";
+    root = mkdtemp(dir);
+    WriteFile("mid.bin", Pattern(6 * 1024, 1));
+    std::string big = Pattern(30 * 1000 * 1000, 2);
+    WriteFile("big.bin", big);
+    HttpConn::srcDir = root;
+    FileCache::Instance()->Init(root, 64 * 1024 * 1024);
+    Router::Instance()->Get("/api/status", [](const HttpRequest&, const RouteParams&, HttpResponse& response) {
+        response.SetContentType("text/plain");
+        response.Body() = "up\n";
+    });
+    Router::Instance()->Static("/");
+
+    struct Backend {
+        EventLoop::Backend backend;
+        const char* name;
+    };
+    for(const Backend& b : {Backend{EventLoop::EPOLL, "epoll"}, Backend{EventLoop::URING, "io_uring"}}) {
+        if(b.backend == EventLoop::URING && !Server(b.backend).IsUring()) {
+            printf("io_uring unavailable, skipping its cases\n");
+            continue;
+        }
+        TestHighWaterBatch(b.backend, b.name);
+        TestH2Download(b.backend, b.name, big);
+        TestBigDownload(b.backend, b.name, big);
+        TestH2SmallWindow(b.backend, b.name, big);
+        TestH2Streams(b.backend, b.name, Pattern(6 * 1024, 1));
+        TestPipelinedHead(b.backend, b.name, Pattern(6 * 1024, 1), big);
+        TestMethodNotAllowed(b.backend, b.name);
+        TestReadBudget(b.backend, b.name);
+        TestHeaderBomb(b.backend, b.name);
+        TestH2Upload(b.backend, b.name);
+    }
+
+    std::string rm = "rm -rf " + root;
+    CHECK(system(rm.c_str()) == 0);
+    printf("%s (%d failures)\n", failures ? "FAILED" : "OK", failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,218 @@
+// tests/test_task.cpp
+// 1. Task：小捕获放在对象里、大捕获上堆，只能移动，移动 / 析构时捕获的对象不多不少正好析构一次
+// 2. MpmcQueue：容量取整、满了拒绝、取空返回 false，析构时放掉还没取走的元素
+// 3. 几个生产者几个消费者同时进出，每个元素恰好被取走一次
+// 4. 和 "std::function + 一把锁的 std::deque" 比一下派发耗时
+#include "../include/Task.h"
+#include "../include/MpmcQueue.h"
+#include "check.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// 数一数活着几个
+struct Counted {
+    static int alive;
+    Counted() { alive++; }
+    Counted(const Counted&) { alive++; }
+    Counted(Counted&&) noexcept { alive++; }
+    ~Counted() { alive--; }
+};
+int Counted::alive = 0;
+
+static void TestTask() {
+    int hits = 0;
+    Task empty;
+    CHECK(!empty);
+
+    // 三个指针的捕获：放得下
+    void* p = &hits;
+    uint32_t events = 7;
+    Task small([&hits, p, events]() { hits += events + (p != nullptr); });
+    CHECK(small && small.IsInline());
+    small();
+    CHECK(hits == 8);
+
+    // 放不下的上堆
+    char big[Task::INLINE_SIZE + 8] = {1};
+    Task large([big, &hits]() { hits += big[0]; });
+    CHECK(large && !large.IsInline());
+    large();
+    CHECK(hits == 9);
+
+    // 只能移动的捕获
+    std::unique_ptr<int> owned(new int(5));
+    Task moveOnly([owned = std::move(owned), &hits]() { hits += *owned; });
+    CHECK(moveOnly.IsInline());
+    Task moved(std::move(moveOnly));
+    CHECK(!moveOnly && moved);
+    moved();
+    CHECK(hits == 14);
+
+    // 捕获的对象跟着 Task 走，搬来搬去不多析构也不漏析构
+    {
+        Counted c;
+        Task a([c]() {});
+        CHECK(Counted::alive == 2);
+        Task b(std::move(a));
+        CHECK(Counted::alive == 2);
+        b = Task([c]() {});
+        CHECK(Counted::alive == 2);
+        b.Reset();
+        CHECK(Counted::alive == 1);
+
+        char pad[64] = {0};
+        Task h([c, pad]() {});
+        CHECK(!h.IsInline() && Counted::alive == 2);
+        Task h2(std::move(h));
+        CHECK(Counted::alive == 2);
+        h2 = std::move(b);
+        CHECK(Counted::alive == 1 && !h2);
+    }
+    CHECK(Counted::alive == 0);
+}
+
+static void TestQueue() {
+    MpmcQueue<Task> q(5);
+    CHECK(q.Capacity() == 8);
+    int hits = 0;
+    for(int i = 0; i < 8; i++) {
+        CHECK(q.TryPush(Task([&hits, i]() { hits += i; })));
+    }
+    CHECK(q.SizeApprox() == 8);
+    // 满了：拒绝，而且任务原样留在手里
+    Task extra([&hits]() { hits += 100; });
+    CHECK(!q.TryPush(std::move(extra)));
+    CHECK(extra);
+
+    Task t;
+    for(int i = 0; i < 8; i++) {
+        CHECK(q.TryPop(t));
+        t();
+    }
+    CHECK(hits == 28);
+    CHECK(!q.TryPop(t) && q.SizeApprox() == 0);
+
+    // 绕过好几圈以后还是对的
+    for(int round = 0; round < 100; round++) {
+        CHECK(q.TryPush(std::move(extra)));
+        CHECK(q.TryPop(extra));
+    }
+    extra();
+    CHECK(hits == 128);
+
+    // 没取走的在析构时放掉
+    {
+        MpmcQueue<Task> left(4);
+        Counted c;
+        left.TryPush(Task([c]() {}));
+        left.TryPush(Task([c]() {}));
+        CHECK(Counted::alive == 3);
+    }
+    CHECK(Counted::alive == 0);
+}
+
+static void TestConcurrent() {
+    const int kProducers = 3, kConsumers = 3, kPerProducer = 100000;
+    MpmcQueue<int> q(256);
+    std::vector<std::atomic<int>> taken(kProducers * kPerProducer);
+    for(std::atomic<int>& n : taken) n = 0;
+    std::atomic<int> done(0);
+    std::atomic<long> rejected(0);
+
+    std::vector<std::thread> threads;
+    for(int p = 0; p < kProducers; p++) {
+        threads.emplace_back([&, p]() {
+            for(int i = 0; i < kPerProducer; i++) {
+                int v = p * kPerProducer + i;
+                while(!q.TryPush(std::move(v))) {
+                    rejected++;
+                    std::this_thread::yield();
+                }
+            }
+            done++;
+        });
+    }
+    for(int c = 0; c < kConsumers; c++) {
+        threads.emplace_back([&]() {
+            int v;
+            while(true) {
+                if(q.TryPop(v)) {
+                    taken[v]++;
+                } else if(done == kProducers) {
+                    // 生产者都停了，再确认一遍是空的
+                    if(!q.TryPop(v)) break;
+                    taken[v]++;
+                } else {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    for(std::thread& t : threads) t.join();
+
+    int bad = 0;
+    for(std::atomic<int>& n : taken) bad += n != 1;
+    CHECK(bad == 0);
+    printf("mpmc: %d items through 256 slots, %ld rejected pushes\n", kProducers * kPerProducer, rejected.load());
+}
+
+static void Benchmark() {
+    // 单线程进出，只看每个任务本身的开销：构造 + 入队 + 出队 + 调用
+    const int kTasks = 2000000;
+    long sum = 0;
+    int fd = 3;
+    void* self = &sum;
+
+    std::mutex mtx;
+    std::deque<std::function<void()>> locked;
+    auto start = std::chrono::steady_clock::now();
+    for(int i = 0; i < kTasks; i++) {
+        {
+            // 原来的样子：bind 一个字符串副本，包进 std::function，排进加锁的队列
+            std::string dir = "/srv/www/resources";
+            std::lock_guard<std::mutex> locker(mtx);
+            locked.push_back(std::bind([&sum](int f, const std::string& d, void* s) {
+                sum += f + d.size() + (s != nullptr);
+            }, fd, dir, self));
+        }
+        std::function<void()> task;
+        {
+            std::lock_guard<std::mutex> locker(mtx);
+            task = std::move(locked.front());
+            locked.pop_front();
+        }
+        task();
+    }
+    double oldMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    MpmcQueue<Task> q(1024);
+    start = std::chrono::steady_clock::now();
+    for(int i = 0; i < kTasks; i++) {
+        q.TryPush(Task([&sum, fd, self]() { sum += fd + 18 + (self != nullptr); }));
+        Task task;
+        q.TryPop(task);
+        task();
+    }
+    double newMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    CHECK(sum == 2L * kTasks * 22);
+    printf("%d tasks: std::function + locked deque %.1f ms, Task + MpmcQueue %.1f ms\n", kTasks, oldMs, newMs);
+}
+
+int main() {
+    TestTask();
+    TestQueue();
+    TestConcurrent();
+    Benchmark();
+
+    printf("%s (%d failures)\n", failures ? "FAILED" : "OK", failures);
+    return failures ? 1 : 0;
+}
@@ -1,24 +1,214 @@
+// tests/test_threadpool.cpp
+// 1. WorkStealingDeque：所属线程 Push / Pop，几个线程同时 Steal，每个元素恰好被拿走一次
+// 2. 外部线程派任务、任务里再派任务 (压进自己的队列，被别的线程偷走)，析构前全部做完
+// 3. 收件箱满了 AddTask 返回 false，不排队也不执行
+// 4. 和原来 "一把锁 + 条件变量 + 每个任务 notify_one" 的线程池比派发小任务的耗时
+#include "../include/ThreadPool.h"
 #include "../include/log.h"
-#include <iostream>
+#include "check.h"
+#include <chrono>
+#include <cstdio>
+#include <queue>
+#include <set>
 #include <unistd.h>
 
-// 这里应该包含你的线程池头文件，比如:
-// #include "../include/threadpool.h"
+static void TestDeque() {
+    const int kItems = 200000, kThieves = 3;
+    std::vector<int> items(kItems);
+    std::vector<std::atomic<int>> taken(kItems);
+    for(int i = 0; i < kItems; i++) {
+        items[i] = i;
+        taken[i] = 0;
+    }
+    // 容量从 4 开始，顺便测扩容时窃取方还在读旧数组
+    WorkStealingDeque<int> deque(4);
+    std::atomic<bool> done(false);
+    std::atomic<int> stolen(0);
+    std::vector<std::thread> thieves;
+    for(int t = 0; t < kThieves; t++) {
+        thieves.emplace_back([&]() {
+            while(!done || !deque.Empty()) {
+                int* p = deque.Steal();
+                if(p) {
+                    taken[*p]++;
+                    stolen++;
+                }
+            }
+        });
+    }
+    // 所属线程：一会儿压一批，一会儿自己弹几个
+    int next = 0;
+    while(next < kItems) {
+        int batch = std::min(kItems - next, 1 + next % 37);
+        for(int i = 0; i < batch; i++) deque.Push(&items[next++]);
+        for(int i = 0; i < batch / 2; i++) {
+            int* p = deque.Pop();
+            if(p) taken[*p]++;
+        }
+    }
+    while(int* p = deque.Pop()) taken[*p]++;
+    done = true;
+    for(std::thread& t : thieves) t.join();
+
+    int bad = 0;
+    for(int i = 0; i < kItems; i++) bad += taken[i] != 1;
+    CHECK(bad == 0);
+    CHECK(stolen > 0);
+    CHECK(deque.Empty() && deque.Pop() == nullptr && deque.Steal() == nullptr);
+}
+
+static void TestPool() {
+    std::atomic<int> count(0);
+    std::mutex mtx;
+    std::set<std::thread::id> threads;
+    // 比池活得长：析构池的时候还有任务在用它
+    std::function<void(int)> spawn;
+    {
+        ThreadPool pool(4, 16384);
+        CHECK(pool.ThreadCount() == 4);
+        // 外部线程派的任务
+        for(int i = 0; i < 10000; i++) {
+            CHECK(pool.AddTask([&count]() { count++; }));
+        }
+        // 任务里再派：一棵 3 层、每层 20 个分支的树，全都从一个任务长出来
+        spawn = [&](int depth) {
+            count++;
+            {
+                std::lock_guard<std::mutex> locker(mtx);
+                threads.insert(std::this_thread::get_id());
+            }
+            if(depth == 0) {
+                usleep(50);
+                return;
+            }
+            for(int i = 0; i < 20; i++) pool.AddTask(spawn, depth - 1);
+        };
+        pool.AddTask(spawn, 3);
+        // 析构：手上和队列里的任务都做完才退出
+    }
+    CHECK(count == 10000 + 1 + 20 + 400 + 8000);
+    // 从一个任务长出来的子任务被别的线程偷走了
+    CHECK(threads.size() > 1);
+
+    // 空闲的池睡着以后还能被叫醒
+    ThreadPool pool(2);
+    usleep(20000);
+    std::atomic<bool> ran(false);
+    pool.AddTask([&ran]() { ran = true; });
+    for(int i = 0; i < 1000 && !ran; i++) usleep(1000);
+    CHECK(ran);
+}
+
+static void TestReject() {
+    std::atomic<bool> release(false);
+    std::atomic<int> count(0);
+    {
+        // 1 个线程、收件箱 8 格：线程被第一个任务卡住，后面的排满就拒
+        ThreadPool pool(1, 8);
+        std::atomic<bool> started(false);
+        CHECK(pool.AddTask([&]() {
+            started = true;
+            while(!release) usleep(100);
+        }));
+        while(!started) usleep(100);
+        int accepted = 0;
+        for(int i = 0; i < 20; i++) {
+            accepted += pool.AddTask([&count]() { count++; });
+        }
+        CHECK(accepted == 8);
+        CHECK(pool.Rejected() == 12);
+        CHECK(pool.Queued() == 8);
+        // 腾出位置以后又能派
+        release = true;
+        while(pool.Queued() > 0) usleep(100);
+        CHECK(pool.AddTask([&count]() { count++; }));
+    }
+    CHECK(count == 9);
+}
+
+// 原来的线程池：一把锁保护一个队列，每个任务 notify_one
+class LockedPool {
+public:
+    explicit LockedPool(size_t n) : closed_(false) {
+        for(size_t i = 0; i < n; i++) {
+            workers_.emplace_back([this]() {
+                while(true) {
+                    std::function<void()> task;
+                    {
+                        std::unique_lock<std::mutex> locker(mtx_);
+                        cond_.wait(locker, [this] { return closed_ || !tasks_.empty(); });
+                        if(closed_ && tasks_.empty()) return;
+                        task = std::move(tasks_.front());
+                        tasks_.pop();
+                    }
+                    task();
+                }
+            });
+        }
+    }
+    ~LockedPool() {
+        {
+            std::lock_guard<std::mutex> locker(mtx_);
+            closed_ = true;
+        }
+        cond_.notify_all();
+        for(std::thread& t : workers_) t.join();
+    }
+    bool AddTask(std::function<void()> task) {
+        {
+            std::lock_guard<std::mutex> locker(mtx_);
+            tasks_.push(std::move(task));
+        }
+        cond_.notify_one();
+        return true;
+    }
+private:
+    std::vector<std::thread> workers_;
+    std::queue<std::function<void()>> tasks_;
+    std::mutex mtx_;
+    std::condition_variable cond_;
+    bool closed_;
+};
+
+template<class Pool>
+static double Dispatch(size_t threads, int tasks) {
+    std::atomic<int> count(0);
+    auto start = std::chrono::steady_clock::now();
+    {
+        Pool pool(threads);
+        for(int i = 0; i < tasks; i++) {
+            // 有界队列满了就让一让，等工作线程取走一些
+            while(!pool.AddTask([&count]() { count.fetch_add(1, std::memory_order_relaxed); })) {
+                std::this_thread::yield();
+            }
+        }
+    }
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    CHECK(count == tasks);
+    return ms;
+}
+
+static void Benchmark() {
+    // 一个线程 (事件循环) 派一百万个很小的任务，析构时等全部做完
+    const int kTasks = 1000000;
+    for(size_t threads : {2, 6, 12}) {
+        double locked = Dispatch<LockedPool>(threads, kTasks);
+        double stealing = Dispatch<ThreadPool>(threads, kTasks);
+        printf("%zu workers, %d tasks: mutex queue %.1f ms, work stealing %.1f ms\n",
+               threads, kTasks, locked, stealing);
+    }
+}
 
 int main() {
-    // 1. 初始化日志
     Log::get_instance()->init("ThreadPoolLog", 0, 2000, 800000, 0);
-    
     LOG_INFO("========== ThreadPool Test Start ==========");
 
-    // TODO: 在这里编写测试你的线程池的代码
-    // 例如：
-    // ThreadPool<int> *pool = new ThreadPool<int>();
-    // pool->append(new int(1));
+    TestDeque();
+    TestPool();
+    TestReject();
+    Benchmark();
 
-    std::cout << "Test threadpool running..." << std::endl;
-    
     LOG_INFO("========== ThreadPool Test End ==========");
-    
-    return 0; // 这是必须的！
-}
\ No newline at end of file
+    printf("%s (%d failures)\n", failures ? "FAILED" : "OK", failures);
+    return failures ? 1 : 0;
+}
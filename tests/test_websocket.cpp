@@ -0,0 +1,264 @@
+// tests/test_websocket.cpp
+// 1. 握手：RFC 6455 1.3 的 accept 例子，升级请求的识别
+// 2. 各个去掩码实现和逐字节异或对拍 (随机长度、随机对齐)，再测一下吞吐
+// 3. 解帧：整帧 / 分片 / 半帧 / ping / 关闭握手，以及各种协议错误对应的关闭码
+#include "../include/http/WebSocket.h"
+#include "../include/http/HttpRequest.h"
+#include "../include/http/Router.h"
+#include "check.h"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+static const WebSocket::UnmaskImpl IMPLS[] = { WebSocket::UNMASK_SCALAR, WebSocket::UNMASK_SSE2, WebSocket::UNMASK_AVX2 };
+static const char* NAMES[] = { "scalar", "sse2", "avx2" };
+
+static bool IsUpgrade(const std::string& text) {
+    Buffer buff;
+    buff.append(text);
+    HttpRequest request;
+    request.Init();
+    return request.parse(buff) && request.IsFinished() && WebSocket::IsUpgrade(request);
+}
+
+static void TestHandshake() {
+    CHECK(WebSocket::AcceptKey("dGhlIHNhbXBsZSBub25jZQ==") == "s3pPLMBiTxaQ9kYGzzhZRbK+xOo=");
+
+    const std::string head = "GET /chat HTTP/1.1\r\nHost: example.com\r\n";
+    const std::string key = "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\n";
+    CHECK(IsUpgrade(head + "Upgrade: websocket\r\nConnection: Upgrade\r\n" + key + "Sec-WebSocket-Version: 13\r\n\r\n"));
+    // Connection 是列表，Upgrade 不区分大小写
+    CHECK(IsUpgrade(head + "Upgrade: WebSocket\r\nConnection: keep-alive, Upgrade\r\n" + key + "Sec-WebSocket-Version: 13\r\n\r\n"));
+    CHECK(!IsUpgrade(head + "Connection: Upgrade\r\n" + key + "Sec-WebSocket-Version: 13\r\n\r\n"));
+    CHECK(!IsUpgrade(head + "Upgrade: websocket\r\nConnection: keep-alive\r\n" + key + "Sec-WebSocket-Version: 13\r\n\r\n"));
+    CHECK(!IsUpgrade(head + "Upgrade: websocket\r\nConnection: Upgrade\r\n" + key + "Sec-WebSocket-Version: 8\r\n\r\n"));
+    CHECK(!IsUpgrade(head + "Upgrade: websocket\r\nConnection: Upgrade\r\nSec-WebSocket-Version: 13\r\n\r\n"));
+    CHECK(!IsUpgrade("POST /chat HTTP/1.1\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n" + key +
+                     "Sec-WebSocket-Version: 13\r\nContent-Length: 0\r\n\r\n"));
+}
+
+static void TestUnmask() {
+    std::mt19937 rng(2024);
+    std::vector<char> orig(1024 + 64), buf(1024 + 64);
+    for(int i = 0; i < 3; i++) {
+        if(!WebSocket::UseUnmask(IMPLS[i])) {
+            printf("%-6s unsupported on this CPU, skipped\n", NAMES[i]);
+            continue;
+        }
+        for(int round = 0; round < 20000; round++) {
+            size_t off = rng() % 64;
+            size_t len = rng() % 1024;
+            uint8_t mask[4] = { uint8_t(rng()), uint8_t(rng()), uint8_t(rng()), uint8_t(rng()) };
+            for(size_t k = 0; k < len; k++) orig[off + k] = buf[off + k] = static_cast<char>(rng());
+            WebSocket::Unmask(buf.data() + off, len, mask);
+            bool ok = true;
+            for(size_t k = 0; k < len; k++) {
+                if(buf[off + k] != static_cast<char>(orig[off + k] ^ mask[k & 3])) ok = false;
+            }
+            CHECK(ok);
+            if(!ok) break;
+        }
+    }
+}
+
+static void Benchmark() {
+    std::vector<char> buf(64 * 1024, 'x');
+    const uint8_t mask[4] = { 0x12, 0x34, 0x56, 0x78 };
+    const int rounds = 20000;
+    // 逐字节的写法作为参照
+    auto start = std::chrono::steady_clock::now();
+    for(int r = 0; r < rounds; r++) {
+        char* p = buf.data();
+        for(size_t k = 0; k < buf.size(); k++) p[k] ^= mask[k & 3];
+        __asm__ __volatile__("" : : "r"(p) : "memory");
+    }
+    double base = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("%-8s %8.2f GB/s\n", "bytewise", rounds * buf.size() / base / 1e9);
+    for(int i = 0; i < 3; i++) {
+        if(!WebSocket::UseUnmask(IMPLS[i])) continue;
+        start = std::chrono::steady_clock::now();
+        for(int r = 0; r < rounds; r++) {
+            WebSocket::Unmask(buf.data(), buf.size(), mask);
+            __asm__ __volatile__("" : : "r"(buf.data()) : "memory");
+        }
+        double t = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        printf("%-8s %8.2f GB/s\n", NAMES[i], rounds * buf.size() / t / 1e9);
+    }
+}
+
+// 客户端发来的帧：带掩码
+static std::string ClientFrame(uint8_t b0, const std::string& payload, bool masked = true) {
+    std::string f;
+    f.push_back(static_cast<char>(b0));
+    size_t len = payload.size();
+    uint8_t m = masked ? 0x80 : 0;
+    if(len < 126) {
+        f.push_back(static_cast<char>(m | len));
+    } else if(len <= 0xffff) {
+        f.push_back(static_cast<char>(m | 126));
+        f.push_back(static_cast<char>(len >> 8));
+        f.push_back(static_cast<char>(len));
+    } else {
+        f.push_back(static_cast<char>(m | 127));
+        for(int i = 7; i >= 0; i--) f.push_back(static_cast<char>(static_cast<uint64_t>(len) >> (i * 8)));
+    }
+    const char mask[4] = { 0x37, (char)0xfa, 0x21, 0x3d };
+    if(masked) f.append(mask, 4);
+    for(size_t i = 0; i < len; i++) f.push_back(masked ? payload[i] ^ mask[i & 3] : payload[i]);
+    return f;
+}
+
+// 解开服务端写出的帧 (不带掩码)
+struct Frame {
+    uint8_t b0;
+    std::string payload;
+};
+
+static std::vector<Frame> ServerFrames(Buffer& out) {
+    std::vector<Frame> frames;
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(out.peek());
+    size_t n = out.readableBytes(), i = 0;
+    while(i + 2 <= n) {
+        uint64_t len = p[i + 1] & 0x7f;
+        size_t head = 2;
+        if(len == 126) { len = p[i + 2] << 8 | p[i + 3]; head = 4; }
+        else if(len == 127) { len = 0; for(int k = 0; k < 8; k++) len = len << 8 | p[i + 2 + k]; head = 10; }
+        frames.push_back(Frame{ p[i], std::string(reinterpret_cast<const char*>(p) + i + head, len) });
+        i += head + len;
+    }
+    out.retrieveAll();
+    return frames;
+}
+
+struct Session {
+    std::vector<std::string> messages;
+    std::vector<bool> binary;
+    int closeCode = 0;
+    int closeCalls = 0;
+    HttpRequest request;
+    RouteParams params;
+    WebSocket ws;
+    Buffer in, out;
+
+    Session() {
+        WebSocketHandler h;
+        h.onMessage = [this](WebSocket& ws, StrView data, bool bin) {
+            messages.push_back(data.ToString());
+            binary.push_back(bin);
+            ws.Send(data, bin);
+        };
+        h.onClose = [this](WebSocket&, uint16_t code) { closeCode = code; closeCalls++; };
+        request.Init();
+        ws.Open(std::make_shared<const WebSocketHandler>(h), request, params, out);
+    }
+    void Feed(const std::string& bytes) {
+        in.append(bytes);
+        ws.Process(in, out, 1 << 20);
+    }
+};
+
+static uint16_t CloseCodeOf(const Frame& f) {
+    return f.payload.size() >= 2 ? static_cast<uint16_t>(static_cast<uint8_t>(f.payload[0]) << 8 |
+                                                          static_cast<uint8_t>(f.payload[1])) : 0;
+}
+
+static void TestFrames() {
+    {
+        // 整帧、126 / 127 两种长度、回显
+        Session s;
+        std::string mid(300, 'm'), big(70000, 'b');
+        s.Feed(ClientFrame(0x81, "hello") + ClientFrame(0x82, mid) + ClientFrame(0x81, big));
+        CHECK(s.messages.size() == 3 && s.messages[0] == "hello" && s.messages[1] == mid && s.messages[2] == big);
+        CHECK(s.binary.size() == 3 && !s.binary[0] && s.binary[1]);
+        std::vector<Frame> f = ServerFrames(s.out);
+        CHECK(f.size() == 3 && f[0].b0 == 0x81 && f[0].payload == "hello" && f[1].b0 == 0x82 && f[2].payload == big);
+        CHECK(s.in.readableBytes() == 0);
+    }
+    {
+        // 一个字节一个字节地到
+        Session s;
+        std::string bytes = ClientFrame(0x81, std::string(200, 'z'));
+        for(char c : bytes) s.Feed(std::string(1, c));
+        CHECK(s.messages.size() == 1 && s.messages[0] == std::string(200, 'z'));
+    }
+    {
+        // 分片消息中间夹着 ping
+        Session s;
+        s.Feed(ClientFrame(0x01, "frag") + ClientFrame(0x89, "p") + ClientFrame(0x00, "men") + ClientFrame(0x80, "ted"));
+        CHECK(s.messages.size() == 1 && s.messages[0] == "fragmented");
+        std::vector<Frame> f = ServerFrames(s.out);
+        CHECK(f.size() == 2 && f[0].b0 == 0x8a && f[0].payload == "p" && f[1].payload == "fragmented");
+    }
+    {
+        // 关闭握手：回显状态码，之后的帧不再处理
+        Session s;
+        s.Feed(ClientFrame(0x88, std::string("\x03\xe8" "bye", 5)) + ClientFrame(0x81, "late"));
+        CHECK(s.ws.IsClosing() && s.closeCode == 1000 && s.messages.empty());
+        std::vector<Frame> f = ServerFrames(s.out);
+        CHECK(f.size() == 1 && f[0].b0 == 0x88 && CloseCodeOf(f[0]) == 1000);
+        s.ws.Disconnect();
+        CHECK(s.closeCalls == 1);
+    }
+    {
+        // 连接直接断了
+        Session s;
+        s.ws.Disconnect();
+        CHECK(s.closeCode == 1006 && s.closeCalls == 1);
+    }
+
+    // 协议错误 -> 服务端发的关闭码
+    struct Case {
+        const char* name;
+        std::string bytes;
+        uint16_t code;
+    };
+    std::vector<Case> cases = {
+        { "unmasked",         ClientFrame(0x81, "x", false), 1002 },
+        { "rsv bit",          ClientFrame(0xc1, "x"), 1002 },
+        { "bad opcode",       ClientFrame(0x83, "x"), 1002 },
+        { "long ping",        ClientFrame(0x89, std::string(126, 'p')), 1002 },
+        { "fragmented ping",  ClientFrame(0x09, "p"), 1002 },
+        { "lone continuation", ClientFrame(0x80, "x"), 1002 },
+        { "nested message",   ClientFrame(0x01, "a") + ClientFrame(0x81, "b"), 1002 },
+        { "bad close code",   ClientFrame(0x88, std::string("\x03\xed", 2)), 1002 },
+        { "one byte close",   ClientFrame(0x88, "x"), 1002 },
+        { "invalid utf-8",    ClientFrame(0x81, "\xc3\x28"), 1007 },
+        { "surrogate",        ClientFrame(0x81, "\xed\xa0\x80"), 1007 },
+        { "split utf-8",      ClientFrame(0x01, "\xce") + ClientFrame(0x80, "\xba"), 0 },
+        { "too big",          ClientFrame(0x82, std::string(WebSocket::maxMessageBytes + 1, 'x')), 1009 },
+    };
+    for(const Case& c : cases) {
+        Session s;
+        s.Feed(c.bytes);
+        std::vector<Frame> f = ServerFrames(s.out);
+        bool closed = !f.empty() && f.back().b0 == 0x88;
+        bool ok = c.code == 0 ? !closed : closed && CloseCodeOf(f.back()) == c.code && s.closeCode == c.code;
+        if(!ok) printf("[FAIL] case \"%s\"\n", c.name);
+        CHECK(ok);
+    }
+
+    {
+        // 空闲：第一次排 ping，没有回音的话第二次要求关闭；收到任何帧都算有回音
+        Session s;
+        CHECK(s.ws.KeepAliveTick());
+        s.Feed("");
+        std::vector<Frame> f = ServerFrames(s.out);
+        CHECK(f.size() == 1 && f[0].b0 == 0x89);
+        CHECK(!s.ws.KeepAliveTick());
+        s.Feed(ClientFrame(0x8a, ""));
+        CHECK(s.ws.KeepAliveTick());
+    }
+}
+
+int main() {
+    TestHandshake();
+    TestUnmask();
+    TestFrames();
+    Benchmark();
+
+    printf("%s (%d failures)\n", failures ? "FAILED" : "OK", failures);
+    return failures ? 1 : 0;
+}